@@ -0,0 +1,133 @@
+// Capture kernel benchmarks
+//
+//   cargo bench --features bench --bench capture [-- <filter>]
+//
+// Every iteration processes one frame. Throughput is reported in GB/s of
+// pixel data; set UNSEEN_BENCH_FRAMES=1 to report frames/s instead. Padded
+// cases add 256 bytes to each row, so the kernels cannot treat the mapped
+// image as one contiguous block.
+
+use ash::vk;
+use criterion::{
+    black_box, criterion_group, criterion_main, measurement::WallTime, BenchmarkGroup, BenchmarkId,
+    Criterion, Throughput,
+};
+use VkLayer_PRIVATE_unseen::bench_api::{self, HostFrame};
+
+const RESOLUTIONS: [(&str, u32, u32); 5] = [
+    ("720p", 1280, 720),
+    ("1080p", 1920, 1080),
+    ("1440p", 2560, 1440),
+    ("4k", 3840, 2160),
+    ("8k", 7680, 4320),
+];
+
+const FORMATS: [vk::Format; 6] = [
+    vk::Format::B8G8R8A8_SRGB,
+    vk::Format::B8G8R8A8_UNORM,
+    vk::Format::R8G8B8A8_SRGB,
+    vk::Format::R8G8B8A8_UNORM,
+    vk::Format::R8G8B8_SRGB,
+    vk::Format::R8G8B8_UNORM,
+];
+
+const ROW_PADDING: [(&str, u32); 2] = [("tight", 0), ("padded", 256)];
+
+fn throughput(bytes: u64) -> Throughput {
+    if std::env::var("UNSEEN_BENCH_FRAMES").as_deref() == Ok("1") {
+        Throughput::Elements(1)
+    } else {
+        Throughput::BytesDecimal(bytes)
+    }
+}
+
+fn new_group<'a>(c: &'a mut Criterion, name: &str) -> BenchmarkGroup<'a, WallTime> {
+    let mut group = c.benchmark_group(name);
+    // 8K frames take tens of milliseconds per iteration
+    group.sample_size(10);
+    group
+}
+
+fn host_frames(formats: &[vk::Format]) -> impl Iterator<Item = (String, HostFrame)> + '_ {
+    formats.iter().flat_map(|&format| {
+        RESOLUTIONS.iter().flat_map(move |&(res, width, height)| {
+            ROW_PADDING.iter().map(move |&(padding, row_padding)| {
+                let extent = vk::Extent2D { width, height };
+                let frame = HostFrame::new(extent, format, row_padding).unwrap();
+                (format!("{:?}/{}/{}", format, res, padding), frame)
+            })
+        })
+    })
+}
+
+fn rgb_frames() -> impl Iterator<Item = (&'static str, u32, u32, Vec<u8>)> {
+    RESOLUTIONS.iter().map(|&(res, width, height)| {
+        let extent = vk::Extent2D { width, height };
+        let frame = HostFrame::new(extent, vk::Format::R8G8B8_UNORM, 0).unwrap();
+        (res, width, height, bench_api::convert(&frame).unwrap())
+    })
+}
+
+fn convert(c: &mut Criterion) {
+    let mut group = new_group(c, "convert");
+    for (id, frame) in host_frames(&FORMATS) {
+        group.throughput(throughput(frame.pixel_bytes()));
+        group.bench_with_input(BenchmarkId::from_parameter(id), &frame, |b, frame| {
+            b.iter(|| bench_api::convert(black_box(frame)))
+        });
+    }
+    group.finish();
+}
+
+// Hashing and statistics only depend on the pixel size
+fn hash_and_stats(c: &mut Criterion) {
+    let formats = [vk::Format::B8G8R8A8_UNORM, vk::Format::R8G8B8_UNORM];
+
+    let mut group = new_group(c, "hash");
+    for (id, frame) in host_frames(&formats) {
+        group.throughput(throughput(frame.pixel_bytes()));
+        group.bench_with_input(BenchmarkId::from_parameter(id), &frame, |b, frame| {
+            b.iter(|| bench_api::hash(black_box(frame)))
+        });
+    }
+    group.finish();
+
+    let mut group = new_group(c, "stats");
+    for (id, frame) in host_frames(&formats) {
+        group.throughput(throughput(frame.pixel_bytes()));
+        group.bench_with_input(BenchmarkId::from_parameter(id), &frame, |b, frame| {
+            b.iter(|| bench_api::stats(black_box(frame)))
+        });
+    }
+    group.finish();
+}
+
+fn encode(c: &mut Criterion) {
+    let mut group = new_group(c, "encode");
+    for (res, width, height, pixels) in rgb_frames() {
+        group.throughput(throughput(pixels.len() as u64));
+        group.bench_with_input(BenchmarkId::new("ppm", res), &pixels, |b, pixels| {
+            b.iter(|| bench_api::encode_ppm(black_box(pixels), width, height))
+        });
+    }
+    group.finish();
+}
+
+// Includes the page cache copy but not writeback to the device
+fn write(c: &mut Criterion) {
+    let path = std::env::temp_dir().join(format!("unseen_bench_{}.ppm", std::process::id()));
+    let filename = path.to_str().unwrap();
+
+    let mut group = new_group(c, "save_ppm");
+    for (res, width, height, pixels) in rgb_frames() {
+        group.throughput(throughput(pixels.len() as u64));
+        group.bench_with_input(BenchmarkId::from_parameter(res), &pixels, |b, pixels| {
+            b.iter(|| bench_api::save_ppm(filename, black_box(pixels), width, height).unwrap())
+        });
+    }
+    group.finish();
+    let _ = std::fs::remove_file(&path);
+}
+
+criterion_group!(benches, convert, hash_and_stats, encode, write);
+criterion_main!(benches);
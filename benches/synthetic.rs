@@ -0,0 +1,356 @@
+// Synthetic capture benchmark
+//
+//   cargo bench --features bench --bench synthetic -- [options]
+//
+// Draws synthetic scenes (static UI, scrolling text, moving gradients and
+// noise) into a host frame and pushes every frame through the layer's
+// capture stages: hashing, conversion, encoding and writing, configured by
+// the same VK_CAPTURE_* variables as the layer. No Vulkan driver is needed,
+// so sink and I/O throughput can be measured on any machine.
+//
+// Frames are written to VK_CAPTURE_OUTPUT_DIR, or to a temporary directory
+// that is removed afterwards. File names cycle through --files names so
+// long runs do not fill the disk.
+//
+// Every frame is stamped when it is presented, when a sink picks it up
+// (queue) and when write() returns for its file, without an fsync
+// (written). With --depths or --workers the frames instead go through a
+// ring of that many slots drained by that many sink threads, for every
+// combination, to find where adding depth stops buying throughput and only
+// adds latency.
+
+use ash::vk;
+use std::{
+    process,
+    sync::{
+        atomic::{AtomicU64, Ordering},
+        mpsc, Mutex,
+    },
+    thread,
+    time::{Duration, Instant},
+};
+use VkLayer_PRIVATE_unseen::bench_api::{self, HostFrame, Scene, Sink, SCENES};
+
+struct Options {
+    scenes: Vec<Scene>,
+    width: u32,
+    height: u32,
+    format: vk::Format,
+    // Target frame rate (0 = as fast as the sink goes)
+    fps: f64,
+    frames: u32,
+    files: u32,
+    output_dir: Option<String>,
+    // Ring slots and sink threads to sweep; empty for the direct run
+    depths: Vec<usize>,
+    workers: Vec<usize>,
+}
+
+fn usage() -> ! {
+    eprintln!(
+        "Usage: cargo bench --features bench --bench synthetic -- [options]
+  --scene NAME    ui, text, gradient, noise or all (default all)
+  --width N       Frame width (default 1920)
+  --height N      Frame height (default 1080)
+  --format F      bgra, rgba or rgb (default bgra)
+  --fps N         Frames per second to offer, 0 for unpaced (default 0)
+  --frames N      Frames per scene (default 300)
+  --files N       Distinct file names written in turn (default 60)
+  --output DIR    Output directory (default VK_CAPTURE_OUTPUT_DIR or a
+                  temporary directory)
+  --depths LIST   Ring slots to sweep, e.g. 1,2,4,8 (default 1,2,4,8 with
+                  --workers)
+  --workers LIST  Sink threads to sweep, e.g. 1,2,4 (default 1,2,4 with
+                  --depths)"
+    );
+    process::exit(2);
+}
+
+fn parse_options() -> Options {
+    let mut options = Options {
+        scenes: SCENES.to_vec(),
+        width: 1920,
+        height: 1080,
+        format: vk::Format::B8G8R8A8_UNORM,
+        fps: 0.0,
+        frames: 300,
+        files: 60,
+        output_dir: std::env::var("VK_CAPTURE_OUTPUT_DIR").ok(),
+        depths: Vec::new(),
+        workers: Vec::new(),
+    };
+
+    // cargo bench passes --bench to harness-less benches
+    let mut args = std::env::args().skip(1).filter(|arg| arg != "--bench");
+    while let Some(name) = args.next() {
+        let value = args.next().unwrap_or_else(|| usage());
+        let number = || value.parse().unwrap_or_else(|_| usage());
+        match name.as_str() {
+            "--scene" if value == "all" => options.scenes = SCENES.to_vec(),
+            "--scene" => options.scenes = vec![Scene::parse(&value).unwrap_or_else(|| usage())],
+            "--width" => options.width = number(),
+            "--height" => options.height = number(),
+            "--format" => {
+                options.format = match value.as_str() {
+                    "bgra" => vk::Format::B8G8R8A8_UNORM,
+                    "rgba" => vk::Format::R8G8B8A8_UNORM,
+                    "rgb" => vk::Format::R8G8B8_UNORM,
+                    _ => usage(),
+                }
+            }
+            "--fps" => options.fps = value.parse().unwrap_or_else(|_| usage()),
+            "--frames" => options.frames = number(),
+            "--files" => options.files = number(),
+            "--output" => options.output_dir = Some(value),
+            "--depths" => options.depths = parse_list(&value),
+            "--workers" => options.workers = parse_list(&value),
+            _ => usage(),
+        }
+    }
+
+    if options.depths.is_empty() != options.workers.is_empty() {
+        if options.depths.is_empty() {
+            options.depths = vec![1, 2, 4, 8];
+        } else {
+            options.workers = vec![1, 2, 4];
+        }
+    }
+
+    if options.width == 0 || options.height == 0 || options.frames == 0 || options.files == 0 {
+        usage();
+    }
+    options
+}
+
+fn parse_list(value: &str) -> Vec<usize> {
+    let list: Vec<usize> = value
+        .split(',')
+        .map(|item| item.trim().parse().unwrap_or_else(|_| usage()))
+        .collect();
+    if list.contains(&0) {
+        usage();
+    }
+    list
+}
+
+fn pace(start: Instant, interval: Option<Duration>, frame_num: u32) {
+    if let Some(interval) = interval {
+        let deadline = start + interval * frame_num;
+        if let Some(wait) = deadline.checked_duration_since(Instant::now()) {
+            thread::sleep(wait);
+        }
+    }
+}
+
+fn capture_or_exit(sink: &Sink, frame: &HostFrame, frame_num: u32, present_ns: u64) -> u64 {
+    sink.capture(frame, frame_num, present_ns)
+        .unwrap_or_else(|e| {
+            eprintln!("Failed to write frame {}: {}", frame_num, e);
+            process::exit(1);
+        }) as u64
+}
+
+fn interval(options: &Options) -> Option<Duration> {
+    (options.fps > 0.0).then(|| Duration::from_secs_f64(1.0 / options.fps))
+}
+
+fn run_scene(options: &Options, scene: Scene, output_dir: &str) {
+    let extent = vk::Extent2D {
+        width: options.width,
+        height: options.height,
+    };
+    let mut frame = HostFrame::new(extent, options.format, 0).unwrap();
+    let mut source = frame.synthetic_source(scene);
+    let sink = Sink::new(output_dir);
+    let interval = interval(options);
+
+    let mut generate = Duration::ZERO;
+    let mut bytes = 0u64;
+    let mut late = 0u32;
+    let start = Instant::now();
+    for frame_num in 0..options.frames {
+        pace(start, interval, frame_num);
+
+        let generate_start = Instant::now();
+        frame.draw(&mut source, frame_num);
+        generate += generate_start.elapsed();
+
+        let present_ns = bench_api::now_ns();
+        bytes += capture_or_exit(&sink, &frame, frame_num % options.files, present_ns);
+
+        // Not done before the next frame was due
+        if let Some(interval) = interval {
+            if start.elapsed() > interval * (frame_num + 1) {
+                late += 1;
+            }
+        }
+    }
+    let elapsed = start.elapsed().as_secs_f64();
+
+    println!(
+        "{:<10} {:>7} {:>9.1} {:>6} {:>9.1} {:>12.2}",
+        scene.name(),
+        options.frames,
+        options.frames as f64 / elapsed,
+        late,
+        bytes as f64 / elapsed / 1e6,
+        generate.as_secs_f64() * 1000.0 / options.frames as f64
+    );
+    for (stage, histogram) in sink.latencies() {
+        println!(
+            "  {:<8} {:>9.1} {:>9.1} {:>9.1} {:>9.1} {:>9.1}",
+            stage,
+            histogram.mean() / 1000.0,
+            histogram.percentile(50.0) as f64 / 1000.0,
+            histogram.percentile(90.0) as f64 / 1000.0,
+            histogram.percentile(99.0) as f64 / 1000.0,
+            histogram.max() as f64 / 1000.0
+        );
+    }
+}
+
+// Frames are drawn into free ring slots, which stands in for the copy out of
+// the swapchain image, and stamped as presented. A frame that finds every
+// slot busy is dropped rather than stalling the present, as a live stream
+// must; a slot is free again once its frame is written.
+fn run_pipeline(options: &Options, scene: Scene, output_dir: &str, depth: usize, workers: usize) {
+    let extent = vk::Extent2D {
+        width: options.width,
+        height: options.height,
+    };
+    let new_frame = || HostFrame::new(extent, options.format, 0).unwrap();
+    let mut source = new_frame().synthetic_source(scene);
+    let sink = Sink::new(output_dir);
+    let interval = interval(options);
+
+    let (free_tx, free_rx) = mpsc::channel();
+    for _ in 0..depth {
+        free_tx.send(new_frame()).unwrap();
+    }
+    let (ring_tx, ring_rx) = mpsc::sync_channel::<(HostFrame, u32, u64)>(depth);
+    let ring_rx = Mutex::new(ring_rx);
+    let bytes = AtomicU64::new(0);
+    let mut dropped = 0u32;
+
+    let start = Instant::now();
+    thread::scope(|scope| {
+        for _ in 0..workers {
+            let (free_tx, ring_rx, sink, bytes) = (free_tx.clone(), &ring_rx, &sink, &bytes);
+            scope.spawn(move || loop {
+                let next = ring_rx.lock().unwrap().recv();
+                let Ok((frame, frame_num, present_ns)) = next else {
+                    break;
+                };
+                let written = capture_or_exit(sink, &frame, frame_num % options.files, present_ns);
+                bytes.fetch_add(written, Ordering::Relaxed);
+                let _ = free_tx.send(frame);
+            });
+        }
+
+        for frame_num in 0..options.frames {
+            pace(start, interval, frame_num);
+            match free_rx.try_recv() {
+                Ok(mut frame) => {
+                    frame.draw(&mut source, frame_num);
+                    ring_tx
+                        .send((frame, frame_num, bench_api::now_ns()))
+                        .unwrap();
+                }
+                Err(_) => dropped += 1,
+            }
+        }
+        drop(ring_tx);
+    });
+    let elapsed = start.elapsed().as_secs_f64();
+
+    let percentile_ms = |stage: &str, percentile: f64| {
+        sink.latencies()
+            .find(|(name, _)| *name == stage)
+            .map_or(0.0, |(_, histogram)| {
+                histogram.percentile(percentile) as f64 / 1e6
+            })
+    };
+    println!(
+        "{:<10} {:>5} {:>7} {:>9.1} {:>7} {:>9.1} {:>12.2} {:>14.2} {:>14.2} {:>14.2}",
+        scene.name(),
+        depth,
+        workers,
+        (options.frames - dropped) as f64 / elapsed,
+        dropped,
+        bytes.load(Ordering::Relaxed) as f64 / elapsed / 1e6,
+        percentile_ms("queue", 99.0),
+        percentile_ms("written", 50.0),
+        percentile_ms("written", 99.0),
+        percentile_ms("written", 100.0)
+    );
+}
+
+fn main() {
+    let options = parse_options();
+
+    let temp_dir = options.output_dir.is_none().then(|| {
+        let dir = std::env::temp_dir().join(format!("unseen_synthetic.{}", process::id()));
+        std::fs::create_dir_all(&dir).unwrap_or_else(|e| {
+            eprintln!("Failed to create {}: {}", dir.display(), e);
+            process::exit(1);
+        });
+        dir
+    });
+    let output_dir = match (&options.output_dir, &temp_dir) {
+        (Some(dir), _) => dir.clone(),
+        (None, dir) => dir.as_ref().unwrap().display().to_string(),
+    };
+
+    println!(
+        "Synthetic capture: {}x{} {:?}, {} frames per scene at {}, to {}",
+        options.width,
+        options.height,
+        options.format,
+        options.frames,
+        if options.fps > 0.0 {
+            format!("{} fps", options.fps)
+        } else {
+            "full speed".to_string()
+        },
+        output_dir
+    );
+    println!();
+    if options.depths.is_empty() {
+        println!(
+            "{:<10} {:>7} {:>9} {:>6} {:>9} {:>12}",
+            "scene", "frames", "fps", "late", "MB/s", "generate_ms"
+        );
+        println!(
+            "  {:<8} {:>9} {:>9} {:>9} {:>9} {:>9}",
+            "stage", "mean_us", "p50_us", "p90_us", "p99_us", "max_us"
+        );
+        for &scene in &options.scenes {
+            run_scene(&options, scene, &output_dir);
+        }
+    } else {
+        println!(
+            "{:<10} {:>5} {:>7} {:>9} {:>7} {:>9} {:>12} {:>14} {:>14} {:>14}",
+            "scene",
+            "depth",
+            "workers",
+            "fps",
+            "dropped",
+            "MB/s",
+            "queue_p99_ms",
+            "written_p50_ms",
+            "written_p99_ms",
+            "written_max_ms"
+        );
+        for &scene in &options.scenes {
+            for &depth in &options.depths {
+                for &workers in &options.workers {
+                    run_pipeline(&options, scene, &output_dir, depth, workers);
+                }
+            }
+        }
+    }
+
+    if let Some(dir) = temp_dir {
+        let _ = std::fs::remove_dir_all(dir);
+    }
+}
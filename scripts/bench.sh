@@ -0,0 +1,79 @@
+#!/usr/bin/env bash
+
+# End-to-end rendering benchmark for the Unseen Vulkan layer
+# Runs target/release/bin/render_bench on a software driver (lavapipe) once
+# per capture mode and prints app fps and frame time percentiles for each.
+#
+# Usage: scripts/bench.sh [render_bench options]
+#   BENCH_ICD     ICD manifest of the driver (default: lavapipe's)
+#   BENCH_FRAMES  Measured frames per mode (default: 200)
+#   BENCH_MODES   Modes to run (default: "none off hash ppm")
+#
+# Modes:
+#   none  layer not loaded, the driver's own headless WSI
+#   off   layer loaded, no frame selected for capture
+#   hash  content hashes only (VK_CAPTURE_HASH=only)
+#   ppm   every frame written as PPM
+#
+# There is no png mode: VK_CAPTURE_FORMAT=png still writes PPM.
+
+set -e
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+PROJECT_ROOT="$(cd "$SCRIPT_DIR/.." && pwd)"
+cd "$PROJECT_ROOT"
+
+LAYER_LIB="target/release/libVkLayer_PRIVATE_unseen.so"
+BENCH_BIN="target/release/bin/render_bench"
+for file in "$LAYER_LIB" "$BENCH_BIN"; do
+    if [ ! -f "$file" ]; then
+        echo "❌ $file not found, run 'make release' first"
+        exit 1
+    fi
+done
+
+if [ -z "$BENCH_ICD" ]; then
+    for dir in /usr/share/vulkan/icd.d /etc/vulkan/icd.d /usr/local/share/vulkan/icd.d; do
+        BENCH_ICD=$(ls "$dir"/lvp_icd*.json 2>/dev/null | head -1)
+        [ -n "$BENCH_ICD" ] && break
+    done
+fi
+if [ -z "$BENCH_ICD" ] || [ ! -f "$BENCH_ICD" ]; then
+    echo "❌ lavapipe ICD not found (install mesa-vulkan-drivers or set BENCH_ICD)"
+    exit 1
+fi
+export VK_DRIVER_FILES="$BENCH_ICD"
+export VK_ICD_FILENAMES="$BENCH_ICD"
+
+BENCH_DIR=$(mktemp -d /tmp/unseen_bench.XXXXXX)
+trap 'rm -rf "$BENCH_DIR"' EXIT
+cp "$LAYER_LIB" "$BENCH_DIR/"
+sed "s|\\./|$BENCH_DIR/|g" VkLayer_PRIVATE_unseen.json > "$BENCH_DIR/VkLayer_PRIVATE_unseen.json"
+
+echo "Unseen Rendering Benchmark"
+echo "=========================="
+echo "Driver: $BENCH_ICD"
+echo
+
+run_mode() {
+    local mode="$1"
+    shift
+    local output_dir="$BENCH_DIR/frames_$mode"
+    mkdir -p "$output_dir"
+    env -u RUST_LOG -u VK_UNSEEN_ENABLE "$@" VK_CAPTURE_OUTPUT_DIR="$output_dir" \
+        "$BENCH_BIN" --frames "${BENCH_FRAMES:-200}" --shaders shaders --label "$mode" $BENCH_ARGS
+    # Captured frames are only kept for the duration of a mode
+    rm -rf "$output_dir"
+}
+
+WITH_LAYER=(VK_LAYER_PATH="$BENCH_DIR" VK_INSTANCE_LAYERS=VK_LAYER_PRIVATE_unseen)
+BENCH_ARGS="$*"
+for mode in ${BENCH_MODES:-none off hash ppm}; do
+    case "$mode" in
+        none) run_mode none -u VK_INSTANCE_LAYERS ;;
+        off)  run_mode off "${WITH_LAYER[@]}" VK_CAPTURE_FRAMES=4294967295 ;;
+        hash) run_mode hash "${WITH_LAYER[@]}" VK_CAPTURE_HASH=only ;;
+        ppm)  run_mode ppm "${WITH_LAYER[@]}" VK_CAPTURE_FORMAT=ppm ;;
+        *)    echo "❌ Unknown mode: $mode"; exit 1 ;;
+    esac
+done
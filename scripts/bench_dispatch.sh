@@ -0,0 +1,59 @@
+#!/usr/bin/env bash
+
+# Layer dispatch benchmark for the Unseen Vulkan layer
+# Runs target/release/bin/dispatch_bench on the null driver built from
+# tests/icd, so acquire and present times are the layer's own cost.
+#
+# Usage: scripts/bench_dispatch.sh [dispatch_bench options]
+#   BENCH_ITERATIONS  Measured acquire/present pairs per mode (default: 100000)
+#   BENCH_MODES       Modes to run (default: "off hash")
+#
+# Modes:
+#   off   no frame selected for capture
+#   hash  content hashes only (VK_CAPTURE_HASH=only)
+
+set -e
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+PROJECT_ROOT="$(cd "$SCRIPT_DIR/.." && pwd)"
+cd "$PROJECT_ROOT"
+
+LAYER_LIB="target/release/libVkLayer_PRIVATE_unseen.so"
+BENCH_BIN="target/release/bin/dispatch_bench"
+NULL_ICD="target/release/unseen_null_icd.json"
+for file in "$LAYER_LIB" "$BENCH_BIN" "$NULL_ICD"; do
+    if [ ! -f "$file" ]; then
+        echo "❌ $file not found, run 'make release' first"
+        exit 1
+    fi
+done
+
+export VK_DRIVER_FILES="$PROJECT_ROOT/$NULL_ICD"
+export VK_ICD_FILENAMES="$PROJECT_ROOT/$NULL_ICD"
+
+BENCH_DIR=$(mktemp -d /tmp/unseen_dispatch.XXXXXX)
+trap 'rm -rf "$BENCH_DIR"' EXIT
+cp "$LAYER_LIB" "$BENCH_DIR/"
+sed "s|\\./|$BENCH_DIR/|g" VkLayer_PRIVATE_unseen.json > "$BENCH_DIR/VkLayer_PRIVATE_unseen.json"
+
+echo "Unseen Dispatch Benchmark"
+echo "========================="
+echo
+
+run_mode() {
+    local mode="$1"
+    shift
+    env -u RUST_LOG -u VK_UNSEEN_ENABLE "$@" \
+        VK_LAYER_PATH="$BENCH_DIR" VK_INSTANCE_LAYERS=VK_LAYER_PRIVATE_unseen \
+        VK_CAPTURE_OUTPUT_DIR="$BENCH_DIR/frames_$mode" \
+        "$BENCH_BIN" --iterations "${BENCH_ITERATIONS:-100000}" --label "$mode" $BENCH_ARGS
+}
+
+BENCH_ARGS="$*"
+for mode in ${BENCH_MODES:-off hash}; do
+    case "$mode" in
+        off)  run_mode off VK_CAPTURE_FRAMES=4294967295 ;;
+        hash) run_mode hash VK_CAPTURE_HASH=only ;;
+        *)    echo "❌ Unknown mode: $mode"; exit 1 ;;
+    esac
+done
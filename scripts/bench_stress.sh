@@ -0,0 +1,65 @@
+#!/usr/bin/env bash
+
+# Multithreaded present stress benchmark for the Unseen Vulkan layer
+# Runs target/release/bin/stress_bench on the null driver built from
+# tests/icd and prints aggregate presents/s against the thread count, with
+# a device per thread and with one shared device.
+#
+# Usage: scripts/bench_stress.sh [stress_bench options]
+#   BENCH_THREADS  Comma-separated thread counts (default: 1,2,4,8)
+#   BENCH_SECONDS  Run time per thread count (default: 2)
+#   BENCH_MODES    Modes to run (default: "off hash")
+#
+# Modes:
+#   off   no frame selected for capture
+#   hash  content hashes only (VK_CAPTURE_HASH=only)
+
+set -e
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+PROJECT_ROOT="$(cd "$SCRIPT_DIR/.." && pwd)"
+cd "$PROJECT_ROOT"
+
+LAYER_LIB="target/release/libVkLayer_PRIVATE_unseen.so"
+BENCH_BIN="target/release/bin/stress_bench"
+NULL_ICD="target/release/unseen_null_icd.json"
+for file in "$LAYER_LIB" "$BENCH_BIN" "$NULL_ICD"; do
+    if [ ! -f "$file" ]; then
+        echo "❌ $file not found, run 'make release' first"
+        exit 1
+    fi
+done
+
+export VK_DRIVER_FILES="$PROJECT_ROOT/$NULL_ICD"
+export VK_ICD_FILENAMES="$PROJECT_ROOT/$NULL_ICD"
+
+BENCH_DIR=$(mktemp -d /tmp/unseen_stress.XXXXXX)
+trap 'rm -rf "$BENCH_DIR"' EXIT
+cp "$LAYER_LIB" "$BENCH_DIR/"
+sed "s|\\./|$BENCH_DIR/|g" VkLayer_PRIVATE_unseen.json > "$BENCH_DIR/VkLayer_PRIVATE_unseen.json"
+
+echo "Unseen Stress Benchmark"
+echo "======================="
+echo "CPUs: $(nproc)"
+echo
+
+run_mode() {
+    local mode="$1"
+    shift
+    for sharing in "" --shared-device; do
+        env -u RUST_LOG -u VK_UNSEEN_ENABLE "$@" \
+            VK_LAYER_PATH="$BENCH_DIR" VK_INSTANCE_LAYERS=VK_LAYER_PRIVATE_unseen \
+            VK_CAPTURE_OUTPUT_DIR="$BENCH_DIR/frames_$mode" \
+            "$BENCH_BIN" --threads "${BENCH_THREADS:-1,2,4,8}" --seconds "${BENCH_SECONDS:-2}" \
+            --label "$mode" $sharing $BENCH_ARGS
+    done
+}
+
+BENCH_ARGS="$*"
+for mode in ${BENCH_MODES:-off hash}; do
+    case "$mode" in
+        off)  run_mode off VK_CAPTURE_FRAMES=4294967295 ;;
+        hash) run_mode hash VK_CAPTURE_HASH=only ;;
+        *)    echo "❌ Unknown mode: $mode"; exit 1 ;;
+    esac
+done
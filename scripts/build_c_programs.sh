@@ -62,16 +62,28 @@ for c_file in examples/c/*.c; do
     fi
 done
 
-# Build any other C files in tests/c/
+# Build any other C files in tests/c/, each linked with the shared setup in
+# tests/c/common.c
 for c_file in tests/c/*.c; do
-    if [ -f "$c_file" ] && [ "$(basename "$c_file")" != "direct_test.c" ]; then
+    case "$(basename "$c_file")" in
+        direct_test.c|common.c) continue ;;
+    esac
+    if [ -f "$c_file" ]; then
         base_name=$(basename "$c_file" .c)
         echo "🔨 Building $base_name..."
-        gcc $CFLAGS -o "$BIN_DIR/$base_name" "$c_file" -lvulkan -ldl
+        gcc $CFLAGS -o "$BIN_DIR/$base_name" "$c_file" tests/c/common.c -lvulkan -ldl -pthread
         echo "   ✅ $BIN_DIR/$base_name"
     fi
 done
 
+# Build the null driver used by the dispatch benchmark
+if [ -f "tests/icd/null_icd.c" ]; then
+    echo "🔨 Building null ICD..."
+    gcc $CFLAGS -shared -fPIC -o "$TARGET_DIR/libVkICD_unseen_null.so" tests/icd/null_icd.c
+    cp tests/icd/unseen_null_icd.json "$TARGET_DIR/"
+    echo "   ✅ $TARGET_DIR/libVkICD_unseen_null.so"
+fi
+
 echo
 echo "✅ C programs built successfully"
 echo "📁 Binaries location: $BIN_DIR/"
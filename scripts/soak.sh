@@ -0,0 +1,70 @@
+#!/usr/bin/env bash
+
+# Swapchain soak test for the Unseen Vulkan layer
+# Runs target/release/bin/soak_test through the layer on the null driver
+# built from tests/icd, which counts the memory and objects it holds, and
+# fails if RSS or any of those counts grow over the run.
+#
+# Usage: scripts/soak.sh [soak_test options]
+#   SOAK_ITERATIONS  Create/resize/present/destroy iterations (default: 2000)
+#   SOAK_MODES       Modes to run (default: "off hash")
+#
+# Modes:
+#   off   no frame selected for capture
+#   hash  content hashes only (VK_CAPTURE_HASH=only), so every present
+#         records the capture barrier
+
+set -e
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+PROJECT_ROOT="$(cd "$SCRIPT_DIR/.." && pwd)"
+cd "$PROJECT_ROOT"
+
+LAYER_LIB="target/release/libVkLayer_PRIVATE_unseen.so"
+SOAK_BIN="target/release/bin/soak_test"
+NULL_ICD="target/release/unseen_null_icd.json"
+for file in "$LAYER_LIB" "$SOAK_BIN" "$NULL_ICD"; do
+    if [ ! -f "$file" ]; then
+        echo "❌ $file not found, run 'make release' first"
+        exit 1
+    fi
+done
+
+export VK_DRIVER_FILES="$PROJECT_ROOT/$NULL_ICD"
+export VK_ICD_FILENAMES="$PROJECT_ROOT/$NULL_ICD"
+
+SOAK_DIR=$(mktemp -d /tmp/unseen_soak.XXXXXX)
+trap 'rm -rf "$SOAK_DIR"' EXIT
+cp "$LAYER_LIB" "$SOAK_DIR/"
+sed "s|\\./|$SOAK_DIR/|g" VkLayer_PRIVATE_unseen.json > "$SOAK_DIR/VkLayer_PRIVATE_unseen.json"
+
+echo "Unseen Soak Test"
+echo "================"
+
+run_mode() {
+    local mode="$1"
+    shift
+    echo
+    echo "Mode: $mode"
+    env -u RUST_LOG -u VK_UNSEEN_ENABLE "$@" \
+        VK_LAYER_PATH="$SOAK_DIR" VK_INSTANCE_LAYERS=VK_LAYER_PRIVATE_unseen \
+        VK_CAPTURE_OUTPUT_DIR="$SOAK_DIR/frames_$mode" \
+        "$SOAK_BIN" --iterations "${SOAK_ITERATIONS:-2000}" $SOAK_ARGS
+}
+
+SOAK_ARGS="$*"
+FAILED=""
+for mode in ${SOAK_MODES:-off hash}; do
+    case "$mode" in
+        off)  run_mode off VK_CAPTURE_FRAMES=4294967295 || FAILED="$FAILED $mode" ;;
+        hash) run_mode hash VK_CAPTURE_HASH=only || FAILED="$FAILED $mode" ;;
+        *)    echo "❌ Unknown mode: $mode"; exit 1 ;;
+    esac
+done
+
+echo
+if [ -n "$FAILED" ]; then
+    echo "❌ Growth detected in:$FAILED"
+    exit 1
+fi
+echo "✅ No growth detected"
@@ -0,0 +1,14 @@
+#version 450
+
+// Textured fill for tests/c/render_bench.c
+//
+// Build: glslc -O shaders/render_bench.frag -o shaders/render_bench.frag.spv
+
+layout(set = 0, binding = 0) uniform sampler2D tex;
+
+layout(location = 0) in vec2 uv;
+layout(location = 0) out vec4 colour;
+
+void main() {
+    colour = texture(tex, uv);
+}
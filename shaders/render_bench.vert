@@ -0,0 +1,32 @@
+#version 450
+
+// Triangle field for tests/c/render_bench.c. Each triangle is placed by a
+// hash of its index, so there is no vertex buffer; `time` scrolls the field
+// horizontally so that consecutive frames differ.
+//
+// Build: glslc -O shaders/render_bench.vert -o shaders/render_bench.vert.spv
+
+layout(push_constant) uniform Params {
+    float time;
+    // Half the triangle size in clip space
+    float size;
+} params;
+
+layout(location = 0) out vec2 uv;
+
+void main() {
+    uint triangle = uint(gl_VertexIndex) / 3u;
+    uint corner = uint(gl_VertexIndex) % 3u;
+
+    uint h = triangle * 2654435761u;
+    h ^= h >> 15u;
+    h *= 0x2c1b3c6du;
+    h ^= h >> 13u;
+    vec2 centre = vec2(float(h & 0xffffu), float(h >> 16u)) / 65535.0;
+    centre.x = fract(centre.x + params.time);
+
+    vec2 offset = vec2(corner == 1u ? 1.0 : (corner == 2u ? -1.0 : 0.0),
+                       corner == 0u ? -1.0 : 1.0);
+    gl_Position = vec4(centre * 2.0 - 1.0 + offset * params.size, 0.0, 1.0);
+    uv = offset * 0.5 + 0.5;
+}
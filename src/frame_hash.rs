@@ -0,0 +1,307 @@
+// Frame content hashing
+//
+// A 128-bit non-cryptographic hash of the pixel payload of a frame. The core
+// loop keeps eight independent 64-bit lanes that each accumulate a 32x32->64
+// multiply of the input word (the XXH3 accumulator shape), which the compiler
+// turns into packed multiplies on SSE2/AVX2/NEON. Input is streamed row by
+// row so `row_pitch` padding never enters the hash.
+//
+// Constants are fixed, so hashes are stable across runs and machines and can
+// be compared against a log from a known-good run.
+
+use std::{
+    collections::HashMap,
+    fs::{self, File},
+    io::{LineWriter, Write},
+    sync::Mutex,
+};
+
+const LANES: usize = 8;
+const STRIPE_LEN: usize = LANES * 8;
+// Lanes are scrambled every 1 KiB of input
+const STRIPES_PER_BLOCK: u32 = 16;
+
+const SECRET: [u64; LANES] = [
+    0xbe4b_a423_396c_feb8,
+    0x1cad_21f7_2c81_017c,
+    0xdb97_9083_e96d_d4de,
+    0x1f67_b3b7_a4a4_4072,
+    0x78e5_c0cc_4ee6_79cb,
+    0x2172_ffcc_7dd0_5a82,
+    0x8e24_4857_2a9f_9c4c,
+    0xd8ad_0d6c_f7a3_1c53,
+];
+
+const PRIME32_1: u64 = 0x9e37_79b1;
+const PRIME64_1: u64 = 0x9e37_79b1_85eb_ca87;
+const PRIME64_2: u64 = 0xc2b2_ae3d_27d4_eb4f;
+const PRIME64_3: u64 = 0x1656_67b1_9e37_79f9;
+
+pub struct FrameHasher {
+    acc: [u64; LANES],
+    buf: [u8; STRIPE_LEN],
+    buf_len: usize,
+    stripes: u32,
+    total_len: u64,
+}
+
+impl FrameHasher {
+    pub fn new() -> Self {
+        Self {
+            acc: [
+                PRIME32_1,
+                PRIME64_1,
+                PRIME64_2,
+                PRIME64_3,
+                PRIME64_1 ^ PRIME64_2,
+                PRIME64_2 ^ PRIME64_3,
+                PRIME64_3 ^ PRIME64_1,
+                !PRIME32_1,
+            ],
+            buf: [0; STRIPE_LEN],
+            buf_len: 0,
+            stripes: 0,
+            total_len: 0,
+        }
+    }
+
+    pub fn update(&mut self, mut data: &[u8]) {
+        self.total_len += data.len() as u64;
+
+        // Top up a partially filled stripe from the previous row first
+        if self.buf_len > 0 {
+            let take = (STRIPE_LEN - self.buf_len).min(data.len());
+            self.buf[self.buf_len..self.buf_len + take].copy_from_slice(&data[..take]);
+            self.buf_len += take;
+            data = &data[take..];
+            if self.buf_len < STRIPE_LEN {
+                return;
+            }
+            let stripe = self.buf;
+            self.consume(&stripe);
+            self.buf_len = 0;
+        }
+
+        let mut stripes = data.chunks_exact(STRIPE_LEN);
+        for stripe in &mut stripes {
+            self.consume(stripe.try_into().unwrap());
+        }
+
+        let tail = stripes.remainder();
+        self.buf[..tail.len()].copy_from_slice(tail);
+        self.buf_len = tail.len();
+    }
+
+    #[inline(always)]
+    fn consume(&mut self, stripe: &[u8; STRIPE_LEN]) {
+        for lane in 0..LANES {
+            let word = u64::from_le_bytes(stripe[lane * 8..lane * 8 + 8].try_into().unwrap());
+            let keyed = word ^ SECRET[lane];
+            self.acc[lane ^ 1] = self.acc[lane ^ 1].wrapping_add(word);
+            self.acc[lane] = self.acc[lane].wrapping_add((keyed & 0xffff_ffff) * (keyed >> 32));
+        }
+
+        self.stripes += 1;
+        if self.stripes == STRIPES_PER_BLOCK {
+            self.stripes = 0;
+            for lane in 0..LANES {
+                let acc = self.acc[lane];
+                self.acc[lane] =
+                    (acc ^ (acc >> 47) ^ SECRET[LANES - 1 - lane]).wrapping_mul(PRIME32_1);
+            }
+        }
+    }
+
+    pub fn finish(mut self) -> u128 {
+        if self.buf_len > 0 {
+            self.buf[self.buf_len..].fill(0);
+            let stripe = self.buf;
+            self.consume(&stripe);
+        }
+
+        let mut low = self.total_len.wrapping_mul(PRIME64_1);
+        let mut high = (!self.total_len).wrapping_mul(PRIME64_2);
+        for pair in 0..LANES / 2 {
+            let a = self.acc[2 * pair];
+            let b = self.acc[2 * pair + 1];
+            low = low.wrapping_add(fold_mul(a ^ SECRET[pair], b ^ SECRET[pair + 4]));
+            high = high.wrapping_add(fold_mul(a ^ SECRET[7 - pair], b ^ SECRET[3 - pair]));
+        }
+
+        ((avalanche(high) as u128) << 64) | avalanche(low) as u128
+    }
+}
+
+fn fold_mul(a: u64, b: u64) -> u64 {
+    let product = (a as u128) * (b as u128);
+    (product as u64) ^ ((product >> 64) as u64)
+}
+
+fn avalanche(mut h: u64) -> u64 {
+    h ^= h >> 37;
+    h = h.wrapping_mul(0x1656_6791_9e37_79f9);
+    h ^ (h >> 32)
+}
+
+// Result of checking a frame hash against the reference run
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum HashVerdict {
+    // No reference log configured
+    Unchecked,
+    Match,
+    Mismatch,
+    // The reference run has no entry for this frame
+    Missing,
+}
+
+// Append-only `<frame> <hash>` log, one line per captured frame plus one
+// per run of suppressed duplicates
+pub struct HashLog {
+    writer: Mutex<LineWriter<File>>,
+    reference: HashMap<u32, u128>,
+}
+
+impl HashLog {
+    pub fn create(path: &str, reference_path: Option<&str>) -> Result<Self, std::io::Error> {
+        let reference = match reference_path {
+            Some(reference_path) => parse_hash_log(&fs::read_to_string(reference_path)?),
+            None => HashMap::new(),
+        };
+
+        Ok(Self {
+            writer: Mutex::new(LineWriter::new(File::create(path)?)),
+            reference,
+        })
+    }
+
+    pub fn has_reference(&self) -> bool {
+        !self.reference.is_empty()
+    }
+
+    // Compares against the reference run without logging anything
+    pub fn check(&self, frame_num: u32, hash: u128) -> HashVerdict {
+        if !self.has_reference() {
+            return HashVerdict::Unchecked;
+        }
+        match self.reference.get(&frame_num) {
+            Some(&expected) if expected == hash => HashVerdict::Match,
+            Some(_) => HashVerdict::Mismatch,
+            None => HashVerdict::Missing,
+        }
+    }
+
+    pub fn record(&self, frame_num: u32, hash: u128) -> HashVerdict {
+        let verdict = self.check(frame_num, hash);
+        self.write(frame_num, hash, verdict);
+        verdict
+    }
+
+    // Logs a hash already checked with `check`
+    pub fn write(&self, frame_num: u32, hash: u128, verdict: HashVerdict) {
+        let mut writer = self.writer.lock().unwrap();
+        let result = match verdict {
+            HashVerdict::Unchecked | HashVerdict::Match => {
+                writeln!(writer, "{:06} {:032x}", frame_num, hash)
+            }
+            HashVerdict::Mismatch => writeln!(writer, "{:06} {:032x} mismatch", frame_num, hash),
+            HashVerdict::Missing => writeln!(writer, "{:06} {:032x} missing", frame_num, hash),
+        };
+        if let Err(e) = result {
+            log::error!("Failed to write hash for frame {}: {}", frame_num, e);
+        }
+    }
+
+    // Notes that the content of `frame_num` was presented `repeats` more times
+    pub fn record_repeats(&self, frame_num: u32, hash: u128, repeats: u32) {
+        let mut writer = self.writer.lock().unwrap();
+        if let Err(e) = writeln!(writer, "{:06} {:032x} repeats {}", frame_num, hash, repeats) {
+            log::error!(
+                "Failed to write repeat count for frame {}: {}",
+                frame_num,
+                e
+            );
+        }
+    }
+}
+
+// Parses `<frame> <hash> [...]` lines, skipping anything malformed
+fn parse_hash_log(contents: &str) -> HashMap<u32, u128> {
+    contents
+        .lines()
+        .filter_map(|line| {
+            let mut fields = line.split_whitespace();
+            let frame = fields.next()?.parse().ok()?;
+            let hash = u128::from_str_radix(fields.next()?, 16).ok()?;
+            Some((frame, hash))
+        })
+        .collect()
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn hash(chunks: &[&[u8]]) -> u128 {
+        let mut hasher = FrameHasher::new();
+        for chunk in chunks {
+            hasher.update(chunk);
+        }
+        hasher.finish()
+    }
+
+    #[test]
+    fn row_splits_do_not_change_the_hash() {
+        let data: Vec<u8> = (0..5000u32).map(|i| (i * 7 + i / 13) as u8).collect();
+        let whole = hash(&[&data]);
+        assert_eq!(whole, hash(&[&data[..1], &data[1..63], &data[63..]]));
+        assert_eq!(whole, hash(&data.chunks(100).collect::<Vec<_>>()));
+    }
+
+    #[test]
+    fn content_and_length_change_the_hash() {
+        let data = vec![0u8; 2048];
+        let mut changed = data.clone();
+        changed[1500] = 1;
+        assert_ne!(hash(&[&data]), hash(&[&changed]));
+        // Zero padding of the last stripe is distinguished by the length
+        assert_ne!(hash(&[&data[..100]]), hash(&[&data[..101]]));
+        assert_ne!(hash(&[]), hash(&[&data[..1]]));
+    }
+
+    #[test]
+    fn parses_reference_logs() {
+        let reference = parse_hash_log(
+            "000001 00000000000000000000000000000abc\n\
+             000002 ff repeats 3\n\
+             garbage\n\
+             000003 not-hex\n",
+        );
+        assert_eq!(reference.len(), 2);
+        assert_eq!(reference[&1], 0xabc);
+        assert_eq!(reference[&2], 0xff);
+    }
+
+    #[test]
+    fn verdicts_against_a_reference() {
+        let dir = std::env::temp_dir().join(format!("unseen_hash_log_{}", std::process::id()));
+        fs::create_dir_all(&dir).unwrap();
+        let reference_path = dir.join("reference.log");
+        fs::write(&reference_path, "000000 1\n000001 2\n").unwrap();
+        let log_path = dir.join("frame_hashes.log");
+
+        let log = HashLog::create(
+            log_path.to_str().unwrap(),
+            Some(reference_path.to_str().unwrap()),
+        )
+        .unwrap();
+        assert_eq!(log.record(0, 1), HashVerdict::Match);
+        assert_eq!(log.record(1, 3), HashVerdict::Mismatch);
+        assert_eq!(log.record(2, 1), HashVerdict::Missing);
+        drop(log);
+
+        let written = fs::read_to_string(&log_path).unwrap();
+        assert_eq!(written.lines().count(), 3);
+        assert!(written.lines().nth(1).unwrap().ends_with(" mismatch"));
+        fs::remove_dir_all(&dir).unwrap();
+    }
+}
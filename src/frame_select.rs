@@ -0,0 +1,225 @@
+// Frame selection for capture
+//
+// A selection spec is a comma-separated list of terms:
+//   N        - a single frame
+//   A-B      - frames A through B (inclusive)
+//   A-       - every frame from A onwards
+//   A-B:S    - every S-th frame from A through B
+//   A-:S     - every S-th frame from A onwards
+//
+// e.g. `100-200,500,1000-:10`. The spec is compiled once when the layer is
+// configured; matching a frame is a binary search over merged contiguous
+// intervals plus a short scan over the stepped ranges.
+
+#[derive(Debug, Clone, Copy, PartialEq)]
+struct FrameRange {
+    start: u32,
+    // Inclusive; u32::MAX for open-ended ranges
+    end: u32,
+    step: u32,
+}
+
+#[derive(Debug, Clone)]
+pub struct FrameSelector {
+    // Non-overlapping, sorted, step 1
+    intervals: Vec<(u32, u32)>,
+    // Ranges with step > 1, sorted by start
+    stepped: Vec<FrameRange>,
+    // Highest frame that can ever match, None if the selection never ends
+    last_frame: Option<u32>,
+}
+
+impl FrameSelector {
+    // Equivalent of the `capture_frequency`/`max_frames` pair:
+    // every `frequency`-th frame below `max_frames` (0 = unlimited)
+    pub fn from_frequency(frequency: u32, max_frames: u32) -> Self {
+        let end = if max_frames == 0 {
+            u32::MAX
+        } else {
+            max_frames - 1
+        };
+        Self::compile(vec![FrameRange {
+            start: 0,
+            end,
+            step: frequency.max(1),
+        }])
+    }
+
+    pub fn parse(spec: &str) -> Result<Self, String> {
+        let mut ranges = Vec::new();
+
+        for term in spec.split(',').map(str::trim) {
+            if term.is_empty() {
+                continue;
+            }
+
+            let (span, step) = match term.split_once(':') {
+                Some((span, step)) => {
+                    let step: u32 = step
+                        .trim()
+                        .parse()
+                        .map_err(|_| format!("invalid step in '{}'", term))?;
+                    if step == 0 {
+                        return Err(format!("step must be positive in '{}'", term));
+                    }
+                    (span.trim(), step)
+                }
+                None => (term, 1),
+            };
+
+            let parse_frame = |s: &str| {
+                s.trim()
+                    .parse::<u32>()
+                    .map_err(|_| format!("invalid frame number in '{}'", term))
+            };
+
+            let (start, end) = match span.split_once('-') {
+                Some((start, end)) if end.trim().is_empty() => (parse_frame(start)?, u32::MAX),
+                Some((start, end)) => (parse_frame(start)?, parse_frame(end)?),
+                None if step == 1 => {
+                    let frame = parse_frame(span)?;
+                    (frame, frame)
+                }
+                None => return Err(format!("step requires a range in '{}'", term)),
+            };
+
+            if end < start {
+                return Err(format!("range end before start in '{}'", term));
+            }
+
+            ranges.push(FrameRange { start, end, step });
+        }
+
+        if ranges.is_empty() {
+            return Err("empty frame selection".to_string());
+        }
+
+        Ok(Self::compile(ranges))
+    }
+
+    fn compile(mut ranges: Vec<FrameRange>) -> Self {
+        ranges.sort_by_key(|r| (r.start, r.end));
+
+        let last_frame = ranges
+            .iter()
+            .map(|r| r.end)
+            .max()
+            .filter(|&end| end != u32::MAX);
+
+        let mut intervals: Vec<(u32, u32)> = Vec::new();
+        let mut stepped = Vec::new();
+        for range in ranges {
+            if range.step > 1 && range.start != range.end {
+                stepped.push(range);
+                continue;
+            }
+            match intervals.last_mut() {
+                Some(last) if range.start <= last.1.saturating_add(1) => {
+                    last.1 = last.1.max(range.end);
+                }
+                _ => intervals.push((range.start, range.end)),
+            }
+        }
+
+        Self {
+            intervals,
+            stepped,
+            last_frame,
+        }
+    }
+
+    pub fn matches(&self, frame: u32) -> bool {
+        if self.is_exhausted(frame) {
+            return false;
+        }
+
+        let idx = self.intervals.partition_point(|&(start, _)| start <= frame);
+        if idx > 0 && frame <= self.intervals[idx - 1].1 {
+            return true;
+        }
+
+        self.stepped
+            .iter()
+            .take_while(|r| r.start <= frame)
+            .any(|r| frame <= r.end && (frame - r.start) % r.step == 0)
+    }
+
+    // True once no frame at or after `frame` can match
+    pub fn is_exhausted(&self, frame: u32) -> bool {
+        matches!(self.last_frame, Some(last) if frame > last)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn selected(selector: &FrameSelector, frames: std::ops::Range<u32>) -> Vec<u32> {
+        frames.filter(|&frame| selector.matches(frame)).collect()
+    }
+
+    #[test]
+    fn single_frames_and_ranges() {
+        let selector = FrameSelector::parse("3, 5-7,10").unwrap();
+        assert_eq!(selected(&selector, 0..20), [3, 5, 6, 7, 10]);
+        assert!(selector.is_exhausted(11));
+        assert!(!selector.is_exhausted(10));
+    }
+
+    #[test]
+    fn overlapping_ranges_merge() {
+        let selector = FrameSelector::parse("10-20,5-12,21-22,15").unwrap();
+        assert_eq!(selector.intervals, [(5, 22)]);
+        assert_eq!(selected(&selector, 0..30), (5..=22).collect::<Vec<_>>());
+    }
+
+    #[test]
+    fn open_ended_range() {
+        let selector = FrameSelector::parse("100-").unwrap();
+        assert!(!selector.matches(99));
+        assert!(selector.matches(100));
+        assert!(selector.matches(u32::MAX));
+        assert!(!selector.is_exhausted(u32::MAX));
+    }
+
+    #[test]
+    fn stepped_ranges() {
+        let selector = FrameSelector::parse("0-10:5,20-:7").unwrap();
+        assert_eq!(selected(&selector, 0..45), [0, 5, 10, 20, 27, 34, 41]);
+        assert!(!selector.is_exhausted(1_000_000));
+    }
+
+    #[test]
+    fn stepped_and_contiguous_ranges_combine() {
+        let selector = FrameSelector::parse("0-20:10,4-5").unwrap();
+        assert_eq!(selected(&selector, 0..30), [0, 4, 5, 10, 20]);
+    }
+
+    #[test]
+    fn frequency_equivalent() {
+        let selector = FrameSelector::from_frequency(3, 10);
+        assert_eq!(selected(&selector, 0..20), [0, 3, 6, 9]);
+        assert!(selector.is_exhausted(10));
+
+        let unlimited = FrameSelector::from_frequency(0, 0);
+        assert_eq!(selected(&unlimited, 0..4), [0, 1, 2, 3]);
+    }
+
+    #[test]
+    fn malformed_specs() {
+        for spec in [
+            "",
+            " , ",
+            "abc",
+            "5-3",
+            "1-2:0",
+            "1-2:x",
+            "7:2",
+            "-5",
+            "1-2-3",
+            "4294967296",
+        ] {
+            assert!(FrameSelector::parse(spec).is_err(), "accepted '{}'", spec);
+        }
+    }
+}
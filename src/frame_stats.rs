@@ -0,0 +1,232 @@
+// Per-frame image statistics
+//
+// Statistics are gathered in one pass over the mapped image, two loops per
+// row: a branch-free loop the compiler can vectorize accumulates per-channel
+// sums, squared sums and min/max, then a histogram loop runs over the same
+// row while it is still in L1. Frames go to a CSV or fixed-size binary log,
+// so soak tests can watch for black, frozen or miscoloured output without
+// storing any pixels.
+//
+// Binary records are little-endian, 116 bytes each:
+//   u64 swapchain, u32 frame, u32 width, u32 height,
+//   f32 mean[3], f32 variance[3], u8 min[3], u8 max[3], u16 padding,
+//   u32 luma_histogram[16]
+// with channels in R, G, B order.
+
+use std::{
+    fs::File,
+    io::{BufWriter, Write},
+    sync::Mutex,
+};
+
+pub const HISTOGRAM_BINS: usize = 16;
+
+#[derive(Debug, Clone)]
+pub struct FrameStats {
+    pub mean: [f64; 3],
+    pub variance: [f64; 3],
+    pub min: [u8; 3],
+    pub max: [u8; 3],
+    pub luma_histogram: [u32; HISTOGRAM_BINS],
+}
+
+pub struct StatsAccumulator {
+    // Byte offsets of R, G and B within a pixel
+    channels: [usize; 3],
+    bytes_per_pixel: usize,
+    sum: [u64; 3],
+    sum_sq: [u64; 3],
+    min: [u8; 3],
+    max: [u8; 3],
+    histogram: [u32; 256],
+    pixels: u64,
+}
+
+impl StatsAccumulator {
+    pub fn new(bytes_per_pixel: usize, channels: [usize; 3]) -> Self {
+        Self {
+            channels,
+            bytes_per_pixel,
+            sum: [0; 3],
+            sum_sq: [0; 3],
+            min: [u8::MAX; 3],
+            max: [0; 3],
+            histogram: [0; 256],
+            pixels: 0,
+        }
+    }
+
+    pub fn add_row(&mut self, row: &[u8]) {
+        match self.bytes_per_pixel {
+            4 => self.add_pixels::<4>(row),
+            3 => self.add_pixels::<3>(row),
+            _ => {}
+        }
+    }
+
+    #[inline(always)]
+    fn add_pixels<const BPP: usize>(&mut self, row: &[u8]) {
+        let [r, g, b] = self.channels;
+
+        // Row sums fit in u32 for any width up to 65535 pixels
+        let mut sum = [0u32; BPP];
+        let mut sum_sq = [0u32; BPP];
+        let mut min = [u8::MAX; BPP];
+        let mut max = [0u8; BPP];
+        for pixel in row.chunks_exact(BPP) {
+            for c in 0..BPP {
+                let v = pixel[c];
+                sum[c] += v as u32;
+                sum_sq[c] += v as u32 * v as u32;
+                min[c] = min[c].min(v);
+                max[c] = max[c].max(v);
+            }
+        }
+
+        for (i, &c) in [r, g, b].iter().enumerate() {
+            self.sum[i] += sum[c] as u64;
+            self.sum_sq[i] += sum_sq[c] as u64;
+            self.min[i] = self.min[i].min(min[c]);
+            self.max[i] = self.max[i].max(max[c]);
+        }
+
+        for pixel in row.chunks_exact(BPP) {
+            let luma = (77 * pixel[r] as u32 + 150 * pixel[g] as u32 + 29 * pixel[b] as u32) >> 8;
+            self.histogram[luma as usize] += 1;
+        }
+
+        self.pixels += (row.len() / BPP) as u64;
+    }
+
+    pub fn finish(self) -> FrameStats {
+        let n = self.pixels.max(1) as f64;
+        let mut mean = [0.0; 3];
+        let mut variance = [0.0; 3];
+        for c in 0..3 {
+            mean[c] = self.sum[c] as f64 / n;
+            variance[c] = (self.sum_sq[c] as f64 / n - mean[c] * mean[c]).max(0.0);
+        }
+
+        let mut luma_histogram = [0u32; HISTOGRAM_BINS];
+        for (luma, &count) in self.histogram.iter().enumerate() {
+            luma_histogram[luma * HISTOGRAM_BINS / 256] += count;
+        }
+
+        FrameStats {
+            mean,
+            variance,
+            min: if self.pixels > 0 { self.min } else { [0; 3] },
+            max: self.max,
+            luma_histogram,
+        }
+    }
+}
+
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum StatsFormat {
+    Csv,
+    Binary,
+}
+
+pub struct StatsLog {
+    writer: Mutex<BufWriter<File>>,
+    format: StatsFormat,
+}
+
+impl StatsLog {
+    pub fn create(path: &str, format: StatsFormat) -> Result<Self, std::io::Error> {
+        let mut writer = BufWriter::new(File::create(path)?);
+        if format == StatsFormat::Csv {
+            write!(
+                writer,
+                "swapchain,frame,width,height,mean_r,mean_g,mean_b,var_r,var_g,var_b,\
+                 min_r,min_g,min_b,max_r,max_g,max_b"
+            )?;
+            for bin in 0..HISTOGRAM_BINS {
+                write!(writer, ",luma_{}", bin)?;
+            }
+            writeln!(writer)?;
+        }
+
+        Ok(Self {
+            writer: Mutex::new(writer),
+            format,
+        })
+    }
+
+    pub fn record(
+        &self,
+        swapchain: u64,
+        frame_num: u32,
+        width: u32,
+        height: u32,
+        stats: &FrameStats,
+    ) {
+        let mut writer = self.writer.lock().unwrap();
+        let result = match self.format {
+            StatsFormat::Csv => {
+                write_csv_row(&mut *writer, swapchain, frame_num, width, height, stats)
+            }
+            StatsFormat::Binary => {
+                write_binary_row(&mut *writer, swapchain, frame_num, width, height, stats)
+            }
+        };
+        // Rows are small; flushing each keeps the log current for long soak runs
+        if let Err(e) = result.and_then(|_| writer.flush()) {
+            log::error!("Failed to write stats for frame {}: {}", frame_num, e);
+        }
+    }
+}
+
+fn write_csv_row(
+    writer: &mut impl Write,
+    swapchain: u64,
+    frame_num: u32,
+    width: u32,
+    height: u32,
+    stats: &FrameStats,
+) -> Result<(), std::io::Error> {
+    write!(
+        writer,
+        "{:#x},{},{},{}",
+        swapchain, frame_num, width, height
+    )?;
+    for mean in stats.mean {
+        write!(writer, ",{:.3}", mean)?;
+    }
+    for variance in stats.variance {
+        write!(writer, ",{:.3}", variance)?;
+    }
+    for value in stats.min.iter().chain(&stats.max) {
+        write!(writer, ",{}", value)?;
+    }
+    for count in stats.luma_histogram {
+        write!(writer, ",{}", count)?;
+    }
+    writeln!(writer)
+}
+
+fn write_binary_row(
+    writer: &mut impl Write,
+    swapchain: u64,
+    frame_num: u32,
+    width: u32,
+    height: u32,
+    stats: &FrameStats,
+) -> Result<(), std::io::Error> {
+    let mut record = Vec::with_capacity(116);
+    record.extend_from_slice(&swapchain.to_le_bytes());
+    record.extend_from_slice(&frame_num.to_le_bytes());
+    record.extend_from_slice(&width.to_le_bytes());
+    record.extend_from_slice(&height.to_le_bytes());
+    for value in stats.mean.iter().chain(&stats.variance) {
+        record.extend_from_slice(&(*value as f32).to_le_bytes());
+    }
+    record.extend_from_slice(&stats.min);
+    record.extend_from_slice(&stats.max);
+    record.extend_from_slice(&[0, 0]);
+    for count in stats.luma_histogram {
+        record.extend_from_slice(&count.to_le_bytes());
+    }
+    writer.write_all(&record)
+}
@@ -0,0 +1,484 @@
+// Golden-image comparison
+//
+// A reference set of `frame_NNNNNN.ppm` files (as written by this layer) is
+// memory-mapped once when the instance is created. Each captured frame is
+// compared against its reference in-layer: PSNR over the RGB payload and a
+// block SSIM over luma. Only frames outside the tolerance are written, along
+// with a diff image; every comparison gets one line in the report.
+
+use std::{
+    collections::HashMap,
+    fs::{self, File},
+    io::{LineWriter, Write},
+    os::unix::io::AsRawFd,
+    ptr, slice,
+    sync::Mutex,
+};
+
+const SSIM_BLOCK: usize = 8;
+// Bytes per partial sum in the squared-error kernel; 255^2 * 4096 fits in u32
+const SSE_CHUNK: usize = 4096;
+
+// Read-only mapping of a whole file
+struct MappedFile {
+    ptr: *const u8,
+    len: usize,
+}
+
+// Safety: the mapping is read-only and lives until the MappedFile is dropped
+unsafe impl Send for MappedFile {}
+unsafe impl Sync for MappedFile {}
+
+impl MappedFile {
+    fn open(path: &std::path::Path) -> Result<Self, std::io::Error> {
+        let file = File::open(path)?;
+        let len = file.metadata()?.len() as usize;
+        if len == 0 {
+            return Err(std::io::Error::new(
+                std::io::ErrorKind::InvalidData,
+                "empty file",
+            ));
+        }
+
+        let ptr = unsafe {
+            libc::mmap(
+                ptr::null_mut(),
+                len,
+                libc::PROT_READ,
+                libc::MAP_PRIVATE,
+                file.as_raw_fd(),
+                0,
+            )
+        };
+        if ptr == libc::MAP_FAILED {
+            return Err(std::io::Error::last_os_error());
+        }
+
+        Ok(Self {
+            ptr: ptr as *const u8,
+            len,
+        })
+    }
+
+    fn bytes(&self) -> &[u8] {
+        unsafe { slice::from_raw_parts(self.ptr, self.len) }
+    }
+}
+
+impl Drop for MappedFile {
+    fn drop(&mut self) {
+        unsafe {
+            libc::munmap(self.ptr as *mut libc::c_void, self.len);
+        }
+    }
+}
+
+struct GoldenFrame {
+    file: MappedFile,
+    width: u32,
+    height: u32,
+    // Offset of the RGB payload within the file
+    data_offset: usize,
+}
+
+impl GoldenFrame {
+    fn pixels(&self) -> &[u8] {
+        let len = rgb_len(self.width, self.height).unwrap_or(0);
+        &self.file.bytes()[self.data_offset..self.data_offset + len]
+    }
+}
+
+#[derive(Debug, Clone, Copy)]
+pub struct FrameComparison {
+    pub psnr: f64,
+    pub ssim: f64,
+    pub max_diff: u8,
+}
+
+pub enum GoldenVerdict {
+    Pass(FrameComparison),
+    Fail(FrameComparison),
+    // No reference for this frame
+    Missing,
+    SizeMismatch,
+}
+
+pub struct GoldenSet {
+    frames: HashMap<u32, GoldenFrame>,
+    min_psnr: f64,
+    min_ssim: f64,
+    report: Mutex<LineWriter<File>>,
+}
+
+impl GoldenSet {
+    pub fn load(
+        golden_dir: &str,
+        report_path: &str,
+        min_psnr: f64,
+        min_ssim: f64,
+    ) -> Result<Self, std::io::Error> {
+        let mut frames = HashMap::new();
+
+        for entry in fs::read_dir(golden_dir)? {
+            let path = entry?.path();
+            let frame_num = match path
+                .file_name()
+                .and_then(|name| name.to_str())
+                .and_then(|name| name.strip_prefix("frame_"))
+                .and_then(|name| name.strip_suffix(".ppm"))
+                .and_then(|num| num.parse::<u32>().ok())
+            {
+                Some(frame_num) => frame_num,
+                None => continue,
+            };
+
+            let file = match MappedFile::open(&path) {
+                Ok(file) => file,
+                Err(e) => {
+                    log::warn!("Skipping golden frame {}: {}", path.display(), e);
+                    continue;
+                }
+            };
+            match parse_ppm_header(file.bytes()) {
+                Some((width, height, data_offset)) => {
+                    frames.insert(
+                        frame_num,
+                        GoldenFrame {
+                            file,
+                            width,
+                            height,
+                            data_offset,
+                        },
+                    );
+                }
+                None => log::warn!("Skipping golden frame {}: not a P6 PPM", path.display()),
+            }
+        }
+
+        let mut report = LineWriter::new(File::create(report_path)?);
+        writeln!(report, "# frame psnr_db ssim max_diff result")?;
+
+        log::info!("Loaded {} golden frames from {}", frames.len(), golden_dir);
+        Ok(Self {
+            frames,
+            min_psnr,
+            min_ssim,
+            report: Mutex::new(report),
+        })
+    }
+
+    // Compares an RGB frame with its reference and records the result
+    pub fn check(&self, frame_num: u32, pixels: &[u8], width: u32, height: u32) -> GoldenVerdict {
+        let verdict = match self.frames.get(&frame_num) {
+            None => GoldenVerdict::Missing,
+            Some(golden) if golden.width != width || golden.height != height => {
+                GoldenVerdict::SizeMismatch
+            }
+            Some(golden) => {
+                let comparison = compare_rgb(golden.pixels(), pixels, width, height);
+                if comparison.psnr >= self.min_psnr && comparison.ssim >= self.min_ssim {
+                    GoldenVerdict::Pass(comparison)
+                } else {
+                    GoldenVerdict::Fail(comparison)
+                }
+            }
+        };
+
+        let mut report = self.report.lock().unwrap();
+        let result = match &verdict {
+            GoldenVerdict::Pass(c) | GoldenVerdict::Fail(c) => writeln!(
+                report,
+                "{:06} {:.2} {:.5} {} {}",
+                frame_num,
+                c.psnr,
+                c.ssim,
+                c.max_diff,
+                if matches!(verdict, GoldenVerdict::Pass(_)) {
+                    "pass"
+                } else {
+                    "fail"
+                }
+            ),
+            GoldenVerdict::Missing => writeln!(report, "{:06} - - - missing", frame_num),
+            GoldenVerdict::SizeMismatch => writeln!(report, "{:06} - - - size_mismatch", frame_num),
+        };
+        if let Err(e) = result {
+            log::error!(
+                "Failed to write golden report for frame {}: {}",
+                frame_num,
+                e
+            );
+        }
+
+        verdict
+    }
+
+    // Amplified per-channel absolute difference against the reference
+    pub fn diff_image(&self, frame_num: u32, pixels: &[u8]) -> Option<Vec<u8>> {
+        let golden = self.frames.get(&frame_num)?;
+        let reference = golden.pixels();
+        if reference.len() != pixels.len() {
+            return None;
+        }
+
+        Some(
+            reference
+                .iter()
+                .zip(pixels)
+                .map(|(&a, &b)| a.abs_diff(b).saturating_mul(8))
+                .collect(),
+        )
+    }
+}
+
+// Parses a binary PPM header, returning (width, height, payload offset)
+fn parse_ppm_header(data: &[u8]) -> Option<(u32, u32, usize)> {
+    if !data.starts_with(b"P6") {
+        return None;
+    }
+
+    let mut pos = 2;
+    let mut fields = [0u32; 3];
+    for field in &mut fields {
+        // Skip whitespace and comments
+        loop {
+            match data.get(pos)? {
+                b'#' => {
+                    while *data.get(pos)? != b'\n' {
+                        pos += 1;
+                    }
+                }
+                c if c.is_ascii_whitespace() => pos += 1,
+                _ => break,
+            }
+        }
+        let start = pos;
+        while data.get(pos)?.is_ascii_digit() {
+            pos += 1;
+        }
+        *field = std::str::from_utf8(&data[start..pos]).ok()?.parse().ok()?;
+    }
+
+    let [width, height, max_value] = fields;
+    // A single whitespace byte separates the header from the payload
+    let data_offset = pos + 1;
+    let end = data_offset.checked_add(rgb_len(width, height)?)?;
+    if max_value != 255 || data.len() < end {
+        return None;
+    }
+    Some((width, height, data_offset))
+}
+
+// Bytes of an RGB payload, None if it can't be addressed
+fn rgb_len(width: u32, height: u32) -> Option<usize> {
+    (width as usize)
+        .checked_mul(height as usize)?
+        .checked_mul(3)
+}
+
+fn compare_rgb(reference: &[u8], pixels: &[u8], width: u32, height: u32) -> FrameComparison {
+    let len = reference.len().min(pixels.len());
+    let (reference, pixels) = (&reference[..len], &pixels[..len]);
+
+    // Squared error and max difference; the fixed-size chunks keep the inner
+    // loop branch-free so it compiles to packed multiply-adds
+    let mut sse = 0u64;
+    let mut max_diff = 0u8;
+    for (a, b) in reference.chunks(SSE_CHUNK).zip(pixels.chunks(SSE_CHUNK)) {
+        let mut chunk_sse = 0u32;
+        let mut chunk_max = 0u8;
+        for (&x, &y) in a.iter().zip(b) {
+            let d = x.abs_diff(y);
+            chunk_sse += d as u32 * d as u32;
+            chunk_max = chunk_max.max(d);
+        }
+        sse += chunk_sse as u64;
+        max_diff = max_diff.max(chunk_max);
+    }
+
+    let psnr = if sse == 0 {
+        f64::INFINITY
+    } else {
+        let mse = sse as f64 / len as f64;
+        10.0 * (255.0 * 255.0 / mse).log10()
+    };
+
+    let ssim = if sse == 0 {
+        1.0
+    } else {
+        luma_ssim(
+            &rgb_to_luma(reference),
+            &rgb_to_luma(pixels),
+            width as usize,
+            height as usize,
+        )
+    };
+
+    FrameComparison {
+        psnr,
+        ssim,
+        max_diff,
+    }
+}
+
+fn rgb_to_luma(rgb: &[u8]) -> Vec<u8> {
+    rgb.chunks_exact(3)
+        .map(|p| ((77 * p[0] as u32 + 150 * p[1] as u32 + 29 * p[2] as u32) >> 8) as u8)
+        .collect()
+}
+
+// Mean SSIM over non-overlapping 8x8 blocks. Sums for a whole row of blocks
+// are accumulated together so the per-row loop runs over contiguous bytes.
+// A frame too small for one block is compared as a single block.
+fn luma_ssim(x: &[u8], y: &[u8], width: usize, height: usize) -> f64 {
+    const N: f64 = (SSIM_BLOCK * SSIM_BLOCK) as f64;
+
+    let blocks_x = width / SSIM_BLOCK;
+    let blocks_y = height / SSIM_BLOCK;
+    if blocks_x == 0 || blocks_y == 0 {
+        return whole_frame_ssim(x, y, width * height);
+    }
+
+    let mut sx = vec![0u32; blocks_x];
+    let mut sy = vec![0u32; blocks_x];
+    let mut sxx = vec![0u32; blocks_x];
+    let mut syy = vec![0u32; blocks_x];
+    let mut sxy = vec![0u32; blocks_x];
+    let mut total = 0.0;
+
+    for by in 0..blocks_y {
+        for sums in [&mut sx, &mut sy, &mut sxx, &mut syy, &mut sxy] {
+            sums.fill(0);
+        }
+
+        for row in by * SSIM_BLOCK..(by + 1) * SSIM_BLOCK {
+            let row_x = &x[row * width..row * width + blocks_x * SSIM_BLOCK];
+            let row_y = &y[row * width..row * width + blocks_x * SSIM_BLOCK];
+            for bx in 0..blocks_x {
+                let bx_x = &row_x[bx * SSIM_BLOCK..(bx + 1) * SSIM_BLOCK];
+                let bx_y = &row_y[bx * SSIM_BLOCK..(bx + 1) * SSIM_BLOCK];
+                for (&a, &b) in bx_x.iter().zip(bx_y) {
+                    let (a, b) = (a as u32, b as u32);
+                    sx[bx] += a;
+                    sy[bx] += b;
+                    sxx[bx] += a * a;
+                    syy[bx] += b * b;
+                    sxy[bx] += a * b;
+                }
+            }
+        }
+
+        for bx in 0..blocks_x {
+            total += block_ssim(
+                [sx[bx], sy[bx], sxx[bx], syy[bx], sxy[bx]].map(|sum| sum as f64),
+                N,
+            );
+        }
+    }
+
+    total / (blocks_x * blocks_y) as f64
+}
+
+fn whole_frame_ssim(x: &[u8], y: &[u8], pixels: usize) -> f64 {
+    let (x, y) = (&x[..pixels], &y[..pixels]);
+    if pixels == 0 || x == y {
+        return 1.0;
+    }
+
+    let mut sums = [0u64; 5];
+    for (&a, &b) in x.iter().zip(y) {
+        let (a, b) = (a as u64, b as u64);
+        sums[0] += a;
+        sums[1] += b;
+        sums[2] += a * a;
+        sums[3] += b * b;
+        sums[4] += a * b;
+    }
+    block_ssim(sums.map(|sum| sum as f64), pixels as f64)
+}
+
+// SSIM of one block from its sums of x, y, x^2, y^2 and xy over `n` pixels
+fn block_ssim([sx, sy, sxx, syy, sxy]: [f64; 5], n: f64) -> f64 {
+    const C1: f64 = (0.01 * 255.0) * (0.01 * 255.0);
+    const C2: f64 = (0.03 * 255.0) * (0.03 * 255.0);
+
+    let mean_x = sx / n;
+    let mean_y = sy / n;
+    let var_x = sxx / n - mean_x * mean_x;
+    let var_y = syy / n - mean_y * mean_y;
+    let cov = sxy / n - mean_x * mean_y;
+    ((2.0 * mean_x * mean_y + C1) * (2.0 * cov + C2))
+        / ((mean_x * mean_x + mean_y * mean_y + C1) * (var_x + var_y + C2))
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn ppm(header: &str, payload: usize) -> Vec<u8> {
+        let mut data = header.as_bytes().to_vec();
+        data.resize(data.len() + payload, 0);
+        data
+    }
+
+    #[test]
+    fn parses_ppm_headers() {
+        let data = ppm("P6\n# written by unseen\n4 2\n255\n", 24);
+        let (width, height, offset) = parse_ppm_header(&data).unwrap();
+        assert_eq!((width, height), (4, 2));
+        assert_eq!(&data[offset - 4..offset], b"255\n");
+    }
+
+    #[test]
+    fn rejects_bad_ppm_headers() {
+        // Short payload, wrong max value, wrong magic, truncated header
+        assert!(parse_ppm_header(&ppm("P6\n4 2\n255\n", 23)).is_none());
+        assert!(parse_ppm_header(&ppm("P6\n4 2\n65535\n", 48)).is_none());
+        assert!(parse_ppm_header(&ppm("P3\n4 2\n255\n", 24)).is_none());
+        assert!(parse_ppm_header(b"P6\n4 2").is_none());
+        // Dimensions whose payload overflows 32 bits
+        assert!(parse_ppm_header(&ppm("P6\n4294967295 4294967295\n255\n", 16)).is_none());
+        assert!(parse_ppm_header(&ppm("P6\n65536 65536\n255\n", 16)).is_none());
+    }
+
+    #[test]
+    fn identical_frames_compare_perfectly() {
+        let pixels: Vec<u8> = (0..16 * 16 * 3).map(|i| (i * 37) as u8).collect();
+        let comparison = compare_rgb(&pixels, &pixels, 16, 16);
+        assert_eq!(comparison.psnr, f64::INFINITY);
+        assert_eq!(comparison.ssim, 1.0);
+        assert_eq!(comparison.max_diff, 0);
+    }
+
+    #[test]
+    fn small_frames_get_a_whole_frame_ssim() {
+        let luma: Vec<u8> = (0..5 * 3).map(|i| (i * 16) as u8).collect();
+        assert_eq!(luma_ssim(&luma, &luma, 5, 3), 1.0);
+
+        let brighter: Vec<u8> = luma.iter().map(|&v| v.saturating_add(1)).collect();
+        let close = luma_ssim(&luma, &brighter, 5, 3);
+        assert!(close > 0.99 && close < 1.0, "ssim {}", close);
+
+        let inverted: Vec<u8> = luma.iter().map(|&v| 255 - v).collect();
+        assert!(luma_ssim(&luma, &inverted, 5, 3) < 0.0);
+    }
+
+    #[test]
+    fn block_ssim_drops_with_distortion() {
+        let x: Vec<u8> = (0..16 * 16).map(|i| ((i % 16) * 16) as u8).collect();
+        let noisy: Vec<u8> = x
+            .iter()
+            .enumerate()
+            .map(|(i, &v)| {
+                if i % 2 == 0 {
+                    v.saturating_add(40)
+                } else {
+                    v.saturating_sub(40)
+                }
+            })
+            .collect();
+        let ssim = luma_ssim(&x, &noisy, 16, 16);
+        assert!(ssim < 0.9, "ssim {}", ssim);
+        assert_eq!(luma_ssim(&x, &x, 16, 16), 1.0);
+    }
+}
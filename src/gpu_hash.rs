@@ -0,0 +1,495 @@
+// GPU tile hashing
+//
+// A compute pass hashes the presented image on the device, so unchanged
+// frames are recognised without the host reading the image at all. The
+// swapchain images are linear, so a storage buffer bound to the same memory
+// sees exactly the bytes the host would. One invocation hashes one tile of up
+// to TILE_WORDS words within a row; the host only reads the tile hashes,
+// 4 bytes per KiB of image, and compares them with the previous capture.
+// Tiles whose hash changed are merged into dirty rectangles, so a retained
+// copy of the last frame can be refreshed from just those regions.
+//
+// The shader source is shaders/tile_hash.comp.
+
+use ash::vk;
+use std::{ffi::CStr, io::Cursor, mem, slice, sync::Mutex};
+
+use crate::{
+    image_memory::{Allocation, ImageMemory},
+    HostVisibleImage,
+};
+
+// Must match the shader
+pub const TILE_WORDS: u32 = 256;
+const WORKGROUP_SIZE: u32 = 64;
+
+static TILE_HASH_SPV: &[u8] = include_bytes!("../shaders/tile_hash.spv");
+
+// Device-wide pipeline objects
+pub struct TileHashPipeline {
+    descriptor_set_layout: vk::DescriptorSetLayout,
+    pipeline_layout: vk::PipelineLayout,
+    pipeline: vk::Pipeline,
+    limits: vk::PhysicalDeviceLimits,
+}
+
+impl TileHashPipeline {
+    pub unsafe fn create(
+        device: &ash::Device,
+        limits: vk::PhysicalDeviceLimits,
+    ) -> Result<Self, vk::Result> {
+        let code = ash::util::read_spv(&mut Cursor::new(TILE_HASH_SPV))
+            .map_err(|_| vk::Result::ERROR_INITIALIZATION_FAILED)?;
+        let module_info = vk::ShaderModuleCreateInfo::builder().code(&code);
+        let module = device.create_shader_module(&module_info, None)?;
+
+        let bindings = [0, 1].map(|binding| {
+            vk::DescriptorSetLayoutBinding::builder()
+                .binding(binding)
+                .descriptor_type(vk::DescriptorType::STORAGE_BUFFER)
+                .descriptor_count(1)
+                .stage_flags(vk::ShaderStageFlags::COMPUTE)
+                .build()
+        });
+        let set_layout_info = vk::DescriptorSetLayoutCreateInfo::builder().bindings(&bindings);
+        let descriptor_set_layout = device.create_descriptor_set_layout(&set_layout_info, None)?;
+
+        let push_constant_ranges = [vk::PushConstantRange {
+            stage_flags: vk::ShaderStageFlags::COMPUTE,
+            offset: 0,
+            size: mem::size_of::<TileParams>() as u32,
+        }];
+        let set_layouts = [descriptor_set_layout];
+        let layout_info = vk::PipelineLayoutCreateInfo::builder()
+            .set_layouts(&set_layouts)
+            .push_constant_ranges(&push_constant_ranges);
+        let pipeline_layout = device.create_pipeline_layout(&layout_info, None)?;
+
+        let entry_point = CStr::from_bytes_with_nul(b"main\0").unwrap();
+        let stage = vk::PipelineShaderStageCreateInfo::builder()
+            .stage(vk::ShaderStageFlags::COMPUTE)
+            .module(module)
+            .name(entry_point);
+        let pipeline_info = vk::ComputePipelineCreateInfo::builder()
+            .stage(*stage)
+            .layout(pipeline_layout);
+        let pipelines =
+            device.create_compute_pipelines(vk::PipelineCache::null(), &[*pipeline_info], None);
+        device.destroy_shader_module(module, None);
+
+        let pipeline = match pipelines {
+            Ok(pipelines) => pipelines[0],
+            Err((_, e)) => {
+                device.destroy_pipeline_layout(pipeline_layout, None);
+                device.destroy_descriptor_set_layout(descriptor_set_layout, None);
+                return Err(e);
+            }
+        };
+
+        Ok(Self {
+            descriptor_set_layout,
+            pipeline_layout,
+            pipeline,
+            limits,
+        })
+    }
+
+    pub unsafe fn destroy(&self, device: &ash::Device) {
+        device.destroy_pipeline(self.pipeline, None);
+        device.destroy_pipeline_layout(self.pipeline_layout, None);
+        device.destroy_descriptor_set_layout(self.descriptor_set_layout, None);
+    }
+}
+
+// Push constants, laid out as in the shader
+#[repr(C)]
+#[derive(Clone, Copy)]
+struct TileParams {
+    row_words: u32,
+    row_pitch_words: u32,
+    tiles_per_row: u32,
+    tile_count: u32,
+}
+
+// Change of a frame relative to the previous capture
+pub enum FrameChange {
+    Unchanged,
+    // No previous capture to compare with
+    Full,
+    Dirty(Vec<DirtyRect>),
+}
+
+impl FrameChange {
+    // True if the host can skip the frame without reading it. Tile hashes
+    // can collide, so frames verified against a hash reference or golden
+    // images are always read and checked on the host.
+    pub fn skips_host(&self, verified: bool) -> bool {
+        matches!(self, FrameChange::Unchanged) && !verified
+    }
+}
+
+// Region in pixels
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct DirtyRect {
+    pub x: u32,
+    pub y: u32,
+    pub width: u32,
+    pub height: u32,
+}
+
+// Per-swapchain buffers: one aliasing buffer per image and a shared
+// host-visible buffer for the tile hashes
+pub struct TileHashTargets {
+    image_buffers: Vec<vk::Buffer>,
+    hash_buffer: vk::Buffer,
+    // Range of the device's capture memory
+    hash_memory: Option<Allocation>,
+    hash_ptr: *const u32,
+    // Size of the hash buffer as allocated
+    hash_size: u64,
+    descriptor_pool: vk::DescriptorPool,
+    descriptor_sets: Vec<vk::DescriptorSet>,
+    params: TileParams,
+    bytes_per_pixel: u32,
+    width: u32,
+    // Tile hashes of the last capture, empty before the first
+    previous: Mutex<Vec<u32>>,
+}
+
+// Safety: the mapped hash buffer is only read while the layer lock is held
+unsafe impl Send for TileHashTargets {}
+unsafe impl Sync for TileHashTargets {}
+
+impl TileHashTargets {
+    // Returns None unless pixels are 4 bytes and rows whole words, so tiles
+    // always end on a pixel boundary; other layouts are checked on the host
+    pub unsafe fn create(
+        ash_instance: &ash::Instance,
+        device: &ash::Device,
+        physical_device: vk::PhysicalDevice,
+        image_memory: &ImageMemory,
+        pipeline: &TileHashPipeline,
+        images: &[HostVisibleImage],
+        bytes_per_pixel: u32,
+        extent: vk::Extent2D,
+    ) -> Result<Option<Self>, vk::Result> {
+        let row_bytes = bytes_per_pixel * extent.width;
+        let height = extent.height;
+        let row_pitch = match images.first() {
+            Some(image) => image.row_pitch,
+            None => return Ok(None),
+        };
+        if bytes_per_pixel != 4
+            || row_pitch % 4 != 0
+            || images.iter().any(|image| image.row_pitch != row_pitch)
+        {
+            return Ok(None);
+        }
+
+        let row_words = row_bytes / 4;
+        let tiles_per_row = (row_words + TILE_WORDS - 1) / TILE_WORDS;
+        let params = TileParams {
+            row_words,
+            row_pitch_words: row_pitch / 4,
+            tiles_per_row,
+            tile_count: tiles_per_row * height,
+        };
+
+        let image_range = row_pitch as u64 * height as u64;
+        let limits = &pipeline.limits;
+        let groups = (params.tile_count + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE;
+        if image_range > limits.max_storage_buffer_range as u64
+            || groups > limits.max_compute_work_group_count[0]
+        {
+            return Ok(None);
+        }
+
+        let mut targets = Self {
+            image_buffers: Vec::with_capacity(images.len()),
+            hash_buffer: vk::Buffer::null(),
+            hash_memory: None,
+            hash_ptr: std::ptr::null(),
+            hash_size: 0,
+            descriptor_pool: vk::DescriptorPool::null(),
+            descriptor_sets: Vec::new(),
+            params,
+            bytes_per_pixel,
+            width: extent.width,
+            previous: Mutex::new(Vec::new()),
+        };
+        // Release whatever was created so far on any failure
+        let created = targets.create_resources(
+            ash_instance,
+            device,
+            physical_device,
+            image_memory,
+            pipeline,
+            images,
+        );
+        match created {
+            Ok(true) => Ok(Some(targets)),
+            Ok(false) => {
+                targets.destroy(device, image_memory);
+                Ok(None)
+            }
+            Err(e) => {
+                targets.destroy(device, image_memory);
+                Err(e)
+            }
+        }
+    }
+
+    unsafe fn create_resources(
+        &mut self,
+        ash_instance: &ash::Instance,
+        device: &ash::Device,
+        physical_device: vk::PhysicalDevice,
+        image_memory: &ImageMemory,
+        pipeline: &TileHashPipeline,
+        images: &[HostVisibleImage],
+    ) -> Result<bool, vk::Result> {
+        let image_range = (self.params.row_pitch_words * 4) as u64
+            * (self.params.tile_count / self.params.tiles_per_row) as u64;
+
+        for image in images {
+            let buffer_info = vk::BufferCreateInfo::builder()
+                .size(image_range)
+                .usage(vk::BufferUsageFlags::STORAGE_BUFFER)
+                .sharing_mode(vk::SharingMode::EXCLUSIVE);
+            let buffer = device.create_buffer(&buffer_info, None)?;
+            self.image_buffers.push(buffer);
+
+            let requirements = device.get_buffer_memory_requirements(buffer);
+            if requirements.memory_type_bits & (1 << image.memory_type_index) == 0
+                || requirements.size > image.size
+                || image.offset % requirements.alignment != 0
+            {
+                return Ok(false);
+            }
+            device.bind_buffer_memory(buffer, image.memory, image.offset)?;
+        }
+
+        let hash_size = (self.params.tile_count as usize * mem::size_of::<u32>()) as u64;
+        let buffer_info = vk::BufferCreateInfo::builder()
+            .size(hash_size)
+            .usage(vk::BufferUsageFlags::STORAGE_BUFFER)
+            .sharing_mode(vk::SharingMode::EXCLUSIVE);
+        self.hash_buffer = device.create_buffer(&buffer_info, None)?;
+
+        let requirements = device.get_buffer_memory_requirements(self.hash_buffer);
+        let memory_type_index = match crate::find_host_visible_memory_type(
+            ash_instance,
+            physical_device,
+            requirements.memory_type_bits,
+        ) {
+            Some(index) => index,
+            None => return Ok(false),
+        };
+        let allocation =
+            image_memory.allocate(device, &requirements, memory_type_index, requirements.size)?;
+        let hash_memory = self.hash_memory.insert(allocation);
+        device.bind_buffer_memory(self.hash_buffer, hash_memory.memory, hash_memory.offset)?;
+        self.hash_ptr = hash_memory.mapped_ptr as *const u32;
+        self.hash_size = requirements.size;
+
+        let pool_sizes = [vk::DescriptorPoolSize {
+            ty: vk::DescriptorType::STORAGE_BUFFER,
+            descriptor_count: 2 * images.len() as u32,
+        }];
+        let pool_info = vk::DescriptorPoolCreateInfo::builder()
+            .max_sets(images.len() as u32)
+            .pool_sizes(&pool_sizes);
+        self.descriptor_pool = device.create_descriptor_pool(&pool_info, None)?;
+
+        let set_layouts = vec![pipeline.descriptor_set_layout; images.len()];
+        let alloc_info = vk::DescriptorSetAllocateInfo::builder()
+            .descriptor_pool(self.descriptor_pool)
+            .set_layouts(&set_layouts);
+        self.descriptor_sets = device.allocate_descriptor_sets(&alloc_info)?;
+
+        for (&set, &image_buffer) in self.descriptor_sets.iter().zip(&self.image_buffers) {
+            let image_info = [vk::DescriptorBufferInfo {
+                buffer: image_buffer,
+                offset: 0,
+                range: vk::WHOLE_SIZE,
+            }];
+            let hash_info = [vk::DescriptorBufferInfo {
+                buffer: self.hash_buffer,
+                offset: 0,
+                range: vk::WHOLE_SIZE,
+            }];
+            let writes = [
+                vk::WriteDescriptorSet::builder()
+                    .dst_set(set)
+                    .dst_binding(0)
+                    .descriptor_type(vk::DescriptorType::STORAGE_BUFFER)
+                    .buffer_info(&image_info)
+                    .build(),
+                vk::WriteDescriptorSet::builder()
+                    .dst_set(set)
+                    .dst_binding(1)
+                    .descriptor_type(vk::DescriptorType::STORAGE_BUFFER)
+                    .buffer_info(&hash_info)
+                    .build(),
+            ];
+            device.update_descriptor_sets(&writes, &[]);
+        }
+
+        Ok(true)
+    }
+
+    // Records the hash dispatch for `image_index`. The caller's barrier must
+    // make color attachment writes visible to compute shader reads.
+    pub unsafe fn record(
+        &self,
+        device: &ash::Device,
+        pipeline: &TileHashPipeline,
+        cmd_buffer: vk::CommandBuffer,
+        image_index: usize,
+    ) {
+        device.cmd_bind_pipeline(
+            cmd_buffer,
+            vk::PipelineBindPoint::COMPUTE,
+            pipeline.pipeline,
+        );
+        device.cmd_bind_descriptor_sets(
+            cmd_buffer,
+            vk::PipelineBindPoint::COMPUTE,
+            pipeline.pipeline_layout,
+            0,
+            &[self.descriptor_sets[image_index]],
+            &[],
+        );
+        let params = slice::from_raw_parts(
+            &self.params as *const TileParams as *const u8,
+            mem::size_of::<TileParams>(),
+        );
+        device.cmd_push_constants(
+            cmd_buffer,
+            pipeline.pipeline_layout,
+            vk::ShaderStageFlags::COMPUTE,
+            0,
+            params,
+        );
+        let groups = (self.params.tile_count + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE;
+        device.cmd_dispatch(cmd_buffer, groups, 1, 1);
+
+        let barrier = vk::MemoryBarrier::builder()
+            .src_access_mask(vk::AccessFlags::SHADER_WRITE)
+            .dst_access_mask(vk::AccessFlags::HOST_READ);
+        device.cmd_pipeline_barrier(
+            cmd_buffer,
+            vk::PipelineStageFlags::COMPUTE_SHADER,
+            vk::PipelineStageFlags::HOST,
+            vk::DependencyFlags::empty(),
+            &[*barrier],
+            &[],
+            &[],
+        );
+    }
+
+    // Compares the tile hashes of the completed dispatch with the previous
+    // capture and keeps them for the next one
+    pub fn compare(&self) -> FrameChange {
+        let hashes =
+            unsafe { slice::from_raw_parts(self.hash_ptr, self.params.tile_count as usize) };
+        let mut previous = self.previous.lock().unwrap();
+        let change = if previous.is_empty() {
+            FrameChange::Full
+        } else if previous.as_slice() == hashes {
+            return FrameChange::Unchanged;
+        } else {
+            FrameChange::Dirty(self.dirty_rects(&previous, hashes))
+        };
+        previous.clear();
+        previous.extend_from_slice(hashes);
+        change
+    }
+
+    // Bounding rectangles of changed tiles. Each run of consecutive rows with
+    // a changed tile becomes one rectangle spanning their changed columns.
+    fn dirty_rects(&self, previous: &[u32], hashes: &[u32]) -> Vec<DirtyRect> {
+        let tiles_per_row = self.params.tiles_per_row as usize;
+        let tile_bytes = TILE_WORDS * 4;
+        let mut rects = Vec::new();
+        // (first row, first tile, end tile) of the open rectangle
+        let mut open: Option<(u32, usize, usize)> = None;
+
+        let rows = previous
+            .chunks_exact(tiles_per_row)
+            .zip(hashes.chunks_exact(tiles_per_row));
+        for (row, (old, new)) in rows.enumerate() {
+            let first = old.iter().zip(new).position(|(a, b)| a != b);
+            let span = first.map(|first| {
+                let last = old.iter().zip(new).rposition(|(a, b)| a != b).unwrap();
+                (first, last + 1)
+            });
+
+            open = match (open, span) {
+                (Some((y, first, end)), Some((f, e))) => Some((y, first.min(f), end.max(e))),
+                (None, Some((f, e))) => Some((row as u32, f, e)),
+                (Some(band), None) => {
+                    rects.push(self.tile_rect(band, row as u32, tile_bytes));
+                    None
+                }
+                (None, None) => None,
+            };
+        }
+        if let Some(band) = open {
+            let height = (hashes.len() / tiles_per_row) as u32;
+            rects.push(self.tile_rect(band, height, tile_bytes));
+        }
+        rects
+    }
+
+    fn tile_rect(
+        &self,
+        (y, first, end): (u32, usize, usize),
+        end_row: u32,
+        tile_bytes: u32,
+    ) -> DirtyRect {
+        let row_bytes = self.params.row_words * 4;
+        let x = first as u32 * tile_bytes / self.bytes_per_pixel;
+        let end_x = (end as u32 * tile_bytes).min(row_bytes);
+        let end_x = ((end_x + self.bytes_per_pixel - 1) / self.bytes_per_pixel).min(self.width);
+        DirtyRect {
+            x,
+            y,
+            width: end_x - x,
+            height: end_row - y,
+        }
+    }
+
+    pub unsafe fn destroy(&self, device: &ash::Device, image_memory: &ImageMemory) {
+        if self.descriptor_pool != vk::DescriptorPool::null() {
+            device.destroy_descriptor_pool(self.descriptor_pool, None);
+        }
+        if self.hash_buffer != vk::Buffer::null() {
+            device.destroy_buffer(self.hash_buffer, None);
+        }
+        if let Some(hash_memory) = &self.hash_memory {
+            image_memory.free(
+                device,
+                hash_memory.memory,
+                hash_memory.offset,
+                self.hash_size,
+            );
+        }
+        for &buffer in &self.image_buffers {
+            device.destroy_buffer(buffer, None);
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn verified_frames_are_never_skipped() {
+        assert!(FrameChange::Unchanged.skips_host(false));
+        assert!(!FrameChange::Unchanged.skips_host(true));
+        assert!(!FrameChange::Full.skips_host(false));
+        assert!(!FrameChange::Dirty(Vec::new()).skips_host(false));
+    }
+}
@@ -0,0 +1,98 @@
+// GPU timestamps around capture work
+//
+// The capture command buffer writes a timestamp before the visibility
+// barrier, after it and, when the tile hash pass runs, after the dispatch.
+// The host already waits for that submission to finish before it reads the
+// image, so the results are fetched at that point without a further stall.
+// The barrier interval covers waiting for the app's rendering plus the cache
+// flush; the hash interval is the compute pass itself.
+
+use ash::vk;
+
+const QUERY_COUNT: u32 = 3;
+
+// GPU durations of one capture submission
+#[derive(Debug, Clone, Copy)]
+pub struct CaptureGpuTime {
+    pub barrier_ns: u64,
+    pub hash_ns: Option<u64>,
+}
+
+pub struct GpuTimer {
+    query_pool: vk::QueryPool,
+    // Nanoseconds per timestamp tick
+    period_ns: f64,
+    // Bits of each timestamp the queue actually writes
+    valid_mask: u64,
+}
+
+impl GpuTimer {
+    // `None` if the queue family does not support timestamps
+    pub unsafe fn create(
+        device: &ash::Device,
+        timestamp_period: f32,
+        timestamp_valid_bits: u32,
+    ) -> Result<Option<Self>, vk::Result> {
+        if timestamp_valid_bits == 0 {
+            return Ok(None);
+        }
+
+        let pool_info = vk::QueryPoolCreateInfo::builder()
+            .query_type(vk::QueryType::TIMESTAMP)
+            .query_count(QUERY_COUNT);
+        let query_pool = device.create_query_pool(&pool_info, None)?;
+
+        Ok(Some(Self {
+            query_pool,
+            period_ns: timestamp_period as f64,
+            valid_mask: match timestamp_valid_bits {
+                64.. => u64::MAX,
+                bits => (1 << bits) - 1,
+            },
+        }))
+    }
+
+    pub unsafe fn destroy(&self, device: &ash::Device) {
+        device.destroy_query_pool(self.query_pool, None);
+    }
+
+    // Recorded before the visibility barrier
+    pub unsafe fn begin(&self, device: &ash::Device, cmd: vk::CommandBuffer) {
+        device.cmd_reset_query_pool(cmd, self.query_pool, 0, QUERY_COUNT);
+        device.cmd_write_timestamp(cmd, vk::PipelineStageFlags::TOP_OF_PIPE, self.query_pool, 0);
+    }
+
+    // Recorded after the barrier (1) and after the hash dispatch (2)
+    pub unsafe fn mark(&self, device: &ash::Device, cmd: vk::CommandBuffer, query: u32) {
+        device.cmd_write_timestamp(
+            cmd,
+            vk::PipelineStageFlags::BOTTOM_OF_PIPE,
+            self.query_pool,
+            query,
+        );
+    }
+
+    // Must only be called once the submission has completed
+    pub unsafe fn read(
+        &self,
+        device: &ash::Device,
+        hashed: bool,
+    ) -> Result<CaptureGpuTime, vk::Result> {
+        let count = if hashed { 3 } else { 2 };
+        let mut ticks = [0u64; QUERY_COUNT as usize];
+        device.get_query_pool_results(
+            self.query_pool,
+            0,
+            count,
+            &mut ticks[..count as usize],
+            vk::QueryResultFlags::TYPE_64 | vk::QueryResultFlags::WAIT,
+        )?;
+
+        let elapsed_ns =
+            |from: u64, to: u64| (to.wrapping_sub(from) & self.valid_mask) as f64 * self.period_ns;
+        Ok(CaptureGpuTime {
+            barrier_ns: elapsed_ns(ticks[0], ticks[1]) as u64,
+            hash_ns: hashed.then(|| elapsed_ns(ticks[1], ticks[2]) as u64),
+        })
+    }
+}
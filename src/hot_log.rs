@@ -0,0 +1,209 @@
+// Hot-path log ring
+//
+// Per-frame messages are not formatted where they happen. Live, each message
+// reaches the logger at most once per second, so `RUST_LOG=info` still shows
+// progress without a formatted line per frame. When a ring is configured,
+// every message is also stored as a fixed-size binary record, a message id
+// plus up to four integers, and only turned into text when the ring is dumped
+// to the logger at instance destruction. With neither a ring nor an enabled
+// logger, a record reads no clock and writes nothing.
+//
+// Writers claim a slot with one fetch_add and publish it with a per-slot
+// sequence number; the dump skips slots that are being rewritten. Messages
+// above the `log` crate's compile-time max level (the `max_level_*` and
+// `release_max_level_*` features) compile to nothing.
+
+use std::sync::{
+    atomic::{fence, AtomicU64, Ordering},
+    OnceLock,
+};
+
+const ARGS: usize = 4;
+// Minimum time between live forwards of the same message
+const FORWARD_INTERVAL_NS: u64 = 1_000_000_000;
+
+#[derive(Debug, Clone, Copy)]
+pub enum Msg {
+    Present,
+    Acquire,
+    Capture,
+    BarrierDone,
+    GpuTime,
+    Unchanged,
+    DirtyRects,
+    Repeat,
+    Saved,
+}
+
+const MESSAGES: [Msg; 9] = [
+    Msg::Present,
+    Msg::Acquire,
+    Msg::Capture,
+    Msg::BarrierDone,
+    Msg::GpuTime,
+    Msg::Unchanged,
+    Msg::DirtyRects,
+    Msg::Repeat,
+    Msg::Saved,
+];
+
+impl Msg {
+    fn level(self) -> log::Level {
+        match self {
+            Msg::Present | Msg::Capture | Msg::Saved => log::Level::Info,
+            _ => log::Level::Debug,
+        }
+    }
+
+    // `{}` placeholders take the arguments in order
+    fn template(self) -> &'static str {
+        match self {
+            Msg::Present => "Presenting {} swapchain(s) - capturing from host-visible memory",
+            Msg::Acquire => "Acquired image {}",
+            Msg::Capture => "Capturing frame {} from host-visible memory ({}x{}, format: {})",
+            Msg::BarrierDone => "Memory barrier completed - GPU writes now visible to host",
+            Msg::GpuTime => "Capture GPU time: barrier {} ns, hash {} ns",
+            Msg::Unchanged => "Frame {} unchanged on the GPU, skipping",
+            Msg::DirtyRects => "Frame {} has {} dirty rectangles",
+            Msg::Repeat => "Frame {} repeats the previous capture, skipping",
+            Msg::Saved => "Successfully saved frame {} ({} bytes, {}x{} pixels)",
+        }
+    }
+
+    // Arguments are plain integers except where the template names a type
+    fn format_arg(self, index: usize, value: u64) -> String {
+        match (self, index) {
+            (Msg::Capture, 3) => format!("{:?}", ash::vk::Format::from_raw(value as i32)),
+            _ => value.to_string(),
+        }
+    }
+}
+
+struct Slot {
+    // Index of the record + 1 once complete, 0 while being written
+    seq: AtomicU64,
+    ts_ns: AtomicU64,
+    msg: AtomicU64,
+    args: [AtomicU64; ARGS],
+}
+
+struct Ring {
+    head: AtomicU64,
+    slots: Box<[Slot]>,
+}
+
+static RING: OnceLock<Ring> = OnceLock::new();
+const NEVER: AtomicU64 = AtomicU64::new(0);
+static LAST_FORWARD_NS: [AtomicU64; MESSAGES.len()] = [NEVER; MESSAGES.len()];
+
+// Allocates the ring; records before this only reach the live logger
+pub fn init(capacity: usize) {
+    if capacity == 0 {
+        return;
+    }
+    RING.get_or_init(|| Ring {
+        head: AtomicU64::new(0),
+        slots: (0..capacity)
+            .map(|_| Slot {
+                seq: AtomicU64::new(0),
+                ts_ns: AtomicU64::new(0),
+                msg: AtomicU64::new(0),
+                args: Default::default(),
+            })
+            .collect(),
+    });
+}
+
+#[inline]
+pub fn record(msg: Msg, args: &[u64]) {
+    if msg.level() > log::STATIC_MAX_LEVEL {
+        return;
+    }
+
+    let ring = RING.get();
+    let forward = log::log_enabled!(msg.level());
+    if ring.is_none() && !forward {
+        return;
+    }
+
+    let now_ns = crate::monotonic_ns();
+    if let Some(ring) = ring {
+        let index = ring.head.fetch_add(1, Ordering::Relaxed);
+        let slot = &ring.slots[(index % ring.slots.len() as u64) as usize];
+        slot.seq.store(0, Ordering::Relaxed);
+        fence(Ordering::Release);
+        slot.ts_ns.store(now_ns, Ordering::Relaxed);
+        slot.msg.store(msg as u64, Ordering::Relaxed);
+        for (arg, &value) in slot.args.iter().zip(args) {
+            arg.store(value, Ordering::Relaxed);
+        }
+        slot.seq.store(index + 1, Ordering::Release);
+    }
+
+    if forward {
+        let last = &LAST_FORWARD_NS[msg as usize];
+        let due = last.load(Ordering::Relaxed);
+        if (due == 0 || now_ns >= due + FORWARD_INTERVAL_NS)
+            && last
+                .compare_exchange(due, now_ns.max(1), Ordering::Relaxed, Ordering::Relaxed)
+                .is_ok()
+        {
+            log::log!(msg.level(), "{}", format_message(msg, args));
+        }
+    }
+}
+
+fn format_message(msg: Msg, args: &[u64]) -> String {
+    let mut text = String::new();
+    let mut args = args.iter();
+    for (i, part) in msg.template().split("{}").enumerate() {
+        if i > 0 {
+            match args.next() {
+                Some(&value) => text.push_str(&msg.format_arg(i - 1, value)),
+                None => text.push('?'),
+            }
+        }
+        text.push_str(part);
+    }
+    text
+}
+
+// Decodes the ring, oldest record first, into the logger
+pub fn dump() {
+    let ring = match RING.get() {
+        Some(ring) => ring,
+        None => return,
+    };
+
+    let head = ring.head.load(Ordering::Relaxed);
+    let capacity = ring.slots.len() as u64;
+    log::info!(
+        "Hot-path log: last {} of {} records",
+        head.min(capacity),
+        head
+    );
+    for index in head.saturating_sub(capacity)..head {
+        let slot = &ring.slots[(index % capacity) as usize];
+        if slot.seq.load(Ordering::Acquire) != index + 1 {
+            continue;
+        }
+        let ts_ns = slot.ts_ns.load(Ordering::Relaxed);
+        let msg = MESSAGES[slot.msg.load(Ordering::Relaxed) as usize % MESSAGES.len()];
+        let mut args = [0; ARGS];
+        for (value, arg) in args.iter_mut().zip(&slot.args) {
+            *value = arg.load(Ordering::Relaxed);
+        }
+        // Overwritten while reading
+        fence(Ordering::Acquire);
+        if slot.seq.load(Ordering::Acquire) != index + 1 {
+            continue;
+        }
+        log::log!(
+            msg.level(),
+            "[{}.{:06}] {}",
+            ts_ns / 1_000_000_000,
+            ts_ns % 1_000_000_000 / 1000,
+            format_message(msg, &args)
+        );
+    }
+}
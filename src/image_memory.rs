@@ -0,0 +1,290 @@
+// Suballocated capture memory
+//
+// Swapchain images and tile hash buffers are placed in a few large
+// host-visible blocks per device rather than getting a vkAllocateMemory call
+// each. Allocation is slow on many drivers, counts against
+// maxMemoryAllocationCount and would otherwise be repeated for every image
+// on every swapchain recreation. Each block is mapped once for its lifetime.
+// Ranges are taken first-fit from a free list sorted by offset and merged
+// with their neighbours when released.
+//
+// Offsets are aligned to both the resource's alignment and
+// bufferImageGranularity, and sizes rounded up to the granularity, so linear
+// images and buffers never share a granularity page with a neighbour of a
+// different kind. A block is freed as soon as it empties; images kept for
+// the next swapchain are held by the image pool instead.
+
+use ash::vk;
+use std::sync::Mutex;
+
+// Smallest block allocated, so a few small resources share one allocation;
+// otherwise a block is sized for everything the caller reserves
+const MIN_BLOCK_SIZE: u64 = 4 << 20;
+
+// A range of a block, mapped at `mapped_ptr`
+pub struct Allocation {
+    pub memory: vk::DeviceMemory,
+    pub offset: u64,
+    pub mapped_ptr: *mut u8,
+}
+
+struct Block {
+    memory: vk::DeviceMemory,
+    memory_type_index: u32,
+    size: u64,
+    mapped_ptr: *mut u8,
+    // Free ranges as (offset, size), sorted by offset
+    free: Vec<(u64, u64)>,
+}
+
+impl Block {
+    unsafe fn create(
+        device: &ash::Device,
+        memory_type_index: u32,
+        size: u64,
+    ) -> Result<Self, vk::Result> {
+        let alloc_info = vk::MemoryAllocateInfo::builder()
+            .allocation_size(size)
+            .memory_type_index(memory_type_index);
+        let memory = device.allocate_memory(&alloc_info, None)?;
+        let mapped_ptr =
+            match device.map_memory(memory, 0, vk::WHOLE_SIZE, vk::MemoryMapFlags::empty()) {
+                Ok(ptr) => ptr as *mut u8,
+                Err(e) => {
+                    device.free_memory(memory, None);
+                    return Err(e);
+                }
+            };
+        log::debug!(
+            "Allocated {} MiB capture memory block (type {})",
+            size >> 20,
+            memory_type_index
+        );
+
+        Ok(Self {
+            memory,
+            memory_type_index,
+            size,
+            mapped_ptr,
+            free: vec![(0, size)],
+        })
+    }
+
+    unsafe fn destroy(&self, device: &ash::Device) {
+        device.unmap_memory(self.memory);
+        device.free_memory(self.memory, None);
+    }
+
+    // First fit; alignment padding in front stays free
+    fn take(&mut self, size: u64, alignment: u64) -> Option<u64> {
+        let (index, offset) = self
+            .free
+            .iter()
+            .enumerate()
+            .find_map(|(i, &(start, len))| {
+                let offset = align_up(start, alignment);
+                (offset + size <= start + len).then_some((i, offset))
+            })?;
+
+        let (start, len) = self.free[index];
+        let tail = (offset + size, start + len - offset - size);
+        match (offset > start, tail.1 > 0) {
+            (false, false) => {
+                self.free.remove(index);
+            }
+            (false, true) => self.free[index] = tail,
+            (true, false) => self.free[index] = (start, offset - start),
+            (true, true) => {
+                self.free[index] = (start, offset - start);
+                self.free.insert(index + 1, tail);
+            }
+        }
+        Some(offset)
+    }
+
+    fn release(&mut self, offset: u64, size: u64) {
+        let index = self.free.partition_point(|&(start, _)| start < offset);
+        self.free.insert(index, (offset, size));
+
+        // Merge with the following range, then with the preceding one
+        if index + 1 < self.free.len() && offset + size == self.free[index + 1].0 {
+            self.free[index].1 += self.free.remove(index + 1).1;
+        }
+        if index > 0 {
+            let (start, len) = self.free[index - 1];
+            if start + len == offset {
+                self.free[index - 1].1 += self.free.remove(index).1;
+            }
+        }
+    }
+
+    fn is_empty(&self) -> bool {
+        self.free.len() == 1 && self.free[0] == (0, self.size)
+    }
+}
+
+pub struct ImageMemory {
+    blocks: Mutex<Vec<Block>>,
+    granularity: u64,
+}
+
+// Safety: the mapped pointers are only handed out with their ranges, and the
+// block list is behind the mutex
+unsafe impl Send for ImageMemory {}
+unsafe impl Sync for ImageMemory {}
+
+impl ImageMemory {
+    pub fn new(buffer_image_granularity: u64) -> Self {
+        Self {
+            blocks: Mutex::new(Vec::new()),
+            granularity: buffer_image_granularity.max(1),
+        }
+    }
+
+    // `reserve` is the total the caller is about to allocate of this type,
+    // so that a new block fits all of it
+    pub unsafe fn allocate(
+        &self,
+        device: &ash::Device,
+        requirements: &vk::MemoryRequirements,
+        memory_type_index: u32,
+        reserve: u64,
+    ) -> Result<Allocation, vk::Result> {
+        let size = self.rounded_size(requirements.size);
+        let alignment = requirements.alignment.max(self.granularity);
+        let mut blocks = self.blocks.lock().unwrap();
+
+        for block in blocks.iter_mut() {
+            if block.memory_type_index != memory_type_index {
+                continue;
+            }
+            if let Some(offset) = block.take(size, alignment) {
+                return Ok(block_allocation(block, offset));
+            }
+        }
+
+        let block_size = align_up(reserve.max(size).max(MIN_BLOCK_SIZE), self.granularity);
+        let mut block =
+            match Block::create(device, memory_type_index, block_size) {
+                Ok(block) => block,
+                // Heaps short of a whole block may still fit the range itself
+                Err(
+                    vk::Result::ERROR_OUT_OF_DEVICE_MEMORY | vk::Result::ERROR_OUT_OF_HOST_MEMORY,
+                ) if block_size > size => Block::create(device, memory_type_index, size)?,
+                Err(e) => return Err(e),
+            };
+        // A fresh block starts at offset 0, which meets any alignment
+        let offset = block.take(size, alignment).unwrap();
+        let allocation = block_allocation(&block, offset);
+        blocks.push(block);
+        Ok(allocation)
+    }
+
+    // `size` as passed to `allocate` in the requirements
+    pub unsafe fn free(
+        &self,
+        device: &ash::Device,
+        memory: vk::DeviceMemory,
+        offset: u64,
+        size: u64,
+    ) {
+        let mut blocks = self.blocks.lock().unwrap();
+        let index = match blocks.iter().position(|block| block.memory == memory) {
+            Some(index) => index,
+            None => {
+                log::warn!("Freeing capture memory from unknown block {:?}", memory);
+                return;
+            }
+        };
+        blocks[index].release(offset, self.rounded_size(size));
+        if blocks[index].is_empty() {
+            blocks.swap_remove(index).destroy(device);
+        }
+    }
+
+    // Frees every block, at device destruction
+    pub unsafe fn destroy(&self, device: &ash::Device) {
+        for block in self.blocks.lock().unwrap().drain(..) {
+            block.destroy(device);
+        }
+    }
+
+    // Device memory held in blocks, used or not
+    pub fn block_bytes(&self) -> u64 {
+        self.blocks
+            .lock()
+            .unwrap()
+            .iter()
+            .map(|block| block.size)
+            .sum()
+    }
+
+    fn rounded_size(&self, size: u64) -> u64 {
+        align_up(size.max(1), self.granularity)
+    }
+}
+
+fn block_allocation(block: &Block, offset: u64) -> Allocation {
+    Allocation {
+        memory: block.memory,
+        offset,
+        mapped_ptr: unsafe { block.mapped_ptr.add(offset as usize) },
+    }
+}
+
+fn align_up(value: u64, alignment: u64) -> u64 {
+    value.div_ceil(alignment) * alignment
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn block(size: u64) -> Block {
+        Block {
+            memory: vk::DeviceMemory::null(),
+            memory_type_index: 0,
+            size,
+            mapped_ptr: std::ptr::null_mut(),
+            free: vec![(0, size)],
+        }
+    }
+
+    #[test]
+    fn alignment_padding_stays_free() {
+        let mut block = block(1024);
+        assert_eq!(block.take(10, 1), Some(0));
+        assert_eq!(block.take(16, 256), Some(256));
+        assert_eq!(block.free, vec![(10, 246), (272, 752)]);
+        // The padding is still usable by a smaller alignment
+        assert_eq!(block.take(100, 2), Some(10));
+        assert_eq!(block.take(1024, 1), None);
+    }
+
+    #[test]
+    fn releases_merge_with_both_neighbours() {
+        let mut block = block(300);
+        let offsets: Vec<u64> = (0..3).map(|_| block.take(100, 1).unwrap()).collect();
+        assert_eq!(offsets, vec![0, 100, 200]);
+        assert!(block.free.is_empty());
+
+        block.release(0, 100);
+        block.release(200, 100);
+        assert_eq!(block.free, vec![(0, 100), (200, 100)]);
+        block.release(100, 100);
+        assert_eq!(block.free, vec![(0, 300)]);
+    }
+
+    #[test]
+    fn empty_only_when_everything_is_released() {
+        let mut block = block(256);
+        assert!(block.is_empty());
+        let first = block.take(64, 1).unwrap();
+        let second = block.take(64, 1).unwrap();
+        assert!(!block.is_empty());
+        block.release(second, 64);
+        assert!(!block.is_empty());
+        block.release(first, 64);
+        assert!(block.is_empty());
+    }
+}
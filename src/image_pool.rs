@@ -0,0 +1,160 @@
+// Retired swapchain images kept for reuse
+//
+// Apps recreate their swapchain on every resize and tend to go back and forth
+// between a few sizes. The images of a destroyed swapchain are parked here,
+// still bound to their capture memory, and the next swapchain with the same
+// format, extent and usage takes them back without creating, allocating or
+// binding anything. A swapchain replaced through oldSwapchain keeps its
+// images until it is destroyed, as the app may still be using them. The pool
+// holds at most `limit` bytes of images, evicting the longest retired first,
+// and is emptied when capture memory runs out.
+
+use crate::HostVisibleImage;
+use ash::vk;
+use std::collections::VecDeque;
+
+// What makes two swapchain images interchangeable
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct ImageKey {
+    pub format: vk::Format,
+    pub width: u32,
+    pub height: u32,
+    pub usage: vk::ImageUsageFlags,
+}
+
+impl ImageKey {
+    pub fn new(format: vk::Format, extent: vk::Extent2D, usage: vk::ImageUsageFlags) -> Self {
+        Self {
+            format,
+            width: extent.width,
+            height: extent.height,
+            usage,
+        }
+    }
+}
+
+pub struct ImagePool {
+    // Oldest first
+    images: VecDeque<(ImageKey, HostVisibleImage)>,
+    bytes: u64,
+    limit: u64,
+}
+
+impl ImagePool {
+    pub fn new(limit: u64) -> Self {
+        Self {
+            images: VecDeque::new(),
+            bytes: 0,
+            limit,
+        }
+    }
+
+    // Up to `count` images matching `key`, most recently retired first
+    pub fn take(&mut self, key: ImageKey, count: usize) -> Vec<HostVisibleImage> {
+        let mut taken = Vec::new();
+        let mut index = self.images.len();
+        while index > 0 && taken.len() < count {
+            index -= 1;
+            if self.images[index].0 == key {
+                let (_, image) = self.images.remove(index).unwrap();
+                self.bytes -= image.size;
+                taken.push(image);
+            }
+        }
+        taken
+    }
+
+    // Returns the images evicted to stay within the limit, for the caller to
+    // destroy; with a zero limit that is everything put
+    pub fn put(
+        &mut self,
+        key: ImageKey,
+        images: impl IntoIterator<Item = HostVisibleImage>,
+    ) -> Vec<HostVisibleImage> {
+        for image in images {
+            self.bytes += image.size;
+            self.images.push_back((key, image));
+        }
+
+        let mut evicted = Vec::new();
+        while self.bytes > self.limit {
+            let (_, image) = self.images.pop_front().unwrap();
+            self.bytes -= image.size;
+            evicted.push(image);
+        }
+        evicted
+    }
+
+    // Every pooled image, for the caller to destroy
+    pub fn drain(&mut self) -> Vec<HostVisibleImage> {
+        self.bytes = 0;
+        self.images.drain(..).map(|(_, image)| image).collect()
+    }
+
+    pub fn bytes(&self) -> u64 {
+        self.bytes
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn image(size: u64) -> HostVisibleImage {
+        HostVisibleImage {
+            image: vk::Image::null(),
+            memory: vk::DeviceMemory::null(),
+            offset: 0,
+            memory_type_index: 0,
+            mapped_ptr: std::ptr::null_mut(),
+            size,
+            row_pitch: 0,
+        }
+    }
+
+    fn key(width: u32) -> ImageKey {
+        ImageKey::new(
+            vk::Format::B8G8R8A8_UNORM,
+            vk::Extent2D { width, height: 1 },
+            vk::ImageUsageFlags::COLOR_ATTACHMENT,
+        )
+    }
+
+    #[test]
+    fn takes_only_matching_images() {
+        let mut pool = ImagePool::new(1000);
+        assert!(pool.put(key(1), [image(10), image(20)]).is_empty());
+        assert!(pool.put(key(2), [image(30)]).is_empty());
+        assert_eq!(pool.bytes(), 60);
+
+        // Most recently retired first, and never more than asked for
+        let taken = pool.take(key(1), 1);
+        assert_eq!(taken.iter().map(|i| i.size).collect::<Vec<_>>(), vec![20]);
+        assert!(pool.take(key(3), 4).is_empty());
+        assert_eq!(pool.take(key(1), 4).len(), 1);
+        assert_eq!(pool.bytes(), 30);
+    }
+
+    #[test]
+    fn evicts_the_longest_retired_over_the_limit() {
+        let mut pool = ImagePool::new(50);
+        assert!(pool.put(key(1), [image(20), image(20)]).is_empty());
+        let evicted = pool.put(key(2), [image(20)]);
+        assert_eq!(evicted.len(), 1);
+        assert_eq!(pool.bytes(), 40);
+        assert_eq!(pool.take(key(1), 4).len(), 1);
+        assert_eq!(pool.take(key(2), 4).len(), 1);
+    }
+
+    #[test]
+    fn zero_limit_evicts_everything() {
+        let mut pool = ImagePool::new(0);
+        assert_eq!(pool.put(key(1), [image(10), image(10)]).len(), 2);
+        assert_eq!(pool.bytes(), 0);
+
+        let mut pool = ImagePool::new(100);
+        pool.put(key(1), [image(10)]);
+        assert_eq!(pool.drain().len(), 1);
+        assert_eq!(pool.bytes(), 0);
+    }
+}
@@ -0,0 +1,269 @@
+// Capture pipeline latency histograms
+//
+// Each stage of a capture is timed on the monotonic clock, or with GPU
+// timestamp queries for the device work, and recorded into a log-linear
+// histogram in the style of HdrHistogram: 16 linear sub-buckets per power of
+// two, so every bucket is within ~6% of the values it holds and recording is
+// a couple of shifts and one relaxed atomic add. Percentiles are
+// appended to a report per swapchain when it is destroyed, when the instance
+// is destroyed, and optionally at a fixed interval.
+
+use std::{
+    fs::File,
+    io::{LineWriter, Write},
+    sync::{
+        atomic::{AtomicU64, Ordering},
+        Mutex,
+    },
+};
+
+const SUB_BUCKET_BITS: u32 = 4;
+const SUB_BUCKETS: usize = 1 << SUB_BUCKET_BITS;
+// Enough buckets for any u64 value
+const BUCKETS: usize = (64 - SUB_BUCKET_BITS as usize + 1) * SUB_BUCKETS;
+
+const PERCENTILES: [f64; 4] = [50.0, 90.0, 99.0, 99.9];
+
+#[derive(Debug, Clone, Copy)]
+pub enum Stage {
+    // From vkQueuePresentKHR entry to the start of the capture
+    Queue,
+    // Host visibility barrier, including the GPU wait
+    Barrier,
+    Convert,
+    Encode,
+    Write,
+    // Whole capture, from the start of the barrier to the file being written
+    Total,
+    // End to end, from vkQueuePresentKHR entry to the file being written and
+    // readable by a consumer, not synced to disk; only frames that are written
+    Written,
+    // GPU time of the visibility barrier, from timestamp queries
+    GpuBarrier,
+    // GPU time of the tile hash pass
+    GpuHash,
+}
+
+const STAGES: [Stage; 9] = [
+    Stage::Queue,
+    Stage::Barrier,
+    Stage::Convert,
+    Stage::Encode,
+    Stage::Write,
+    Stage::Total,
+    Stage::Written,
+    Stage::GpuBarrier,
+    Stage::GpuHash,
+];
+
+impl Stage {
+    fn name(self) -> &'static str {
+        match self {
+            Stage::Queue => "queue",
+            Stage::Barrier => "barrier",
+            Stage::Convert => "convert",
+            Stage::Encode => "encode",
+            Stage::Write => "write",
+            Stage::Total => "total",
+            Stage::Written => "written",
+            Stage::GpuBarrier => "gpu_barrier",
+            Stage::GpuHash => "gpu_hash",
+        }
+    }
+}
+
+pub struct LatencyHistogram {
+    buckets: Box<[AtomicU64]>,
+    count: AtomicU64,
+    sum: AtomicU64,
+    max: AtomicU64,
+}
+
+impl LatencyHistogram {
+    pub fn new() -> Self {
+        Self {
+            buckets: (0..BUCKETS).map(|_| AtomicU64::new(0)).collect(),
+            count: AtomicU64::new(0),
+            sum: AtomicU64::new(0),
+            max: AtomicU64::new(0),
+        }
+    }
+
+    pub fn record(&self, value_ns: u64) {
+        self.buckets[bucket_index(value_ns)].fetch_add(1, Ordering::Relaxed);
+        self.count.fetch_add(1, Ordering::Relaxed);
+        self.sum.fetch_add(value_ns, Ordering::Relaxed);
+        self.max.fetch_max(value_ns, Ordering::Relaxed);
+    }
+
+    pub fn count(&self) -> u64 {
+        self.count.load(Ordering::Relaxed)
+    }
+
+    pub fn mean(&self) -> f64 {
+        self.sum.load(Ordering::Relaxed) as f64 / self.count().max(1) as f64
+    }
+
+    pub fn max(&self) -> u64 {
+        self.max.load(Ordering::Relaxed)
+    }
+
+    pub fn sum(&self) -> u64 {
+        self.sum.load(Ordering::Relaxed)
+    }
+
+    // Highest value equivalent to the given percentile, capped at the
+    // recorded maximum
+    pub fn percentile(&self, percentile: f64) -> u64 {
+        let count = self.count();
+        if count == 0 {
+            return 0;
+        }
+
+        let rank = ((percentile / 100.0 * count as f64).ceil() as u64).clamp(1, count);
+        let mut seen = 0;
+        for (index, bucket) in self.buckets.iter().enumerate() {
+            seen += bucket.load(Ordering::Relaxed);
+            if seen >= rank {
+                return bucket_upper_bound(index).min(self.max());
+            }
+        }
+        self.max()
+    }
+}
+
+fn bucket_index(value: u64) -> usize {
+    if value < SUB_BUCKETS as u64 {
+        return value as usize;
+    }
+    let exponent = 63 - value.leading_zeros();
+    let shift = exponent - SUB_BUCKET_BITS;
+    let sub_bucket = (value >> shift) as usize & (SUB_BUCKETS - 1);
+    (shift as usize + 1) * SUB_BUCKETS + sub_bucket
+}
+
+fn bucket_upper_bound(index: usize) -> u64 {
+    if index < SUB_BUCKETS {
+        return index as u64;
+    }
+    let shift = (index / SUB_BUCKETS - 1) as u32;
+    let sub_bucket = (index % SUB_BUCKETS) as u64;
+    let lower = (SUB_BUCKETS as u64 + sub_bucket) << shift;
+    lower + ((1u64 << shift) - 1)
+}
+
+// Histograms for every stage of one swapchain's captures
+pub struct StageLatencies {
+    stages: Vec<LatencyHistogram>,
+    // Monotonic time of the next periodic report
+    next_report_ns: AtomicU64,
+}
+
+impl StageLatencies {
+    pub fn new() -> Self {
+        Self {
+            stages: STAGES.iter().map(|_| LatencyHistogram::new()).collect(),
+            next_report_ns: AtomicU64::new(0),
+        }
+    }
+
+    pub fn record(&self, stage: Stage, value_ns: u64) {
+        self.stages[stage as usize].record(value_ns);
+    }
+
+    // Stages that have samples, by name
+    pub fn histograms(&self) -> impl Iterator<Item = (&'static str, &LatencyHistogram)> {
+        STAGES
+            .iter()
+            .map(|&stage| (stage.name(), &self.stages[stage as usize]))
+            .filter(|(_, histogram)| histogram.count() > 0)
+    }
+}
+
+// Append-only percentile report
+pub struct LatencyLog {
+    writer: Mutex<LineWriter<File>>,
+    // Interval between periodic reports (0 = only at teardown)
+    interval_ns: u64,
+}
+
+impl LatencyLog {
+    pub fn create(path: &str, interval_ns: u64) -> Result<Self, std::io::Error> {
+        let mut writer = LineWriter::new(File::create(path)?);
+        write!(writer, "# swapchain reason stage count mean_us")?;
+        for percentile in PERCENTILES {
+            write!(writer, " p{}_us", percentile)?;
+        }
+        writeln!(writer, " max_us")?;
+
+        Ok(Self {
+            writer: Mutex::new(writer),
+            interval_ns,
+        })
+    }
+
+    // Writes one line per stage that has samples
+    pub fn report(&self, swapchain: u64, latencies: &StageLatencies, reason: &str) {
+        let mut writer = self.writer.lock().unwrap();
+        for stage in STAGES {
+            let histogram = &latencies.stages[stage as usize];
+            if histogram.count() == 0 {
+                continue;
+            }
+            if let Err(e) = write_stage_line(&mut *writer, swapchain, reason, stage, histogram) {
+                log::error!("Failed to write latency report: {}", e);
+                return;
+            }
+        }
+    }
+
+    // Reports if the periodic interval has elapsed since the last report
+    pub fn report_if_due(&self, swapchain: u64, latencies: &StageLatencies, now_ns: u64) {
+        if self.interval_ns == 0 {
+            return;
+        }
+
+        let due = latencies.next_report_ns.load(Ordering::Relaxed);
+        if due == 0 {
+            // First call only arms the timer
+            latencies
+                .next_report_ns
+                .store(now_ns + self.interval_ns, Ordering::Relaxed);
+            return;
+        }
+        if now_ns < due {
+            return;
+        }
+
+        latencies
+            .next_report_ns
+            .store(now_ns + self.interval_ns, Ordering::Relaxed);
+        self.report(swapchain, latencies, "periodic");
+    }
+}
+
+fn write_stage_line(
+    writer: &mut impl Write,
+    swapchain: u64,
+    reason: &str,
+    stage: Stage,
+    histogram: &LatencyHistogram,
+) -> Result<(), std::io::Error> {
+    write!(
+        writer,
+        "{:#x} {} {} {} {:.1}",
+        swapchain,
+        reason,
+        stage.name(),
+        histogram.count(),
+        histogram.mean() / 1000.0
+    )?;
+    for percentile in PERCENTILES {
+        write!(
+            writer,
+            " {:.1}",
+            histogram.percentile(percentile) as f64 / 1000.0
+        )?;
+    }
+    writeln!(writer, " {:.1}", histogram.max() as f64 / 1000.0)
+}
@@ -1,15 +1,49 @@
 use ash::vk::{self, Handle};
 use libc::c_char;
 use std::{
+    borrow::Cow,
     collections::HashMap,
     ffi::CStr,
     fs, mem, slice,
     sync::{
-        atomic::{AtomicU32, Ordering},
-        Mutex,
+        atomic::{AtomicU32, AtomicU64, Ordering},
+        Mutex, OnceLock,
     },
+    time::Instant,
 };
 
+mod frame_hash;
+mod frame_select;
+mod frame_stats;
+mod golden;
+mod gpu_hash;
+mod gpu_timer;
+mod hot_log;
+mod image_memory;
+mod image_pool;
+mod latency;
+mod metrics;
+mod overhead;
+mod probe;
+#[cfg(feature = "bench")]
+mod synthetic;
+mod trace;
+
+use frame_hash::{FrameHasher, HashLog, HashVerdict};
+use frame_select::FrameSelector;
+use frame_stats::{FrameStats, StatsAccumulator, StatsFormat, StatsLog};
+use golden::{GoldenSet, GoldenVerdict};
+use gpu_hash::{DirtyRect, FrameChange, TileHashPipeline, TileHashTargets};
+use gpu_timer::{CaptureGpuTime, GpuTimer};
+use hot_log::Msg;
+use image_memory::ImageMemory;
+use image_pool::{ImageKey, ImagePool};
+use latency::{LatencyLog, Stage, StageLatencies};
+use metrics::{CheckOutcome, DropReason, Gauges, MetricsFile, MetricsSnapshot};
+use overhead::EntryPoint;
+use probe::usdt;
+use trace::Event;
+
 // Layer information
 const LAYER_NAME: &str = "VK_LAYER_PRIVATE_unseen";
 const LAYER_VERSION: u32 = 1;
@@ -17,13 +51,55 @@ const LAYER_SPEC_VERSION: u32 = vk::API_VERSION_1_0;
 const LAYER_DESCRIPTION: &str =
     "Vulkan frame capture layer for headless environments with direct host-visible capture";
 
+// Device extension implemented by the layer itself
+const INCREMENTAL_PRESENT_EXTENSION: &[u8] = b"VK_KHR_incremental_present";
+// Reported rectangles beyond this are merged into their bounding box
+const MAX_DAMAGE_RECTS: usize = 64;
+// Usage of every capture image, whatever the app asked for
+const CAPTURE_IMAGE_USAGE: vk::ImageUsageFlags = vk::ImageUsageFlags::from_raw(
+    vk::ImageUsageFlags::COLOR_ATTACHMENT.as_raw() | vk::ImageUsageFlags::TRANSFER_SRC.as_raw(),
+);
+
 // Configuration
 #[derive(Debug, Clone)]
 struct LayerConfig {
     output_dir: String,
     output_format: OutputFormat,
-    capture_frequency: u32,
-    max_frames: u32,
+    frame_selector: FrameSelector,
+    // Minimum wall-clock time between captures per swapchain (0 = unlimited)
+    capture_interval_ns: u64,
+    hash_mode: HashMode,
+    // Hash log of a known-good run to compare against
+    hash_reference: Option<String>,
+    // Skip frames identical to the previous capture of the same swapchain
+    skip_duplicates: bool,
+    // Detect unchanged frames with a compute pass before any host reads
+    gpu_hash: bool,
+    // Refresh a retained copy of the last frame from changed tiles only
+    dirty_rects: bool,
+    // Reference frames to compare against; only failing frames are written
+    golden_dir: Option<String>,
+    golden_min_psnr: f64,
+    golden_min_ssim: f64,
+    // Per-frame statistics sink; replaces image output
+    stats_format: Option<StatsFormat>,
+    // Per-stage capture latency histograms
+    latency: bool,
+    // Interval between periodic latency reports (0 = only at teardown)
+    latency_interval_ns: u64,
+    // Chrome trace of layer activity
+    trace: bool,
+    // Ring size per thread, in events
+    trace_events: usize,
+    // Per-entry-point call counts and CPU time
+    overhead: bool,
+    // Prometheus textfile to rewrite periodically
+    metrics_path: Option<String>,
+    metrics_interval_ns: u64,
+    // Records kept in the hot-path log ring (0 = live rate-limited logging only)
+    log_ring: usize,
+    // Bytes of retired swapchain images kept per device for reuse
+    image_pool_bytes: u64,
 }
 
 #[derive(Debug, Clone, PartialEq)]
@@ -32,8 +108,45 @@ enum OutputFormat {
     Png,
 }
 
+#[derive(Debug, Clone, PartialEq)]
+enum HashMode {
+    Off,
+    // Log a content hash alongside every written frame
+    Log,
+    // Log only the hash; pixels are written only for reference mismatches
+    Only,
+}
+
 impl Default for LayerConfig {
     fn default() -> Self {
+        let capture_frequency = std::env::var("VK_CAPTURE_FREQUENCY")
+            .ok()
+            .and_then(|s| s.parse().ok())
+            .unwrap_or(1);
+        let max_frames = std::env::var("VK_CAPTURE_MAX_FRAMES")
+            .ok()
+            .and_then(|s| s.parse().ok())
+            .unwrap_or(0);
+
+        // An explicit frame selection takes precedence over frequency/max frames
+        let frame_selector = match std::env::var("VK_CAPTURE_FRAMES") {
+            Ok(spec) => FrameSelector::parse(&spec).unwrap_or_else(|e| {
+                log::warn!("Ignoring VK_CAPTURE_FRAMES='{}': {}", spec, e);
+                FrameSelector::from_frequency(capture_frequency, max_frames)
+            }),
+            Err(_) => FrameSelector::from_frequency(capture_frequency, max_frames),
+        };
+
+        // Dirty rectangles come from the GPU tile hashes
+        let dirty_rects = std::env::var("VK_CAPTURE_DIRTY_RECTS").as_deref() == Ok("1");
+
+        let capture_interval_ns = std::env::var("VK_CAPTURE_MAX_FPS")
+            .ok()
+            .and_then(|s| s.parse::<f64>().ok())
+            .filter(|&fps| fps > 0.0)
+            .map(|fps| (1_000_000_000.0 / fps) as u64)
+            .unwrap_or(0);
+
         Self {
             output_dir: std::env::var("VK_CAPTURE_OUTPUT_DIR")
                 .unwrap_or_else(|_| "./captured_frames".to_string()),
@@ -41,14 +154,63 @@ impl Default for LayerConfig {
                 Ok("png") => OutputFormat::Png,
                 _ => OutputFormat::Ppm,
             },
-            capture_frequency: std::env::var("VK_CAPTURE_FREQUENCY")
+            frame_selector,
+            capture_interval_ns,
+            hash_mode: match std::env::var("VK_CAPTURE_HASH").as_deref() {
+                Ok("log") | Ok("1") => HashMode::Log,
+                Ok("only") => HashMode::Only,
+                _ => HashMode::Off,
+            },
+            hash_reference: std::env::var("VK_CAPTURE_HASH_REFERENCE").ok(),
+            skip_duplicates: std::env::var("VK_CAPTURE_SKIP_DUPLICATES").as_deref() == Ok("1"),
+            gpu_hash: dirty_rects || std::env::var("VK_CAPTURE_GPU_HASH").as_deref() == Ok("1"),
+            dirty_rects,
+            golden_dir: std::env::var("VK_CAPTURE_GOLDEN_DIR").ok(),
+            golden_min_psnr: std::env::var("VK_CAPTURE_GOLDEN_MIN_PSNR")
+                .ok()
+                .and_then(|s| s.parse().ok())
+                .unwrap_or(40.0),
+            golden_min_ssim: std::env::var("VK_CAPTURE_GOLDEN_MIN_SSIM")
+                .ok()
+                .and_then(|s| s.parse().ok())
+                .unwrap_or(0.98),
+            stats_format: match std::env::var("VK_CAPTURE_STATS").as_deref() {
+                Ok("csv") => Some(StatsFormat::Csv),
+                Ok("binary") => Some(StatsFormat::Binary),
+                _ => None,
+            },
+            latency: std::env::var("VK_CAPTURE_LATENCY").as_deref() == Ok("1"),
+            latency_interval_ns: std::env::var("VK_CAPTURE_LATENCY_INTERVAL")
+                .ok()
+                .and_then(|s| s.parse::<f64>().ok())
+                .filter(|&secs| secs > 0.0)
+                .map(|secs| (secs * 1_000_000_000.0) as u64)
+                .unwrap_or(0),
+            trace: std::env::var("VK_CAPTURE_TRACE").as_deref() == Ok("1"),
+            trace_events: std::env::var("VK_CAPTURE_TRACE_EVENTS")
                 .ok()
                 .and_then(|s| s.parse().ok())
-                .unwrap_or(1),
-            max_frames: std::env::var("VK_CAPTURE_MAX_FRAMES")
+                .filter(|&n| n > 0)
+                .unwrap_or(65536),
+            overhead: std::env::var("VK_CAPTURE_OVERHEAD").as_deref() == Ok("1"),
+            metrics_path: std::env::var("VK_CAPTURE_METRICS")
+                .ok()
+                .filter(|s| !s.is_empty()),
+            metrics_interval_ns: std::env::var("VK_CAPTURE_METRICS_INTERVAL")
+                .ok()
+                .and_then(|s| s.parse::<f64>().ok())
+                .filter(|&secs| secs > 0.0)
+                .map(|secs| (secs * 1_000_000_000.0) as u64)
+                .unwrap_or(10_000_000_000),
+            log_ring: std::env::var("VK_CAPTURE_LOG_RING")
                 .ok()
                 .and_then(|s| s.parse().ok())
                 .unwrap_or(0),
+            image_pool_bytes: std::env::var("VK_CAPTURE_IMAGE_POOL_MB")
+                .ok()
+                .and_then(|s| s.parse::<u64>().ok())
+                .unwrap_or(256)
+                << 20,
         }
     }
 }
@@ -61,6 +223,11 @@ struct InstanceData {
     create_device: Option<vk::PFN_vkCreateDevice>,
     devices: Mutex<HashMap<vk::Device, DeviceData>>,
     surfaces: Mutex<HashMap<vk::SurfaceKHR, SurfaceData>>,
+    hash_log: Option<HashLog>,
+    golden: Option<GoldenSet>,
+    stats_log: Option<StatsLog>,
+    latency_log: Option<LatencyLog>,
+    metrics: Option<MetricsFile>,
     config: LayerConfig,
 }
 
@@ -74,12 +241,26 @@ struct DeviceData {
     get_swapchain_images_khr: Option<vk::PFN_vkGetSwapchainImagesKHR>,
     acquire_next_image_khr: Option<vk::PFN_vkAcquireNextImageKHR>,
     queue_present_khr: Option<vk::PFN_vkQueuePresentKHR>,
+    // Signals and waits on the app's semaphores and fences for acquire and
+    // present
+    queue_submit: vk::PFN_vkQueueSubmit,
+    // Waits for the present queue before a capture reads its images
+    queue_wait_idle: vk::PFN_vkQueueWaitIdle,
     swapchains: Mutex<HashMap<vk::SwapchainKHR, SwapchainInfo>>,
     frame_counter: AtomicU32,
     device: vk::Device,
     command_pool: Option<vk::CommandPool>,
+    // The layer's own queue when the graphics family has a spare one,
+    // otherwise the app's first queue of the family
     graphics_queue: Option<vk::Queue>,
     graphics_queue_family: Option<u32>,
+    tile_hash: Option<TileHashPipeline>,
+    // Timestamps around capture submissions, when latency is reported
+    gpu_timer: Option<GpuTimer>,
+    // Blocks holding the swapchain images and tile hash buffers
+    image_memory: ImageMemory,
+    // Images of destroyed swapchains, for the next ones
+    retired_images: Mutex<ImagePool>,
 }
 
 // Surface data for headless surfaces
@@ -147,12 +328,198 @@ struct SwapchainInfo {
     format: vk::Format,
     extent: vk::Extent2D,
     image_count: u32,
+    // Monotonic time at which the next rate-limited capture is due
+    next_capture_ns: AtomicU64,
+    // Last captured content, for duplicate suppression
+    last_capture: Mutex<Option<CapturedContent>>,
+    // Statistics of the last frame read, reused for frames the GPU found
+    // unchanged
+    last_stats: Mutex<Option<FrameStats>>,
+    tile_hashes: Option<TileHashTargets>,
+    // RGB copy of the last capture, kept current from dirty rectangles
+    retained_frame: Mutex<Vec<u8>>,
+    // Damage reported with presents since the last capture
+    damage: Mutex<PresentDamage>,
+    latency: Option<StageLatencies>,
+}
+
+// Damage accumulated from VK_KHR_incremental_present regions
+#[derive(Default)]
+struct PresentDamage {
+    // Set once the app has reported regions for this swapchain
+    tracking: bool,
+    // A present without regions may have changed the whole image
+    full: bool,
+    rects: Vec<DirtyRect>,
+}
+
+struct CapturedContent {
+    frame_num: u32,
+    hash: u128,
+    // Number of later frames suppressed as identical to this one
+    repeats: u32,
+}
+
+impl SwapchainInfo {
+    // Claims a capture slot under the wall-clock rate limit. Slots are spaced
+    // `interval_ns` apart so the long-run capture rate stays fixed regardless
+    // of the application's frame rate.
+    fn claim_capture_slot(&self, interval_ns: u64) -> bool {
+        if interval_ns == 0 {
+            return true;
+        }
+
+        let now = monotonic_ns();
+        let due = self.next_capture_ns.load(Ordering::Relaxed);
+        if now < due {
+            return false;
+        }
+
+        // Don't accumulate a burst of slots after a stall
+        let mut next_due = due + interval_ns;
+        if next_due <= now {
+            next_due = now + interval_ns;
+        }
+        self.next_capture_ns.store(next_due, Ordering::Relaxed);
+        true
+    }
+
+    // Gives up the images for reuse at destruction. The tile hash buffers
+    // alias the images and go with them.
+    fn retire(
+        &mut self,
+        device: &ash::Device,
+        image_memory: &ImageMemory,
+    ) -> (ImageKey, Vec<HostVisibleImage>) {
+        if let Some(tile_hashes) = self.tile_hashes.take() {
+            unsafe { tile_hashes.destroy(device, image_memory) };
+        }
+        let key = ImageKey::new(self.format, self.extent, CAPTURE_IMAGE_USAGE);
+        (key, mem::take(&mut self.images))
+    }
+
+    // True if `hash` repeats the last captured frame. A run of repeats is
+    // logged as a single count once it ends.
+    fn is_repeat(&self, frame_num: u32, hash: u128, hash_log: &HashLog) -> bool {
+        let mut last_capture = self.last_capture.lock().unwrap();
+        if let Some(last) = last_capture.as_mut() {
+            if last.hash == hash {
+                last.repeats += 1;
+                return true;
+            }
+        }
+
+        let current = CapturedContent {
+            frame_num,
+            hash,
+            repeats: 0,
+        };
+        if let Some(last) = last_capture.replace(current) {
+            if last.repeats > 0 {
+                hash_log.record_repeats(last.frame_num, last.hash, last.repeats);
+            }
+        }
+        false
+    }
+
+    fn record_latency(&self, stage: Stage, start_ns: u64) {
+        if let Some(latency) = &self.latency {
+            latency.record(stage, monotonic_ns().saturating_sub(start_ns));
+        }
+    }
+
+    // Appends the latency percentiles of this swapchain to the report
+    fn report_latency(
+        &self,
+        swapchain: vk::SwapchainKHR,
+        instance_data: &InstanceData,
+        reason: &str,
+    ) {
+        if let (Some(latency_log), Some(latency)) = (&instance_data.latency_log, &self.latency) {
+            latency_log.report(swapchain.as_raw(), latency, reason);
+        }
+    }
+
+    // Adds the damage of one present; `None` if it reported no regions
+    fn add_damage(&self, regions: Option<&[vk::RectLayerKHR]>) {
+        let mut damage = self.damage.lock().unwrap();
+        let regions = match regions {
+            Some(regions) if !regions.is_empty() => regions,
+            // An empty region list means the whole image changed
+            Some(_) => {
+                damage.tracking = true;
+                damage.full = true;
+                return;
+            }
+            None => {
+                damage.full |= damage.tracking;
+                return;
+            }
+        };
+
+        damage.tracking = true;
+        if damage.full {
+            return;
+        }
+        for region in regions {
+            let x = (region.offset.x.max(0) as u32).min(self.extent.width);
+            let y = (region.offset.y.max(0) as u32).min(self.extent.height);
+            let rect = DirtyRect {
+                x,
+                y,
+                width: region.extent.width.min(self.extent.width - x),
+                height: region.extent.height.min(self.extent.height - y),
+            };
+            if rect.width > 0 && rect.height > 0 {
+                damage.rects.push(rect);
+            }
+        }
+
+        if damage.rects.len() > MAX_DAMAGE_RECTS {
+            let bounds = bounding_rect(&damage.rects);
+            damage.rects.clear();
+            damage.rects.push(bounds);
+        }
+    }
+
+    // Damage since the last call, or None if the app never reported any
+    fn take_damage(&self) -> Option<FrameChange> {
+        let mut damage = self.damage.lock().unwrap();
+        if !damage.tracking {
+            return None;
+        }
+        let rects = mem::take(&mut damage.rects);
+        if mem::take(&mut damage.full) {
+            Some(FrameChange::Full)
+        } else {
+            Some(FrameChange::Dirty(rects))
+        }
+    }
+
+    // Counts a frame found identical to the last capture without hashing it
+    // on the host
+    fn note_repeat(&self) {
+        if let Some(last) = self.last_capture.lock().unwrap().as_mut() {
+            last.repeats += 1;
+        }
+    }
+
+    fn flush_repeats(&self, hash_log: &HashLog) {
+        if let Some(last) = self.last_capture.lock().unwrap().take() {
+            if last.repeats > 0 {
+                hash_log.record_repeats(last.frame_num, last.hash, last.repeats);
+            }
+        }
+    }
 }
 
 // Host-visible image with direct CPU access
 struct HostVisibleImage {
     image: vk::Image,
+    // Block of the device's capture memory and the image's range in it
     memory: vk::DeviceMemory,
+    offset: u64,
+    memory_type_index: u32,
     mapped_ptr: *mut u8,
     size: u64,
     row_pitch: u32,
@@ -201,6 +568,7 @@ pub unsafe extern "C" fn vkGetInstanceProcAddr(
     instance: vk::Instance,
     p_name: *const c_char,
 ) -> vk::PFN_vkVoidFunction {
+    let _call = overhead::enter(EntryPoint::GetInstanceProcAddr);
     if p_name.is_null() {
         return None;
     }
@@ -208,7 +576,7 @@ pub unsafe extern "C" fn vkGetInstanceProcAddr(
     let name = CStr::from_ptr(p_name);
     let name_str = name.to_str().unwrap_or("");
 
-    log::debug!("vkGetInstanceProcAddr called with: {}", name_str);
+    log::trace!("vkGetInstanceProcAddr called with: {}", name_str);
 
     // Handle layer-specific functions
     match name_str {
@@ -256,7 +624,7 @@ pub unsafe extern "C" fn vkGetInstanceProcAddr(
 
     // Forward to next layer/driver if we have an instance
     if instance != vk::Instance::null() {
-        if let Some(ref layer_data) = *LAYER_DATA.lock().unwrap() {
+        if let Some(ref layer_data) = *overhead::lock(&LAYER_DATA) {
             if let Some(get_proc_addr) = layer_data.get_instance_proc_addr {
                 return get_proc_addr(instance, p_name);
             }
@@ -271,6 +639,7 @@ pub unsafe extern "C" fn vkGetDeviceProcAddr(
     device: vk::Device,
     p_name: *const c_char,
 ) -> vk::PFN_vkVoidFunction {
+    let _call = overhead::enter(EntryPoint::GetDeviceProcAddr);
     if p_name.is_null() {
         return None;
     }
@@ -278,7 +647,7 @@ pub unsafe extern "C" fn vkGetDeviceProcAddr(
     let name = CStr::from_ptr(p_name);
     let name_str = name.to_str().unwrap_or("");
 
-    log::debug!("vkGetDeviceProcAddr called with: {}", name_str);
+    log::trace!("vkGetDeviceProcAddr called with: {}", name_str);
 
     // Handle swapchain functions we intercept
     match name_str {
@@ -299,13 +668,13 @@ pub unsafe extern "C" fn vkGetDeviceProcAddr(
         return None;
     }
 
-    let layer_data_guard = LAYER_DATA.lock().unwrap();
+    let layer_data_guard = overhead::lock(&LAYER_DATA);
     let layer_data = match &*layer_data_guard {
         Some(data) => data,
         None => return None,
     };
 
-    let devices = layer_data.devices.lock().unwrap();
+    let devices = overhead::lock(&layer_data.devices);
     let device_data = match devices.get(&device) {
         Some(data) => data,
         None => return None,
@@ -324,6 +693,7 @@ pub unsafe extern "C" fn vkCreateInstance(
     p_allocator: *const vk::AllocationCallbacks,
     p_instance: *mut vk::Instance,
 ) -> vk::Result {
+    let _call = overhead::enter(EntryPoint::CreateInstance);
     // Initialize logging if not already done
     if std::env::var("RUST_LOG").is_ok() {
         let _ = env_logger::try_init();
@@ -365,6 +735,98 @@ pub unsafe extern "C" fn vkCreateInstance(
     let instance = *p_instance;
     log::info!("Real instance created successfully: {:?}", instance);
 
+    // Duplicate suppression needs frame hashes and records repeats in the log
+    let hash_log = if config.hash_mode != HashMode::Off || config.skip_duplicates {
+        let path = format!("{}/frame_hashes.log", config.output_dir);
+        let created = fs::create_dir_all(&config.output_dir)
+            .and_then(|_| HashLog::create(&path, config.hash_reference.as_deref()));
+        match created {
+            Ok(hash_log) => {
+                log::info!("Writing frame hashes to {}", path);
+                Some(hash_log)
+            }
+            Err(e) => {
+                log::error!("Failed to open frame hash log {}: {}", path, e);
+                if config.hash_mode == HashMode::Only {
+                    log::error!("Hash-only capture without a hash log, no frames will be written");
+                }
+                None
+            }
+        }
+    } else {
+        None
+    };
+
+    // Reference frames are mapped once for the lifetime of the instance
+    let golden = config.golden_dir.as_ref().and_then(|golden_dir| {
+        let report_path = format!("{}/golden_report.txt", config.output_dir);
+        let loaded = fs::create_dir_all(&config.output_dir).and_then(|_| {
+            GoldenSet::load(
+                golden_dir,
+                &report_path,
+                config.golden_min_psnr,
+                config.golden_min_ssim,
+            )
+        });
+        match loaded {
+            Ok(golden) => Some(golden),
+            Err(e) => {
+                log::error!("Failed to load golden frames from {}: {}", golden_dir, e);
+                None
+            }
+        }
+    });
+
+    let stats_log = config.stats_format.and_then(|format| {
+        let path = match format {
+            StatsFormat::Csv => format!("{}/frame_stats.csv", config.output_dir),
+            StatsFormat::Binary => format!("{}/frame_stats.bin", config.output_dir),
+        };
+        let created =
+            fs::create_dir_all(&config.output_dir).and_then(|_| StatsLog::create(&path, format));
+        match created {
+            Ok(stats_log) => {
+                log::info!("Writing frame statistics to {}", path);
+                Some(stats_log)
+            }
+            Err(e) => {
+                log::error!("Failed to open frame statistics log {}: {}", path, e);
+                None
+            }
+        }
+    });
+
+    let latency_log = if config.latency {
+        let path = format!("{}/latency_report.txt", config.output_dir);
+        let created = fs::create_dir_all(&config.output_dir)
+            .and_then(|_| LatencyLog::create(&path, config.latency_interval_ns));
+        match created {
+            Ok(latency_log) => {
+                log::info!("Writing capture latency percentiles to {}", path);
+                Some(latency_log)
+            }
+            Err(e) => {
+                log::error!("Failed to open latency report {}: {}", path, e);
+                None
+            }
+        }
+    } else {
+        None
+    };
+
+    let metrics = config.metrics_path.as_ref().map(|path| {
+        log::info!("Writing Prometheus metrics to {}", path);
+        MetricsFile::new(path.clone(), config.metrics_interval_ns)
+    });
+
+    hot_log::init(config.log_ring);
+    if config.trace {
+        trace::start(config.trace_events);
+    }
+    if config.overhead {
+        overhead::start();
+    }
+
     // Store instance data with real chaining
     let instance_data = InstanceData {
         instance,
@@ -373,10 +835,15 @@ pub unsafe extern "C" fn vkCreateInstance(
         create_device: None,
         devices: Mutex::new(HashMap::new()),
         surfaces: Mutex::new(HashMap::new()),
+        hash_log,
+        golden,
+        stats_log,
+        latency_log,
+        metrics,
         config,
     };
 
-    let mut layer_data_guard = LAYER_DATA.lock().unwrap();
+    let mut layer_data_guard = overhead::lock(&LAYER_DATA);
     *layer_data_guard = Some(instance_data);
 
     vk::Result::SUCCESS
@@ -387,10 +854,40 @@ pub unsafe extern "C" fn vkDestroyInstance(
     instance: vk::Instance,
     p_allocator: *const vk::AllocationCallbacks,
 ) {
+    let _call = overhead::enter(EntryPoint::DestroyInstance);
     log::info!("Destroying Vulkan instance");
 
-    let mut layer_data_guard = LAYER_DATA.lock().unwrap();
+    let mut layer_data_guard = overhead::lock(&LAYER_DATA);
     if let Some(instance_data) = layer_data_guard.take() {
+        // Swapchains the app never destroyed still get their report
+        for device_data in overhead::lock(&instance_data.devices).values() {
+            for (&swapchain, swapchain_info) in overhead::lock(&device_data.swapchains).iter() {
+                swapchain_info.report_latency(swapchain, &instance_data, "instance_destroy");
+            }
+        }
+
+        if let Some(metrics) = &instance_data.metrics {
+            sample_metrics(metrics, &overhead::lock(&instance_data.devices)).write();
+        }
+
+        hot_log::dump();
+
+        if overhead::enabled() {
+            let path = format!("{}/overhead_report.txt", instance_data.config.output_dir);
+            match overhead::report(&path) {
+                Ok(()) => log::info!("Wrote layer overhead report to {}", path),
+                Err(e) => log::error!("Failed to write overhead report {}: {}", path, e),
+            }
+        }
+
+        if trace::enabled() {
+            let path = format!("{}/trace.json", instance_data.config.output_dir);
+            match trace::export(&path) {
+                Ok(events) => log::info!("Wrote {} trace events to {}", events, path),
+                Err(e) => log::error!("Failed to write trace {}: {}", path, e),
+            }
+        }
+
         if let Some(destroy_fn) = instance_data.destroy_instance {
             (destroy_fn)(instance, p_allocator);
         }
@@ -404,9 +901,11 @@ pub unsafe extern "C" fn vkCreateDevice(
     p_allocator: *const vk::AllocationCallbacks,
     p_device: *mut vk::Device,
 ) -> vk::Result {
+    let _call = overhead::enter(EntryPoint::CreateDevice);
+    let _span = trace::span(Event::CreateDevice);
     log::info!("Creating Vulkan device");
 
-    let layer_data_guard = LAYER_DATA.lock().unwrap();
+    let layer_data_guard = overhead::lock(&LAYER_DATA);
     let instance_data = match &*layer_data_guard {
         Some(data) => data,
         None => return vk::Result::ERROR_INITIALIZATION_FAILED,
@@ -424,8 +923,44 @@ pub unsafe extern "C" fn vkCreateDevice(
         return vk::Result::ERROR_INITIALIZATION_FAILED;
     }
 
+    let ash_instance = unsafe {
+        ash::Instance::load(
+            &ash::Entry::load().unwrap().static_fn(),
+            instance_data.instance,
+        )
+    };
+
+    // Present regions are consumed by the layer, so the extension is only
+    // passed on if the driver has it too
+    let mut next_create_info = *p_create_info;
+    let enabled_extensions =
+        next_device_extensions(&ash_instance, physical_device, &next_create_info);
+    next_create_info.enabled_extension_count = enabled_extensions.len() as u32;
+    next_create_info.pp_enabled_extension_names = enabled_extensions.as_ptr();
+
+    // The layer submits from vkAcquireNextImageKHR and vkQueuePresentKHR,
+    // where the app may be submitting to any of its own queues, so it asks
+    // for a queue of its own when the graphics family has one to spare
+    let mut queue_create_infos = if next_create_info.queue_create_info_count > 0 {
+        slice::from_raw_parts(
+            next_create_info.p_queue_create_infos,
+            next_create_info.queue_create_info_count as usize,
+        )
+        .to_vec()
+    } else {
+        Vec::new()
+    };
+    let mut queue_priorities = Vec::new();
+    let layer_queue_index = add_layer_queue(
+        &ash_instance,
+        physical_device,
+        &mut queue_create_infos,
+        &mut queue_priorities,
+    );
+    next_create_info.p_queue_create_infos = queue_create_infos.as_ptr();
+
     // Call next layer's vkCreateDevice
-    let result = next_create_device(physical_device, p_create_info, p_allocator, p_device);
+    let result = next_create_device(physical_device, &next_create_info, p_allocator, p_device);
     if result != vk::Result::SUCCESS {
         log::error!("Next layer's vkCreateDevice failed: {:?}", result);
         return result;
@@ -442,12 +977,6 @@ pub unsafe extern "C" fn vkCreateDevice(
         ));
 
     // Create ash device wrapper for the REAL device
-    let ash_instance = unsafe {
-        ash::Instance::load(
-            &ash::Entry::load().unwrap().static_fn(),
-            instance_data.instance,
-        )
-    };
     let ash_device = ash::Device::load(&ash_instance.fp_v1_0(), device);
 
     // Find graphics queue from the REAL device creation info
@@ -455,6 +984,8 @@ pub unsafe extern "C" fn vkCreateDevice(
     let mut graphics_queue_family = None;
     let mut graphics_queue = None;
     let mut command_pool = None;
+    let mut tile_hash = None;
+    let mut gpu_timer = None;
 
     if create_info.queue_create_info_count > 0 {
         let queue_create_infos = slice::from_raw_parts(
@@ -471,9 +1002,39 @@ pub unsafe extern "C" fn vkCreateDevice(
                 let props = &queue_family_properties[queue_create_info.queue_family_index as usize];
                 if props.queue_flags.contains(vk::QueueFlags::GRAPHICS) {
                     graphics_queue_family = Some(queue_create_info.queue_family_index);
-                    // Get the REAL graphics queue from the REAL device
-                    graphics_queue =
-                        Some(ash_device.get_device_queue(queue_create_info.queue_family_index, 0));
+                    let limits = ash_instance
+                        .get_physical_device_properties(physical_device)
+                        .limits;
+                    if instance_data.config.gpu_hash
+                        && props.queue_flags.contains(vk::QueueFlags::COMPUTE)
+                    {
+                        match TileHashPipeline::create(&ash_device, limits) {
+                            Ok(pipeline) => tile_hash = Some(pipeline),
+                            Err(e) => log::warn!("Failed to create tile hash pipeline: {:?}", e),
+                        }
+                    }
+                    if instance_data.config.latency {
+                        match GpuTimer::create(
+                            &ash_device,
+                            limits.timestamp_period,
+                            props.timestamp_valid_bits,
+                        ) {
+                            Ok(timer) => gpu_timer = timer,
+                            Err(e) => log::warn!("Failed to create timestamp query pool: {:?}", e),
+                        }
+                    }
+                    // Without a queue of its own, the layer shares the
+                    // app's first queue of the family
+                    graphics_queue = Some(ash_device.get_device_queue(
+                        queue_create_info.queue_family_index,
+                        layer_queue_index.unwrap_or(0),
+                    ));
+                    if layer_queue_index.is_none() {
+                        log::warn!(
+                            "No spare queue in family {}, sharing the app's queue 0",
+                            queue_create_info.queue_family_index
+                        );
+                    }
                     break;
                 }
             }
@@ -509,16 +1070,27 @@ pub unsafe extern "C" fn vkCreateDevice(
         get_swapchain_images_khr: None,
         acquire_next_image_khr: None,
         queue_present_khr: None,
+        queue_submit: ash_device.fp_v1_0().queue_submit,
+        queue_wait_idle: ash_device.fp_v1_0().queue_wait_idle,
         swapchains: Mutex::new(HashMap::new()),
         frame_counter: AtomicU32::new(0),
         device,
         command_pool,
         graphics_queue,
         graphics_queue_family,
+        tile_hash,
+        gpu_timer,
+        image_memory: ImageMemory::new(
+            ash_instance
+                .get_physical_device_properties(physical_device)
+                .limits
+                .buffer_image_granularity,
+        ),
+        retired_images: Mutex::new(ImagePool::new(instance_data.config.image_pool_bytes)),
     };
 
     // Store device data
-    let mut devices = instance_data.devices.lock().unwrap();
+    let mut devices = overhead::lock(&instance_data.devices);
     devices.insert(device, device_data);
 
     vk::Result::SUCCESS
@@ -529,33 +1101,57 @@ pub unsafe extern "C" fn vkDestroyDevice(
     device: vk::Device,
     p_allocator: *const vk::AllocationCallbacks,
 ) {
+    let _call = overhead::enter(EntryPoint::DestroyDevice);
+    let _span = trace::span(Event::DestroyDevice);
     log::info!("Destroying Vulkan device");
 
-    let layer_data_guard = LAYER_DATA.lock().unwrap();
+    let layer_data_guard = overhead::lock(&LAYER_DATA);
     let instance_data = match &*layer_data_guard {
         Some(data) => data,
         None => return,
     };
 
-    let mut devices = instance_data.devices.lock().unwrap();
+    let mut devices = overhead::lock(&instance_data.devices);
     if let Some(device_data) = devices.remove(&device) {
+        let ash_instance = unsafe {
+            ash::Instance::load(
+                &ash::Entry::load().unwrap().static_fn(),
+                instance_data.instance,
+            )
+        };
+        let ash_device = ash::Device::load(&ash_instance.fp_v1_0(), device);
+
         // Clean up REAL command pool if it exists
         if let Some(pool) = device_data.command_pool {
-            let ash_instance = unsafe {
-                ash::Instance::load(
-                    &ash::Entry::load().unwrap().static_fn(),
-                    instance_data.instance,
-                )
-            };
-            let ash_device = ash::Device::load(&ash_instance.fp_v1_0(), device);
             ash_device.destroy_command_pool(pool, None);
             log::info!("Destroyed REAL command pool for device");
         }
 
         // Clean up all swapchains for this device
         let swapchains = device_data.swapchains.into_inner().unwrap();
-        for (_, swapchain_info) in swapchains {
-            cleanup_host_visible_images(&swapchain_info.images);
+        for (swapchain, swapchain_info) in swapchains {
+            if let Some(hash_log) = &instance_data.hash_log {
+                swapchain_info.flush_repeats(hash_log);
+            }
+            swapchain_info.report_latency(swapchain, instance_data, "destroy");
+            if let Some(tile_hashes) = &swapchain_info.tile_hashes {
+                tile_hashes.destroy(&ash_device, &device_data.image_memory);
+            }
+            cleanup_host_visible_images(
+                &ash_device,
+                &device_data.image_memory,
+                &swapchain_info.images,
+            );
+        }
+        let pooled = device_data.retired_images.into_inner().unwrap().drain();
+        cleanup_host_visible_images(&ash_device, &device_data.image_memory, &pooled);
+        device_data.image_memory.destroy(&ash_device);
+
+        if let Some(tile_hash) = &device_data.tile_hash {
+            tile_hash.destroy(&ash_device);
+        }
+        if let Some(gpu_timer) = &device_data.gpu_timer {
+            gpu_timer.destroy(&ash_device);
         }
 
         // Call next layer's vkDestroyDevice
@@ -577,9 +1173,10 @@ pub unsafe extern "C" fn vkCreateHeadlessSurfaceEXT(
     _p_allocator: *const vk::AllocationCallbacks,
     p_surface: *mut vk::SurfaceKHR,
 ) -> vk::Result {
+    let _call = overhead::enter(EntryPoint::CreateHeadlessSurface);
     log::info!("Creating headless surface");
 
-    let layer_data_guard = LAYER_DATA.lock().unwrap();
+    let layer_data_guard = overhead::lock(&LAYER_DATA);
     let instance_data = match &*layer_data_guard {
         Some(data) => data,
         None => return vk::Result::ERROR_INITIALIZATION_FAILED,
@@ -595,7 +1192,7 @@ pub unsafe extern "C" fn vkCreateHeadlessSurfaceEXT(
 
     // Store surface data
     let surface_data = SurfaceData::default();
-    let mut surfaces = instance_data.surfaces.lock().unwrap();
+    let mut surfaces = overhead::lock(&instance_data.surfaces);
     surfaces.insert(dummy_surface, surface_data);
 
     log::info!("Headless surface created successfully: {:?}", dummy_surface);
@@ -608,9 +1205,10 @@ pub unsafe extern "C" fn vkDestroySurfaceKHR(
     surface: vk::SurfaceKHR,
     _p_allocator: *const vk::AllocationCallbacks,
 ) {
+    let _call = overhead::enter(EntryPoint::DestroySurface);
     log::info!("Destroying surface");
 
-    let layer_data_guard = LAYER_DATA.lock().unwrap();
+    let layer_data_guard = overhead::lock(&LAYER_DATA);
     let instance_data = match &*layer_data_guard {
         Some(data) => data,
         None => return,
@@ -620,7 +1218,7 @@ pub unsafe extern "C" fn vkDestroySurfaceKHR(
         return;
     }
 
-    let mut surfaces = instance_data.surfaces.lock().unwrap();
+    let mut surfaces = overhead::lock(&instance_data.surfaces);
     surfaces.remove(&surface);
 }
 
@@ -630,15 +1228,16 @@ pub unsafe extern "C" fn vkGetPhysicalDeviceSurfaceCapabilitiesKHR(
     surface: vk::SurfaceKHR,
     p_surface_capabilities: *mut vk::SurfaceCapabilitiesKHR,
 ) -> vk::Result {
+    let _call = overhead::enter(EntryPoint::GetSurfaceCapabilities);
     log::debug!("Getting surface capabilities");
 
-    let layer_data_guard = LAYER_DATA.lock().unwrap();
+    let layer_data_guard = overhead::lock(&LAYER_DATA);
     let instance_data = match &*layer_data_guard {
         Some(data) => data,
         None => return vk::Result::ERROR_INITIALIZATION_FAILED,
     };
 
-    let surfaces = instance_data.surfaces.lock().unwrap();
+    let surfaces = overhead::lock(&instance_data.surfaces);
     let surface_data = match surfaces.get(&surface) {
         Some(data) => data,
         None => return vk::Result::ERROR_SURFACE_LOST_KHR,
@@ -655,15 +1254,16 @@ pub unsafe extern "C" fn vkGetPhysicalDeviceSurfaceFormatsKHR(
     p_surface_format_count: *mut u32,
     p_surface_formats: *mut vk::SurfaceFormatKHR,
 ) -> vk::Result {
+    let _call = overhead::enter(EntryPoint::GetSurfaceFormats);
     log::debug!("Getting surface formats");
 
-    let layer_data_guard = LAYER_DATA.lock().unwrap();
+    let layer_data_guard = overhead::lock(&LAYER_DATA);
     let instance_data = match &*layer_data_guard {
         Some(data) => data,
         None => return vk::Result::ERROR_INITIALIZATION_FAILED,
     };
 
-    let surfaces = instance_data.surfaces.lock().unwrap();
+    let surfaces = overhead::lock(&instance_data.surfaces);
     let surface_data = match surfaces.get(&surface) {
         Some(data) => data,
         None => return vk::Result::ERROR_SURFACE_LOST_KHR,
@@ -689,15 +1289,16 @@ pub unsafe extern "C" fn vkGetPhysicalDeviceSurfacePresentModesKHR(
     p_present_mode_count: *mut u32,
     p_present_modes: *mut vk::PresentModeKHR,
 ) -> vk::Result {
+    let _call = overhead::enter(EntryPoint::GetSurfacePresentModes);
     log::debug!("Getting surface present modes");
 
-    let layer_data_guard = LAYER_DATA.lock().unwrap();
+    let layer_data_guard = overhead::lock(&LAYER_DATA);
     let instance_data = match &*layer_data_guard {
         Some(data) => data,
         None => return vk::Result::ERROR_INITIALIZATION_FAILED,
     };
 
-    let surfaces = instance_data.surfaces.lock().unwrap();
+    let surfaces = overhead::lock(&instance_data.surfaces);
     let surface_data = match surfaces.get(&surface) {
         Some(data) => data,
         None => return vk::Result::ERROR_SURFACE_LOST_KHR,
@@ -723,6 +1324,7 @@ pub unsafe extern "C" fn vkGetPhysicalDeviceSurfaceSupportKHR(
     _surface: vk::SurfaceKHR,
     p_supported: *mut vk::Bool32,
 ) -> vk::Result {
+    let _call = overhead::enter(EntryPoint::GetSurfaceSupport);
     log::debug!("Checking surface support");
     // Always support presentation in headless mode
     *p_supported = vk::TRUE;
@@ -736,6 +1338,8 @@ pub unsafe extern "C" fn vkCreateSwapchainKHR(
     _p_allocator: *const vk::AllocationCallbacks,
     p_swapchain: *mut vk::SwapchainKHR,
 ) -> vk::Result {
+    let _call = overhead::enter(EntryPoint::CreateSwapchain);
+    let _span = trace::span(Event::CreateSwapchain);
     log::info!("Creating swapchain with host-visible images");
 
     let create_info = &*p_create_info;
@@ -747,13 +1351,13 @@ pub unsafe extern "C" fn vkCreateSwapchainKHR(
         create_info.min_image_count
     );
 
-    let layer_data_guard = LAYER_DATA.lock().unwrap();
+    let layer_data_guard = overhead::lock(&LAYER_DATA);
     let instance_data = match &*layer_data_guard {
         Some(data) => data,
         None => return vk::Result::ERROR_INITIALIZATION_FAILED,
     };
 
-    let devices = instance_data.devices.lock().unwrap();
+    let devices = overhead::lock(&instance_data.devices);
     let device_data = match devices.get(&device) {
         Some(data) => data,
         None => return vk::Result::ERROR_INITIALIZATION_FAILED,
@@ -771,33 +1375,94 @@ pub unsafe extern "C" fn vkCreateSwapchainKHR(
         )
     };
     let ash_device = ash::Device::load(&ash_instance.fp_v1_0(), device);
-    let host_images = match create_host_visible_images(
-        &ash_device,
-        device_data.physical_device,
-        create_info.image_extent,
+
+    // A replaced swapchain keeps its images until the app destroys it, since
+    // it may still have them acquired or in flight
+    let key = ImageKey::new(
         create_info.image_format,
-        image_count,
-    ) {
-        Ok(images) => images,
-        Err(e) => {
-            log::error!("Failed to create host-visible images: {:?}", e);
-            return e;
+        create_info.image_extent,
+        CAPTURE_IMAGE_USAGE,
+    );
+    let mut host_images =
+        overhead::lock(&device_data.retired_images).take(key, image_count as usize);
+    let reused = host_images.len();
+    if reused < image_count as usize {
+        let create = || {
+            create_host_visible_images(
+                &ash_instance,
+                &ash_device,
+                device_data,
+                create_info.image_extent,
+                create_info.image_format,
+                image_count - reused as u32,
+            )
+        };
+        let created =
+            match create() {
+                // Pooled images may be what fills the heap
+                Err(
+                    vk::Result::ERROR_OUT_OF_DEVICE_MEMORY | vk::Result::ERROR_OUT_OF_HOST_MEMORY,
+                ) if trim_image_pool(&ash_device, device_data) > 0 => create(),
+                result => result,
+            };
+        match created {
+            Ok(images) => host_images.extend(images),
+            Err(e) => {
+                log::error!("Failed to create host-visible images: {:?}", e);
+                retire_host_visible_images(&ash_device, device_data, key, host_images);
+                return e;
+            }
         }
-    };
+    }
 
     log::info!(
-        "Created {} host-visible images for direct CPU access",
-        host_images.len()
+        "Swapchain has {} host-visible images for direct CPU access, {} reused",
+        host_images.len(),
+        reused
     );
 
+    // Falls back to host-side checks when the layout can't be hashed on the GPU
+    let bytes_per_pixel = format_bytes_per_pixel(create_info.image_format);
+    let tile_hashes = match (&device_data.tile_hash, bytes_per_pixel) {
+        (Some(pipeline), Some(bytes_per_pixel)) => {
+            match TileHashTargets::create(
+                &ash_instance,
+                &ash_device,
+                device_data.physical_device,
+                &device_data.image_memory,
+                pipeline,
+                &host_images,
+                bytes_per_pixel,
+                create_info.image_extent,
+            ) {
+                Ok(targets) => targets,
+                Err(e) => {
+                    log::warn!("Failed to create tile hash buffers: {:?}", e);
+                    None
+                }
+            }
+        }
+        _ => None,
+    };
+
     let swapchain_info = SwapchainInfo {
         images: host_images,
         format: create_info.image_format,
         extent: create_info.image_extent,
         image_count,
+        next_capture_ns: AtomicU64::new(0),
+        last_capture: Mutex::new(None),
+        last_stats: Mutex::new(None),
+        tile_hashes,
+        retained_frame: Mutex::new(Vec::new()),
+        damage: Mutex::new(PresentDamage::default()),
+        latency: instance_data
+            .latency_log
+            .as_ref()
+            .map(|_| StageLatencies::new()),
     };
 
-    let mut swapchains = device_data.swapchains.lock().unwrap();
+    let mut swapchains = overhead::lock(&device_data.swapchains);
     swapchains.insert(dummy_swapchain, swapchain_info);
 
     log::info!("Swapchain created successfully: {:?}", dummy_swapchain);
@@ -810,27 +1475,39 @@ pub unsafe extern "C" fn vkDestroySwapchainKHR(
     swapchain: vk::SwapchainKHR,
     _p_allocator: *const vk::AllocationCallbacks,
 ) {
+    let _call = overhead::enter(EntryPoint::DestroySwapchain);
+    let _span = trace::span(Event::DestroySwapchain);
     log::info!("Destroying swapchain");
 
-    let layer_data_guard = LAYER_DATA.lock().unwrap();
+    let layer_data_guard = overhead::lock(&LAYER_DATA);
     let instance_data = match &*layer_data_guard {
         Some(data) => data,
         None => return,
     };
 
-    let devices = instance_data.devices.lock().unwrap();
+    let devices = overhead::lock(&instance_data.devices);
     let device_data = match devices.get(&device) {
         Some(data) => data,
         None => return,
     };
 
     let swapchain_info = {
-        let mut swapchains = device_data.swapchains.lock().unwrap();
+        let mut swapchains = overhead::lock(&device_data.swapchains);
         swapchains.remove(&swapchain)
     };
 
-    if let Some(info) = swapchain_info {
-        cleanup_host_visible_images(&info.images);
+    if let Some(mut info) = swapchain_info {
+        if let Some(hash_log) = &instance_data.hash_log {
+            info.flush_repeats(hash_log);
+        }
+        info.report_latency(swapchain, instance_data, "destroy");
+        let ash_instance = ash::Instance::load(
+            &ash::Entry::load().unwrap().static_fn(),
+            instance_data.instance,
+        );
+        let ash_device = ash::Device::load(&ash_instance.fp_v1_0(), device);
+        let (key, images) = info.retire(&ash_device, &device_data.image_memory);
+        retire_host_visible_images(&ash_device, device_data, key, images);
     }
 }
 
@@ -841,21 +1518,23 @@ pub unsafe extern "C" fn vkGetSwapchainImagesKHR(
     p_swapchain_image_count: *mut u32,
     p_swapchain_images: *mut vk::Image,
 ) -> vk::Result {
+    let _call = overhead::enter(EntryPoint::GetSwapchainImages);
+    let _span = trace::span(Event::GetSwapchainImages);
     log::debug!("Getting swapchain images");
 
-    let layer_data_guard = LAYER_DATA.lock().unwrap();
+    let layer_data_guard = overhead::lock(&LAYER_DATA);
     let instance_data = match &*layer_data_guard {
         Some(data) => data,
         None => return vk::Result::ERROR_INITIALIZATION_FAILED,
     };
 
-    let devices = instance_data.devices.lock().unwrap();
+    let devices = overhead::lock(&instance_data.devices);
     let device_data = match devices.get(&device) {
         Some(data) => data,
         None => return vk::Result::ERROR_INITIALIZATION_FAILED,
     };
 
-    let swapchains = device_data.swapchains.lock().unwrap();
+    let swapchains = overhead::lock(&device_data.swapchains);
     if let Some(swapchain_info) = swapchains.get(&swapchain) {
         if p_swapchain_images.is_null() {
             // Query for count
@@ -879,47 +1558,74 @@ pub unsafe extern "C" fn vkAcquireNextImageKHR(
     device: vk::Device,
     swapchain: vk::SwapchainKHR,
     _timeout: u64,
-    _semaphore: vk::Semaphore,
-    _fence: vk::Fence,
+    semaphore: vk::Semaphore,
+    fence: vk::Fence,
     p_image_index: *mut u32,
 ) -> vk::Result {
-    log::debug!("Acquiring next image");
+    let _call = overhead::enter(EntryPoint::AcquireNextImage);
+    let _span = trace::span(Event::Acquire);
 
-    let layer_data_guard = LAYER_DATA.lock().unwrap();
+    let layer_data_guard = overhead::lock(&LAYER_DATA);
     let instance_data = match &*layer_data_guard {
         Some(data) => data,
         None => return vk::Result::ERROR_INITIALIZATION_FAILED,
     };
 
-    let devices = instance_data.devices.lock().unwrap();
+    let devices = overhead::lock(&instance_data.devices);
     let device_data = match devices.get(&device) {
         Some(data) => data,
         None => return vk::Result::ERROR_INITIALIZATION_FAILED,
     };
 
-    let swapchains = device_data.swapchains.lock().unwrap();
+    let swapchains = overhead::lock(&device_data.swapchains);
     let swapchain_info = match swapchains.get(&swapchain) {
         Some(info) => info,
         None => return vk::Result::ERROR_INITIALIZATION_FAILED,
     };
 
+    // The image is free as soon as it is handed out, so the semaphore and
+    // fence are signaled by an empty submission on the layer's queue
+    if semaphore != vk::Semaphore::null() || fence != vk::Fence::null() {
+        if let Some(queue) = device_data.graphics_queue {
+            let signal_semaphores = [semaphore];
+            let submit_info = vk::SubmitInfo {
+                signal_semaphore_count: (semaphore != vk::Semaphore::null()) as u32,
+                p_signal_semaphores: signal_semaphores.as_ptr(),
+                ..Default::default()
+            };
+            let result = (device_data.queue_submit)(queue, 1, &submit_info, fence);
+            if result != vk::Result::SUCCESS {
+                return result;
+            }
+        }
+    }
+
     // Cycle through available images
     let image_index =
         device_data.frame_counter.load(Ordering::Relaxed) % swapchain_info.image_count;
     *p_image_index = image_index;
+    hot_log::record(Msg::Acquire, &[image_index as u64]);
     vk::Result::SUCCESS
 }
 
 #[no_mangle]
 pub unsafe extern "C" fn vkQueuePresentKHR(
-    _queue: vk::Queue,
+    queue: vk::Queue,
     p_present_info: *const vk::PresentInfoKHR,
 ) -> vk::Result {
+    let _call = overhead::enter(EntryPoint::QueuePresent);
+    let _span = trace::span(Event::Present);
+    let present_ns = monotonic_ns();
     let present_info = &*p_present_info;
-    log::info!("Presenting frames - capturing from host-visible memory");
+    let first_swapchain = match present_info.swapchain_count {
+        0 => 0,
+        _ => (*present_info.p_swapchains).as_raw(),
+    };
+    usdt!(present_entry, present_info.swapchain_count, first_swapchain);
+    hot_log::record(Msg::Present, &[present_info.swapchain_count as u64]);
 
     // Process frame capture
-    let layer_data_guard = LAYER_DATA.lock().unwrap();
+    let layer_data_guard = overhead::lock(&LAYER_DATA);
     let instance_data = match &*layer_data_guard {
         Some(data) => data,
         None => return vk::Result::SUCCESS,
@@ -935,154 +1641,430 @@ pub unsafe extern "C" fn vkQueuePresentKHR(
         present_info.swapchain_count as usize,
     );
 
-    let devices = instance_data.devices.lock().unwrap();
+    let regions = present_regions(present_info);
+
+    let devices = overhead::lock(&instance_data.devices);
+
+    // Consume the wait semaphores on the present queue. The capture runs on
+    // the layer's queue, so before the first capture reads an image the
+    // present queue is waited idle, which it is once the semaphores signal.
+    let mut present_queue_idle = true;
+    if present_info.wait_semaphore_count > 0 {
+        let owner = swapchains.first().and_then(|swapchain| {
+            devices
+                .values()
+                .find(|device_data| overhead::lock(&device_data.swapchains).contains_key(swapchain))
+        });
+        if let Some(device_data) = owner {
+            let wait_stages = vec![
+                vk::PipelineStageFlags::ALL_COMMANDS;
+                present_info.wait_semaphore_count as usize
+            ];
+            let submit_info = vk::SubmitInfo {
+                wait_semaphore_count: present_info.wait_semaphore_count,
+                p_wait_semaphores: present_info.p_wait_semaphores,
+                p_wait_dst_stage_mask: wait_stages.as_ptr(),
+                ..Default::default()
+            };
+            let result = (device_data.queue_submit)(queue, 1, &submit_info, vk::Fence::null());
+            if result != vk::Result::SUCCESS {
+                return result;
+            }
+            present_queue_idle = false;
+        }
+    }
+
     for (i, &swapchain) in swapchains.iter().enumerate() {
         let image_index = image_indices[i];
+        let rectangles = regions.and_then(|regions| regions.get(i)).map(|region| {
+            if region.p_rectangles.is_null() {
+                &[][..]
+            } else {
+                slice::from_raw_parts(region.p_rectangles, region.rectangle_count as usize)
+            }
+        });
 
         // Find which device owns this swapchain
         for device_data in devices.values() {
-            let swapchain_map = device_data.swapchains.lock().unwrap();
+            let swapchain_map = overhead::lock(&device_data.swapchains);
             if let Some(swapchain_info) = swapchain_map.get(&swapchain) {
                 let frame_num = device_data.frame_counter.fetch_add(1, Ordering::Relaxed);
+                if let Some(metrics) = &instance_data.metrics {
+                    metrics.frame_presented();
+                }
 
-                // Check capture frequency and max frames
-                if instance_data.config.capture_frequency > 1
-                    && frame_num % instance_data.config.capture_frequency != 0
+                // Damage accumulates over every present, captured or not
+                swapchain_info.add_damage(rectangles);
+
+                // Frames outside the selection never reach the readback path
+                if !instance_data.config.frame_selector.matches(frame_num)
+                    || !swapchain_info.claim_capture_slot(instance_data.config.capture_interval_ns)
                 {
-                    continue;
+                    frame_dropped(instance_data, frame_num, swapchain, DropReason::NotSelected);
+                    break;
                 }
-                if instance_data.config.max_frames > 0
-                    && frame_num >= instance_data.config.max_frames
-                {
-                    continue;
+
+                if !present_queue_idle {
+                    let result = (device_data.queue_wait_idle)(queue);
+                    if result != vk::Result::SUCCESS {
+                        return result;
+                    }
+                    present_queue_idle = true;
                 }
 
                 // Capture frame from host-visible memory
-                capture_host_visible_frame(
+                let capture_start = monotonic_ns();
+                if let Some(latency) = &swapchain_info.latency {
+                    latency.record(Stage::Queue, capture_start.saturating_sub(present_ns));
+                }
+                let capture_span = trace::span(Event::Capture);
+                usdt!(
+                    capture_begin,
+                    frame_num,
+                    swapchain.as_raw(),
+                    swapchain_info
+                        .images
+                        .get(image_index as usize)
+                        .map_or(0, |i| i.size)
+                );
+                let written = capture_host_visible_frame(
+                    instance_data,
                     device_data,
-                    &swapchain_info,
+                    swapchain,
+                    swapchain_info,
                     image_index as usize,
                     frame_num,
-                    &instance_data.config,
+                    present_ns,
                 );
+                drop(capture_span);
+                usdt!(capture_end, frame_num, swapchain.as_raw(), written);
+                swapchain_info.record_latency(Stage::Total, capture_start);
+
+                if let (Some(latency_log), Some(latency)) =
+                    (&instance_data.latency_log, &swapchain_info.latency)
+                {
+                    latency_log.report_if_due(swapchain.as_raw(), latency, monotonic_ns());
+                }
                 break;
             }
         }
     }
 
+    let metrics = match &instance_data.metrics {
+        Some(metrics) if metrics.is_due(monotonic_ns()) => Some(sample_metrics(metrics, &devices)),
+        _ => None,
+    };
+    // The file is written without the layer's locks, so other presenting
+    // threads don't wait on the disk
+    drop(devices);
+    drop(layer_data_guard);
+    if let Some(metrics) = metrics {
+        metrics.write();
+    }
+
+    usdt!(
+        present_return,
+        present_info.swapchain_count,
+        first_swapchain,
+        vk::Result::SUCCESS.as_raw()
+    );
     vk::Result::SUCCESS
 }
 
-// Create host-visible images with linear layout for direct CPU access
-fn create_host_visible_images(
-    device: &ash::Device,
-    physical_device: vk::PhysicalDevice,
-    extent: vk::Extent2D,
-    format: vk::Format,
-    image_count: u32,
-) -> Result<Vec<HostVisibleImage>, vk::Result> {
-    let mut images = Vec::with_capacity(image_count as usize);
-
-    // Get memory properties from REAL physical device
-    let layer_data_guard = LAYER_DATA.lock().unwrap();
-    let instance_data = layer_data_guard.as_ref().unwrap();
-    let ash_instance = unsafe {
-        ash::Instance::load(
-            &ash::Entry::load().unwrap().static_fn(),
-            instance_data.instance,
-        )
+// Samples the gauges from every live swapchain and renders the metrics file
+fn sample_metrics(
+    metrics: &MetricsFile,
+    devices: &HashMap<vk::Device, DeviceData>,
+) -> MetricsSnapshot {
+    let swapchain_maps: Vec<_> = devices
+        .values()
+        .map(|device_data| overhead::lock(&device_data.swapchains))
+        .collect();
+
+    let mut gauges = Gauges {
+        capture_memory_bytes: devices
+            .values()
+            .map(|device_data| device_data.image_memory.block_bytes())
+            .sum(),
+        pooled_image_bytes: devices
+            .values()
+            .map(|device_data| overhead::lock(&device_data.retired_images).bytes())
+            .sum(),
+        swapchains: 0,
+        latencies: Vec::new(),
     };
-    let mem_properties =
-        unsafe { ash_instance.get_physical_device_memory_properties(physical_device) };
+    for (&swapchain, swapchain_info) in swapchain_maps.iter().flat_map(|map| map.iter()) {
+        gauges.swapchains += 1;
+        if let Some(latency) = &swapchain_info.latency {
+            gauges.latencies.push((swapchain.as_raw(), latency));
+        }
+    }
+    metrics.snapshot(&gauges)
+}
 
-    for i in 0..image_count {
-        let image_info = vk::ImageCreateInfo::builder()
-            .image_type(vk::ImageType::TYPE_2D)
-            .format(format)
-            .extent(vk::Extent3D {
-                width: extent.width,
-                height: extent.height,
-                depth: 1,
-            })
-            .mip_levels(1)
-            .array_layers(1)
-            .samples(vk::SampleCountFlags::TYPE_1)
-            .tiling(vk::ImageTiling::LINEAR) // Linear for CPU access
-            .usage(vk::ImageUsageFlags::COLOR_ATTACHMENT | vk::ImageUsageFlags::TRANSFER_SRC)
-            .sharing_mode(vk::SharingMode::EXCLUSIVE)
-            .initial_layout(vk::ImageLayout::UNDEFINED);
-
-        // Create REAL image
-        let image = unsafe { device.create_image(&image_info, None)? };
-        let memory_requirements = unsafe { device.get_image_memory_requirements(image) };
-
-        // Find host-visible memory type from REAL device
-        let mut memory_type_index = None;
-        for i in 0..mem_properties.memory_type_count {
-            if (memory_requirements.memory_type_bits & (1 << i)) != 0
-                && mem_properties.memory_types[i as usize]
-                    .property_flags
-                    .contains(
-                        vk::MemoryPropertyFlags::HOST_VISIBLE
-                            | vk::MemoryPropertyFlags::HOST_COHERENT,
-                    )
-            {
-                memory_type_index = Some(i);
-                break;
+// Reports a presented frame that produced no image
+fn frame_dropped(
+    instance_data: &InstanceData,
+    frame_num: u32,
+    swapchain: vk::SwapchainKHR,
+    reason: DropReason,
+) {
+    usdt!(frame_drop, frame_num, swapchain.as_raw(), reason);
+    if let Some(metrics) = &instance_data.metrics {
+        metrics.frame_dropped(reason);
+    }
+}
+
+// Reports a presented frame recorded without writing an image
+fn frame_checked(instance_data: &InstanceData, outcome: CheckOutcome) {
+    if let Some(metrics) = &instance_data.metrics {
+        metrics.frame_checked(outcome);
+    }
+}
+
+// VkPresentRegionsKHR from the present's pNext chain, one entry per swapchain
+unsafe fn present_regions<'a>(
+    present_info: &'a vk::PresentInfoKHR,
+) -> Option<&'a [vk::PresentRegionKHR]> {
+    let mut p_next = present_info.p_next as *const vk::BaseInStructure;
+    while !p_next.is_null() {
+        if (*p_next).s_type == vk::StructureType::PRESENT_REGIONS_KHR {
+            let regions = &*(p_next as *const vk::PresentRegionsKHR);
+            if regions.p_regions.is_null() {
+                return None;
             }
+            return Some(slice::from_raw_parts(
+                regions.p_regions,
+                regions.swapchain_count as usize,
+            ));
         }
+        p_next = (*p_next).p_next;
+    }
+    None
+}
+
+// Extensions to enable on the next layer: the app's list without the ones
+// the layer implements and the driver doesn't support
+// Adds a queue for the layer to the first graphics family in
+// `queue_create_infos`, if the family has more queues than the app asks for.
+// The priorities of that family move to `priorities`, which must outlive the
+// create infos. Returns the index of the added queue.
+unsafe fn add_layer_queue(
+    ash_instance: &ash::Instance,
+    physical_device: vk::PhysicalDevice,
+    queue_create_infos: &mut [vk::DeviceQueueCreateInfo],
+    priorities: &mut Vec<f32>,
+) -> Option<u32> {
+    let families = ash_instance.get_physical_device_queue_family_properties(physical_device);
+    let info = queue_create_infos.iter_mut().find(|info| {
+        families
+            .get(info.queue_family_index as usize)
+            .is_some_and(|family| family.queue_flags.contains(vk::QueueFlags::GRAPHICS))
+    })?;
+    let family = &families[info.queue_family_index as usize];
+    if !info.flags.is_empty() || info.queue_count >= family.queue_count {
+        return None;
+    }
 
-        let memory_type_index = memory_type_index.ok_or(vk::Result::ERROR_OUT_OF_HOST_MEMORY)?;
+    priorities.extend_from_slice(slice::from_raw_parts(
+        info.p_queue_priorities,
+        info.queue_count as usize,
+    ));
+    // Captures block the present, so they should not wait behind the app
+    priorities.push(1.0);
+    info.p_queue_priorities = priorities.as_ptr();
+    let index = info.queue_count;
+    info.queue_count += 1;
+    Some(index)
+}
 
-        // Allocate REAL host-visible memory
-        let alloc_info = vk::MemoryAllocateInfo::builder()
-            .allocation_size(memory_requirements.size)
-            .memory_type_index(memory_type_index);
+unsafe fn next_device_extensions(
+    ash_instance: &ash::Instance,
+    physical_device: vk::PhysicalDevice,
+    create_info: &vk::DeviceCreateInfo,
+) -> Vec<*const c_char> {
+    let requested = if create_info.pp_enabled_extension_names.is_null() {
+        &[][..]
+    } else {
+        slice::from_raw_parts(
+            create_info.pp_enabled_extension_names,
+            create_info.enabled_extension_count as usize,
+        )
+    };
 
-        let memory = unsafe { device.allocate_memory(&alloc_info, None)? };
+    let driver_has_incremental_present = ash_instance
+        .enumerate_device_extension_properties(physical_device)
+        .map(|extensions| {
+            extensions.iter().any(|extension| {
+                CStr::from_ptr(extension.extension_name.as_ptr()).to_bytes()
+                    == INCREMENTAL_PRESENT_EXTENSION
+            })
+        })
+        .unwrap_or(false);
+
+    requested
+        .iter()
+        .copied()
+        .filter(|&name| {
+            driver_has_incremental_present
+                || CStr::from_ptr(name).to_bytes() != INCREMENTAL_PRESENT_EXTENSION
+        })
+        .collect()
+}
 
-        // Bind REAL image to REAL memory
-        unsafe { device.bind_image_memory(image, memory, 0)? };
+// Smallest rectangle containing all of `rects`
+fn bounding_rect(rects: &[DirtyRect]) -> DirtyRect {
+    let x = rects.iter().map(|r| r.x).min().unwrap_or(0);
+    let y = rects.iter().map(|r| r.y).min().unwrap_or(0);
+    let end_x = rects.iter().map(|r| r.x + r.width).max().unwrap_or(0);
+    let end_y = rects.iter().map(|r| r.y + r.height).max().unwrap_or(0);
+    DirtyRect {
+        x,
+        y,
+        width: end_x - x,
+        height: end_y - y,
+    }
+}
 
-        // Map the REAL memory for persistent access
-        let mapped_ptr = unsafe {
-            device.map_memory(
-                memory,
-                0,
-                memory_requirements.size,
-                vk::MemoryMapFlags::empty(),
-            )? as *mut u8
-        };
+// Create host-visible images with linear layout for direct CPU access, placed
+// in the device's capture memory blocks
+fn create_host_visible_images(
+    ash_instance: &ash::Instance,
+    device: &ash::Device,
+    device_data: &DeviceData,
+    extent: vk::Extent2D,
+    format: vk::Format,
+    image_count: u32,
+) -> Result<Vec<HostVisibleImage>, vk::Result> {
+    let image_info = vk::ImageCreateInfo::builder()
+        .image_type(vk::ImageType::TYPE_2D)
+        .format(format)
+        .extent(vk::Extent3D {
+            width: extent.width,
+            height: extent.height,
+            depth: 1,
+        })
+        .mip_levels(1)
+        .array_layers(1)
+        .samples(vk::SampleCountFlags::TYPE_1)
+        .tiling(vk::ImageTiling::LINEAR) // Linear for CPU access
+        .usage(CAPTURE_IMAGE_USAGE)
+        .sharing_mode(vk::SharingMode::EXCLUSIVE)
+        .initial_layout(vk::ImageLayout::UNDEFINED);
+
+    // Create every image first, so one block can be sized for all of them
+    let mut pending = Vec::with_capacity(image_count as usize);
+    let destroy_images = |images: &[(vk::Image, vk::MemoryRequirements)]| {
+        for &(image, _) in images {
+            unsafe { device.destroy_image(image, None) };
+        }
+    };
+    for _ in 0..image_count {
+        match unsafe { device.create_image(&image_info, None) } {
+            Ok(image) => {
+                let requirements = unsafe { device.get_image_memory_requirements(image) };
+                pending.push((image, requirements));
+            }
+            Err(e) => {
+                destroy_images(&pending);
+                return Err(e);
+            }
+        }
+    }
 
-        // Get REAL subresource layout for row pitch
-        let subresource = vk::ImageSubresource {
-            aspect_mask: vk::ImageAspectFlags::COLOR,
-            mip_level: 0,
-            array_layer: 0,
+    let type_bits = pending.iter().fold(!0, |bits, (_, requirements)| {
+        bits & requirements.memory_type_bits
+    });
+    let memory_type_index =
+        match find_host_visible_memory_type(ash_instance, device_data.physical_device, type_bits) {
+            Some(index) => index,
+            None => {
+                destroy_images(&pending);
+                return Err(vk::Result::ERROR_OUT_OF_HOST_MEMORY);
+            }
         };
-        let layout = unsafe { device.get_image_subresource_layout(image, subresource) };
 
-        images.push(HostVisibleImage {
+    let mut reserve: u64 = pending
+        .iter()
+        .map(|(_, requirements)| requirements.size + requirements.alignment)
+        .sum();
+    let mut images = Vec::with_capacity(pending.len());
+    for (i, &(image, requirements)) in pending.iter().enumerate() {
+        match place_host_visible_image(
+            device,
+            &device_data.image_memory,
             image,
-            memory,
-            mapped_ptr,
-            size: memory_requirements.size,
-            row_pitch: layout.row_pitch as u32,
-        });
+            &requirements,
+            memory_type_index,
+            reserve,
+        ) {
+            Ok(host_image) => images.push(host_image),
+            Err(e) => {
+                cleanup_host_visible_images(device, &device_data.image_memory, &images);
+                destroy_images(&pending[i..]);
+                return Err(e);
+            }
+        }
+        reserve -= requirements.size + requirements.alignment;
 
         log::debug!(
-            "Created REAL host-visible image {}: {:?} ({}x{}, row_pitch: {})",
+            "Created host-visible image {}: {:?} ({}x{}, row_pitch: {}, offset: {})",
             i,
             image,
             extent.width,
             extent.height,
-            layout.row_pitch
+            images[i].row_pitch,
+            images[i].offset
         );
     }
 
     Ok(images)
 }
 
+// Binds `image` to a range of the capture memory blocks
+fn place_host_visible_image(
+    device: &ash::Device,
+    image_memory: &ImageMemory,
+    image: vk::Image,
+    requirements: &vk::MemoryRequirements,
+    memory_type_index: u32,
+    reserve: u64,
+) -> Result<HostVisibleImage, vk::Result> {
+    let allocation =
+        unsafe { image_memory.allocate(device, requirements, memory_type_index, reserve)? };
+    if let Err(e) = unsafe { device.bind_image_memory(image, allocation.memory, allocation.offset) }
+    {
+        unsafe {
+            image_memory.free(
+                device,
+                allocation.memory,
+                allocation.offset,
+                requirements.size,
+            )
+        };
+        return Err(e);
+    }
+
+    // Get REAL subresource layout for row pitch
+    let subresource = vk::ImageSubresource {
+        aspect_mask: vk::ImageAspectFlags::COLOR,
+        mip_level: 0,
+        array_layer: 0,
+    };
+    let layout = unsafe { device.get_image_subresource_layout(image, subresource) };
+
+    Ok(HostVisibleImage {
+        image,
+        memory: allocation.memory,
+        offset: allocation.offset,
+        memory_type_index,
+        // The subresource may start past the bound offset
+        mapped_ptr: unsafe { allocation.mapped_ptr.add(layout.offset as usize) },
+        size: requirements.size,
+        row_pitch: layout.row_pitch as u32,
+    })
+}
+
 fn find_host_visible_memory_type(
     ash_instance: &ash::Instance,
     physical_device: vk::PhysicalDevice,
@@ -1106,23 +2088,62 @@ fn find_host_visible_memory_type(
     None
 }
 
-fn cleanup_host_visible_images(images: &[HostVisibleImage]) {
-    // For real cleanup, we would need device access to destroy images and free memory
-    // This is called during device destruction, so the device cleanup handles it
+// Parks the images in the device's pool, destroying any it evicts
+fn retire_host_visible_images(
+    device: &ash::Device,
+    device_data: &DeviceData,
+    key: ImageKey,
+    images: Vec<HostVisibleImage>,
+) {
+    if images.is_empty() {
+        return;
+    }
+    let evicted = overhead::lock(&device_data.retired_images).put(key, images);
+    cleanup_host_visible_images(device, &device_data.image_memory, &evicted);
+}
+
+// Destroys every pooled image, returning how many there were
+fn trim_image_pool(device: &ash::Device, device_data: &DeviceData) -> usize {
+    let pooled = overhead::lock(&device_data.retired_images).drain();
+    if !pooled.is_empty() {
+        log::info!(
+            "Out of capture memory, released {} pooled swapchain images",
+            pooled.len()
+        );
+        cleanup_host_visible_images(device, &device_data.image_memory, &pooled);
+    }
+    pooled.len()
+}
+
+// Destroys the images and returns their ranges to the capture memory blocks
+fn cleanup_host_visible_images(
+    device: &ash::Device,
+    image_memory: &ImageMemory,
+    images: &[HostVisibleImage],
+) {
+    for image in images {
+        unsafe {
+            device.destroy_image(image.image, None);
+            image_memory.free(device, image.memory, image.offset, image.size);
+        }
+    }
     log::debug!("Cleaned up {} host-visible images", images.len());
 }
 
+// Also records the tile hash dispatch when `tile_hashes` is given. Returns the
+// GPU time of the submission if the device has a timestamp query pool.
 fn ensure_host_visibility_barrier(
+    instance_data: &InstanceData,
     device_data: &DeviceData,
     _host_image: &HostVisibleImage,
-) -> Result<(), vk::Result> {
+    tile_hashes: Option<(&TileHashTargets, usize)>,
+) -> Result<Option<CaptureGpuTime>, vk::Result> {
+    let _span = trace::span(Event::Barrier);
     // Execute REAL memory barrier if we have command pool and queue
     if let (Some(command_pool), Some(queue)) =
         (device_data.command_pool, device_data.graphics_queue)
     {
         unsafe {
-            let layer_data_guard = LAYER_DATA.lock().unwrap();
-            let instance_data = layer_data_guard.as_ref().unwrap();
             let ash_instance = ash::Instance::load(
                 &ash::Entry::load().unwrap().static_fn(),
                 instance_data.instance,
@@ -1142,22 +2163,51 @@ fn ensure_host_visibility_barrier(
             let begin_info = vk::CommandBufferBeginInfo::builder()
                 .flags(vk::CommandBufferUsageFlags::ONE_TIME_SUBMIT);
             ash_device.begin_command_buffer(cmd_buffer, &begin_info)?;
+            if let Some(gpu_timer) = &device_data.gpu_timer {
+                gpu_timer.begin(&ash_device, cmd_buffer);
+            }
+
+            let tile_hash = match (&device_data.tile_hash, tile_hashes) {
+                (Some(pipeline), Some((targets, image_index))) => {
+                    Some((pipeline, targets, image_index))
+                }
+                _ => None,
+            };
 
             // Issue REAL memory barrier to make GPU writes visible to host
+            // (and to the hash pass, which reads the image as a buffer)
+            let (dst_stage, dst_access) = match tile_hash {
+                Some(_) => (
+                    vk::PipelineStageFlags::HOST | vk::PipelineStageFlags::COMPUTE_SHADER,
+                    vk::AccessFlags::HOST_READ | vk::AccessFlags::SHADER_READ,
+                ),
+                None => (vk::PipelineStageFlags::HOST, vk::AccessFlags::HOST_READ),
+            };
             let barrier = vk::MemoryBarrier::builder()
                 .src_access_mask(vk::AccessFlags::COLOR_ATTACHMENT_WRITE)
-                .dst_access_mask(vk::AccessFlags::HOST_READ);
+                .dst_access_mask(dst_access);
 
             ash_device.cmd_pipeline_barrier(
                 cmd_buffer,
                 vk::PipelineStageFlags::COLOR_ATTACHMENT_OUTPUT,
-                vk::PipelineStageFlags::HOST,
+                dst_stage,
                 vk::DependencyFlags::empty(),
                 &[*barrier],
                 &[],
                 &[],
             );
 
+            if let Some(gpu_timer) = &device_data.gpu_timer {
+                gpu_timer.mark(&ash_device, cmd_buffer, 1);
+            }
+
+            if let Some((pipeline, targets, image_index)) = tile_hash {
+                targets.record(&ash_device, pipeline, cmd_buffer, image_index);
+                if let Some(gpu_timer) = &device_data.gpu_timer {
+                    gpu_timer.mark(&ash_device, cmd_buffer, 2);
+                }
+            }
+
             // End REAL command buffer
             ash_device.end_command_buffer(cmd_buffer)?;
 
@@ -1165,93 +2215,298 @@ fn ensure_host_visibility_barrier(
             let cmd_buffers = [cmd_buffer];
             let submit_info = vk::SubmitInfo::builder().command_buffers(&cmd_buffers);
 
-            ash_device.queue_submit(queue, &[*submit_info], vk::Fence::null())?;
-            ash_device.queue_wait_idle(queue)?;
+            {
+                let _span = trace::span(Event::Submit);
+                ash_device.queue_submit(queue, &[*submit_info], vk::Fence::null())?;
+            }
+            {
+                let _span = trace::span(Event::FenceWait);
+                ash_device.queue_wait_idle(queue)?;
+            }
 
             // Free the command buffer
             ash_device.free_command_buffers(command_pool, &[cmd_buffer]);
 
-            log::debug!("REAL memory barrier completed - GPU writes now visible to host");
+            hot_log::record(Msg::BarrierDone, &[]);
+
+            // The queue is idle, so the timestamps are already available
+            if let Some(gpu_timer) = &device_data.gpu_timer {
+                let gpu_time = gpu_timer.read(&ash_device, tile_hash.is_some())?;
+                hot_log::record(
+                    Msg::GpuTime,
+                    &[gpu_time.barrier_ns, gpu_time.hash_ns.unwrap_or(0)],
+                );
+                return Ok(Some(gpu_time));
+            }
         }
     } else {
         log::warn!("No command pool/queue available - cannot execute memory barrier");
     }
 
-    Ok(())
+    Ok(None)
 }
 
 fn capture_host_visible_frame(
+    instance_data: &InstanceData,
     device_data: &DeviceData,
+    swapchain: vk::SwapchainKHR,
     swapchain_info: &SwapchainInfo,
     image_index: usize,
     frame_num: u32,
-    config: &LayerConfig,
-) {
+    // Monotonic time the frame was presented at
+    present_ns: u64,
+) -> usize {
+    let config = &instance_data.config;
+
     if image_index >= swapchain_info.images.len() {
         log::error!(
             "Invalid image index {} for swapchain with {} images",
             image_index,
             swapchain_info.images.len()
         );
-        return;
+        frame_dropped(instance_data, frame_num, swapchain, DropReason::Error);
+        return 0;
     }
 
     let host_image = &swapchain_info.images[image_index];
 
-    log::info!(
-        "Capturing frame {} from host-visible memory ({}x{}, format: {:?})",
-        frame_num,
-        swapchain_info.extent.width,
-        swapchain_info.extent.height,
-        swapchain_info.format
+    hot_log::record(
+        Msg::Capture,
+        &[
+            frame_num as u64,
+            swapchain_info.extent.width as u64,
+            swapchain_info.extent.height as u64,
+            swapchain_info.format.as_raw() as u64,
+        ],
     );
 
     // Ensure GPU writes are visible to host before reading
-    if let Err(e) = ensure_host_visibility_barrier(device_data, host_image) {
-        log::error!("Failed to ensure host visibility: {:?}", e);
-        return;
+    let tile_hashes = swapchain_info
+        .tile_hashes
+        .as_ref()
+        .map(|targets| (targets, image_index));
+    let barrier_start = monotonic_ns();
+    let barrier =
+        ensure_host_visibility_barrier(instance_data, device_data, host_image, tile_hashes);
+    swapchain_info.record_latency(Stage::Barrier, barrier_start);
+    match barrier {
+        Ok(Some(gpu_time)) => {
+            if let Some(latency) = &swapchain_info.latency {
+                latency.record(Stage::GpuBarrier, gpu_time.barrier_ns);
+                if let Some(hash_ns) = gpu_time.hash_ns {
+                    latency.record(Stage::GpuHash, hash_ns);
+                }
+            }
+        }
+        Ok(None) => {}
+        Err(e) => {
+            log::error!("Failed to ensure host visibility: {:?}", e);
+            frame_dropped(instance_data, frame_num, swapchain, DropReason::Error);
+            return 0;
+        }
+    }
+
+    // Frames the GPU found unchanged are skipped without reading the image,
+    // unless they are verified against a hash reference or golden images
+    let change = swapchain_info.tile_hashes.as_ref().map(|tile_hashes| {
+        let _span = trace::span(Event::Compare);
+        tile_hashes.compare()
+    });
+    let verified = instance_data
+        .hash_log
+        .as_ref()
+        .is_some_and(|hash_log| hash_log.has_reference())
+        || instance_data.golden.is_some();
+    if matches!(&change, Some(change) if change.skips_host(verified)) {
+        hot_log::record(Msg::Unchanged, &[frame_num as u64]);
+        // Its statistics are those of the previous frame, repeated so frozen
+        // output still shows up in the sink
+        if let Some(stats_log) = &instance_data.stats_log {
+            if let Some(stats) = swapchain_info.last_stats.lock().unwrap().as_ref() {
+                let extent = swapchain_info.extent;
+                stats_log.record(
+                    swapchain.as_raw(),
+                    frame_num,
+                    extent.width,
+                    extent.height,
+                    stats,
+                );
+            }
+        }
+        swapchain_info.note_repeat();
+        frame_dropped(instance_data, frame_num, swapchain, DropReason::Unchanged);
+        return 0;
     }
 
-    // Read pixel data directly from mapped memory
-    let rgb_data =
-        convert_host_image_to_rgb(host_image, swapchain_info.extent, swapchain_info.format);
+    // Partial updates come from the GPU tile hashes or, failing that, from
+    // the damage the app reported with its presents. The retained frame must
+    // track every such frame, whether or not this one ends up written.
+    let damage = swapchain_info.take_damage();
+    let partial = match change {
+        Some(change) if config.dirty_rects => Some(change),
+        _ => damage,
+    };
+    let mut retained_frame = partial
+        .as_ref()
+        .map(|_| swapchain_info.retained_frame.lock().unwrap());
+    if let (Some(frame), Some(change)) = (retained_frame.as_deref_mut(), &partial) {
+        let extent = swapchain_info.extent;
+        let format = swapchain_info.format;
+        let convert_start = monotonic_ns();
+        let convert_span = trace::span(Event::Convert);
+        match change {
+            // Verified frames the GPU found unchanged still match it
+            FrameChange::Unchanged if !frame.is_empty() => {}
+            FrameChange::Dirty(rects) if !frame.is_empty() => {
+                hot_log::record(Msg::DirtyRects, &[frame_num as u64, rects.len() as u64]);
+                log::trace!("Frame {} dirty rectangles: {:?}", frame_num, rects);
+                update_rgb_regions(host_image, extent, format, rects, frame);
+            }
+            _ => *frame = convert_host_image_to_rgb(host_image, extent, format).unwrap_or_default(),
+        }
+        drop(convert_span);
+        swapchain_info.record_latency(Stage::Convert, convert_start);
+    }
+
+    // Statistics cover every captured frame, duplicates included, so frozen
+    // output shows up as a run of identical rows
+    if let Some(stats_log) = &instance_data.stats_log {
+        let extent = swapchain_info.extent;
+        if let Some(stats) = host_image_stats(host_image, extent, swapchain_info.format) {
+            stats_log.record(
+                swapchain.as_raw(),
+                frame_num,
+                extent.width,
+                extent.height,
+                &stats,
+            );
+            *swapchain_info.last_stats.lock().unwrap() = Some(stats);
+        }
+    }
+
+    // Hash-only mode fails closed: without its log, nothing is written
+    if config.hash_mode == HashMode::Only && instance_data.hash_log.is_none() {
+        frame_dropped(instance_data, frame_num, swapchain, DropReason::Error);
+        return 0;
+    }
+
+    // Hash the raw payload straight from mapped memory, before any conversion
+    let mut hash_mismatch = false;
+    let hash = match &instance_data.hash_log {
+        Some(_) => hash_host_image(host_image, swapchain_info.extent, swapchain_info.format),
+        None => None,
+    };
+    if let (Some(hash_log), Some(hash)) = (&instance_data.hash_log, hash) {
+        // Checked before duplicate suppression, so output that froze still
+        // fails against the reference. Mismatches are never suppressed.
+        let verdict = hash_log.check(frame_num, hash);
+        if verdict == HashVerdict::Mismatch {
+            log::warn!("Frame {} does not match the reference hash", frame_num);
+            hash_mismatch = true;
+        } else if config.skip_duplicates && swapchain_info.is_repeat(frame_num, hash, hash_log) {
+            hot_log::record(Msg::Repeat, &[frame_num as u64]);
+            frame_dropped(instance_data, frame_num, swapchain, DropReason::Duplicate);
+            return 0;
+        }
+
+        hash_log.write(frame_num, hash, verdict);
+        if !hash_mismatch && config.hash_mode == HashMode::Only {
+            frame_checked(instance_data, CheckOutcome::HashOnly);
+            return 0;
+        }
+    }
+
+    // The statistics sink replaces image output, except where another mode
+    // asks for the pixels
+    if instance_data.stats_log.is_some() && instance_data.golden.is_none() && !hash_mismatch {
+        frame_checked(instance_data, CheckOutcome::StatsOnly);
+        return 0;
+    }
+
+    // Read pixel data directly from mapped memory, unless the retained frame
+    // already holds it
+    let rgb_data = match retained_frame.as_deref() {
+        Some(frame) if !frame.is_empty() => Some(Cow::Borrowed(frame.as_slice())),
+        _ => {
+            let convert_start = monotonic_ns();
+            let convert_span = trace::span(Event::Convert);
+            let converted =
+                convert_host_image_to_rgb(host_image, swapchain_info.extent, swapchain_info.format);
+            drop(convert_span);
+            swapchain_info.record_latency(Stage::Convert, convert_start);
+            converted.map(Cow::Owned)
+        }
+    };
 
     match rgb_data {
         Some(pixels) => {
-            let extension = match config.output_format {
-                OutputFormat::Ppm => "ppm",
-                OutputFormat::Png => "png",
-            };
-
-            let filename = format!("{}/frame_{:06}.{}", config.output_dir, frame_num, extension);
+            if let Some(golden) = &instance_data.golden {
+                let extent = swapchain_info.extent;
+                match golden.check(frame_num, &pixels, extent.width, extent.height) {
+                    GoldenVerdict::Pass(_) => {
+                        frame_checked(instance_data, CheckOutcome::GoldenPass);
+                        return 0;
+                    }
+                    GoldenVerdict::Missing => {
+                        frame_checked(instance_data, CheckOutcome::GoldenMissing);
+                        return 0;
+                    }
+                    GoldenVerdict::Fail(comparison) => {
+                        log::warn!(
+                            "Frame {} differs from golden image (PSNR {:.2} dB, SSIM {:.4})",
+                            frame_num,
+                            comparison.psnr,
+                            comparison.ssim
+                        );
+                        if let Some(diff) = golden.diff_image(frame_num, &pixels) {
+                            let diff_filename =
+                                format!("{}/frame_{:06}_diff.ppm", config.output_dir, frame_num);
+                            if let Err(e) =
+                                save_ppm_frame(&diff_filename, &diff, extent.width, extent.height)
+                            {
+                                log::error!("Failed to write diff image {}: {}", diff_filename, e);
+                            }
+                        }
+                    }
+                    GoldenVerdict::SizeMismatch => {
+                        log::warn!(
+                            "Frame {} has a different size than its golden image",
+                            frame_num
+                        );
+                    }
+                }
+            }
 
-            let result = match config.output_format {
-                OutputFormat::Ppm => save_ppm_frame(
-                    &filename,
-                    &pixels,
-                    swapchain_info.extent.width,
-                    swapchain_info.extent.height,
-                ),
-                OutputFormat::Png => save_png_frame(
-                    &filename,
-                    &pixels,
-                    swapchain_info.extent.width,
-                    swapchain_info.extent.height,
-                ),
-            };
+            let (filename, result) = write_rgb_frame(
+                config,
+                frame_num,
+                &pixels,
+                swapchain_info.extent,
+                |stage, start| swapchain_info.record_latency(stage, start),
+            );
 
             match result {
                 Ok(file_size) => {
-                    log::info!(
-                        "Successfully saved frame {} ({} bytes, {}x{} pixels)",
-                        frame_num,
-                        file_size,
-                        swapchain_info.extent.width,
-                        swapchain_info.extent.height
+                    swapchain_info.record_latency(Stage::Written, present_ns);
+                    hot_log::record(
+                        Msg::Saved,
+                        &[
+                            frame_num as u64,
+                            file_size as u64,
+                            swapchain_info.extent.width as u64,
+                            swapchain_info.extent.height as u64,
+                        ],
                     );
+                    usdt!(write_done, frame_num, swapchain.as_raw(), file_size);
+                    if let Some(metrics) = &instance_data.metrics {
+                        metrics.frame_captured(file_size);
+                    }
+                    file_size
                 }
                 Err(e) => {
                     log::error!("Failed to write frame {}: {}", filename, e);
+                    frame_dropped(instance_data, frame_num, swapchain, DropReason::Error);
+                    0
                 }
             }
         }
@@ -1260,10 +2515,106 @@ fn capture_host_visible_frame(
                 "Failed to convert host image to RGB for frame {}",
                 frame_num
             );
+            frame_dropped(instance_data, frame_num, swapchain, DropReason::Error);
+            0
         }
     }
 }
 
+// Encodes converted pixels and writes them to the output directory, handing
+// the start time of each stage to `record_latency`. Returns the file name
+// along with the bytes written.
+fn write_rgb_frame(
+    config: &LayerConfig,
+    frame_num: u32,
+    pixels: &[u8],
+    extent: vk::Extent2D,
+    record_latency: impl Fn(Stage, u64),
+) -> (String, Result<usize, std::io::Error>) {
+    let (width, height) = (extent.width, extent.height);
+    let encode_start = monotonic_ns();
+    let encode_span = trace::span(Event::Encode);
+    let (extension, file_data) = match config.output_format {
+        OutputFormat::Ppm => ("ppm", encode_ppm_frame(pixels, width, height)),
+        OutputFormat::Png => encode_png_frame(pixels, width, height),
+    };
+    drop(encode_span);
+    record_latency(Stage::Encode, encode_start);
+
+    let filename = format!("{}/frame_{:06}.{}", config.output_dir, frame_num, extension);
+
+    let write_start = monotonic_ns();
+    let write_span = trace::span(Event::Write);
+    let result = fs::write(&filename, &file_data).map(|_| file_data.len());
+    drop(write_span);
+    record_latency(Stage::Write, write_start);
+
+    (filename, result)
+}
+
+fn format_bytes_per_pixel(format: vk::Format) -> Option<u32> {
+    match format {
+        vk::Format::B8G8R8A8_SRGB
+        | vk::Format::B8G8R8A8_UNORM
+        | vk::Format::R8G8B8A8_SRGB
+        | vk::Format::R8G8B8A8_UNORM => Some(4),
+        vk::Format::R8G8B8_SRGB | vk::Format::R8G8B8_UNORM => Some(3),
+        _ => None,
+    }
+}
+
+// Pixel rows of a mapped image, without the row pitch padding
+fn host_image_rows(
+    host_image: &HostVisibleImage,
+    extent: vk::Extent2D,
+    format: vk::Format,
+) -> Option<impl Iterator<Item = &[u8]>> {
+    let row_bytes = (extent.width * format_bytes_per_pixel(format)?) as usize;
+    Some((0..extent.height).map(move |y| unsafe {
+        let row_offset = (y * host_image.row_pitch) as usize;
+        slice::from_raw_parts(host_image.mapped_ptr.add(row_offset), row_bytes)
+    }))
+}
+
+// Byte offsets of R, G and B within a pixel
+fn format_rgb_offsets(format: vk::Format) -> Option<[usize; 3]> {
+    match format {
+        vk::Format::B8G8R8A8_SRGB | vk::Format::B8G8R8A8_UNORM => Some([2, 1, 0]),
+        vk::Format::R8G8B8A8_SRGB
+        | vk::Format::R8G8B8A8_UNORM
+        | vk::Format::R8G8B8_SRGB
+        | vk::Format::R8G8B8_UNORM => Some([0, 1, 2]),
+        _ => None,
+    }
+}
+
+fn host_image_stats(
+    host_image: &HostVisibleImage,
+    extent: vk::Extent2D,
+    format: vk::Format,
+) -> Option<FrameStats> {
+    let mut stats = StatsAccumulator::new(
+        format_bytes_per_pixel(format)? as usize,
+        format_rgb_offsets(format)?,
+    );
+    for row in host_image_rows(host_image, extent, format)? {
+        stats.add_row(row);
+    }
+    Some(stats.finish())
+}
+
+fn hash_host_image(
+    host_image: &HostVisibleImage,
+    extent: vk::Extent2D,
+    format: vk::Format,
+) -> Option<u128> {
+    let mut hasher = FrameHasher::new();
+    for row in host_image_rows(host_image, extent, format)? {
+        hasher.update(row);
+    }
+    Some(hasher.finish())
+}
+
 fn convert_host_image_to_rgb(
     host_image: &HostVisibleImage,
     extent: vk::Extent2D,
@@ -1327,31 +2678,264 @@ fn convert_host_image_to_rgb(
     Some(rgb_data)
 }
 
+// Converts only the given regions of a mapped image into an RGB frame
+fn update_rgb_regions(
+    host_image: &HostVisibleImage,
+    extent: vk::Extent2D,
+    format: vk::Format,
+    rects: &[DirtyRect],
+    rgb_data: &mut [u8],
+) {
+    let (bytes_per_pixel, [r, g, b]) =
+        match (format_bytes_per_pixel(format), format_rgb_offsets(format)) {
+            (Some(bpp), Some(offsets)) => (bpp as usize, offsets),
+            _ => return,
+        };
+
+    for rect in rects {
+        for y in rect.y..rect.y + rect.height {
+            let src = unsafe {
+                slice::from_raw_parts(
+                    host_image.mapped_ptr.add(
+                        (y * host_image.row_pitch) as usize + rect.x as usize * bytes_per_pixel,
+                    ),
+                    rect.width as usize * bytes_per_pixel,
+                )
+            };
+            let dst_offset = ((y * extent.width + rect.x) * 3) as usize;
+            let dst = &mut rgb_data[dst_offset..dst_offset + rect.width as usize * 3];
+            for (pixel, rgb) in src
+                .chunks_exact(bytes_per_pixel)
+                .zip(dst.chunks_exact_mut(3))
+            {
+                rgb[0] = pixel[r];
+                rgb[1] = pixel[g];
+                rgb[2] = pixel[b];
+            }
+        }
+    }
+}
+
+fn encode_ppm_frame(pixels: &[u8], width: u32, height: u32) -> Vec<u8> {
+    let ppm_header = format!("P6\n{} {}\n255\n", width, height);
+    let mut file_data = Vec::with_capacity(ppm_header.len() + pixels.len());
+    file_data.extend_from_slice(ppm_header.as_bytes());
+    file_data.extend_from_slice(pixels);
+    file_data
+}
+
 fn save_ppm_frame(
     filename: &str,
     pixels: &[u8],
     width: u32,
     height: u32,
 ) -> Result<usize, std::io::Error> {
-    let ppm_header = format!("P6\n{} {}\n255\n", width, height);
-    let mut file_data = ppm_header.into_bytes();
-    file_data.extend_from_slice(pixels);
+    let file_data = encode_ppm_frame(pixels, width, height);
     let file_size = file_data.len();
     fs::write(filename, file_data)?;
     Ok(file_size)
 }
 
-fn save_png_frame(
-    filename: &str,
-    pixels: &[u8],
-    width: u32,
-    height: u32,
-) -> Result<usize, std::io::Error> {
+// Returns the file extension actually used along with the encoded data
+fn encode_png_frame(pixels: &[u8], width: u32, height: u32) -> (&'static str, Vec<u8>) {
     // For PNG support, we'd need to enable the PNG feature in the image crate
     // For now, fall back to PPM
     log::warn!("PNG output not yet implemented, falling back to PPM");
-    let ppm_filename = filename.replace(".png", ".ppm");
-    save_ppm_frame(&ppm_filename, pixels, width, height)
+    ("ppm", encode_ppm_frame(pixels, width, height))
+}
+
+// Capture kernels exposed to the benches in benches/; not a stable API
+#[cfg(feature = "bench")]
+#[doc(hidden)]
+pub mod bench_api {
+    use super::*;
+
+    pub use crate::latency::LatencyHistogram;
+    pub use crate::synthetic::{Scene, SyntheticSource, SCENES};
+
+    // A frame in host memory standing in for a mapped swapchain image
+    pub struct HostFrame {
+        // Backs `image.mapped_ptr`
+        data: Vec<u8>,
+        image: HostVisibleImage,
+        pub extent: vk::Extent2D,
+        pub format: vk::Format,
+    }
+
+    impl HostFrame {
+        // `row_padding` bytes follow each row, as in a driver-aligned row pitch.
+        // `None` for formats the capture path does not support.
+        pub fn new(extent: vk::Extent2D, format: vk::Format, row_padding: u32) -> Option<Self> {
+            let row_pitch = extent.width * format_bytes_per_pixel(format)? + row_padding;
+            let size = row_pitch as usize * extent.height as usize;
+            // Noisy content so hashing and encoding see no long runs
+            let mut data: Vec<u8> = (0..size as u32)
+                .map(|i| (i.wrapping_mul(2_654_435_761) >> 24) as u8)
+                .collect();
+            let image = HostVisibleImage {
+                image: vk::Image::null(),
+                memory: vk::DeviceMemory::null(),
+                offset: 0,
+                memory_type_index: 0,
+                mapped_ptr: data.as_mut_ptr(),
+                size: size as u64,
+                row_pitch,
+            };
+            Some(Self {
+                data,
+                image,
+                extent,
+                format,
+            })
+        }
+
+        // Bytes of pixel data the kernels read, without row padding
+        pub fn pixel_bytes(&self) -> u64 {
+            self.extent.width as u64
+                * self.extent.height as u64
+                * format_bytes_per_pixel(self.format).unwrap_or(0) as u64
+        }
+
+        // A generator of `scene` frames in this frame's size and format
+        pub fn synthetic_source(&self, scene: Scene) -> SyntheticSource {
+            SyntheticSource::new(
+                scene,
+                self.extent.width,
+                self.extent.height,
+                format_bytes_per_pixel(self.format).unwrap_or(4) as usize,
+                format_rgb_offsets(self.format).unwrap_or([0, 1, 2]),
+            )
+        }
+
+        pub fn draw(&mut self, source: &mut SyntheticSource, frame_num: u32) {
+            source.draw(frame_num, &mut self.data, self.image.row_pitch as usize);
+        }
+    }
+
+    // The host side of a capture, configured by the VK_CAPTURE_* variables
+    // like the layer: hashing, conversion, encoding and writing the file.
+    // Every stage is timed as it is in the layer's latency report.
+    pub struct Sink {
+        config: LayerConfig,
+        latencies: StageLatencies,
+        hash_log: Option<HashLog>,
+    }
+
+    impl Sink {
+        pub fn new(output_dir: &str) -> Self {
+            let config = LayerConfig {
+                output_dir: output_dir.to_string(),
+                ..LayerConfig::default()
+            };
+            // Hashes go to `frame_hashes.log` as in the layer
+            let hash_log = if config.hash_mode != HashMode::Off {
+                let path = format!("{}/frame_hashes.log", config.output_dir);
+                fs::create_dir_all(&config.output_dir)
+                    .and_then(|_| HashLog::create(&path, config.hash_reference.as_deref()))
+                    .map_err(|e| log::error!("Failed to open frame hash log {}: {}", path, e))
+                    .ok()
+            } else {
+                None
+            };
+            Self {
+                config,
+                latencies: StageLatencies::new(),
+                hash_log,
+            }
+        }
+
+        // Bytes written, 0 for hash-only captures. `present_ns` stands in
+        // for the vkQueuePresentKHR entry, on the clock of `now_ns`.
+        pub fn capture(
+            &self,
+            frame: &HostFrame,
+            frame_num: u32,
+            present_ns: u64,
+        ) -> Result<usize, std::io::Error> {
+            let record_latency = |stage, start: u64| {
+                self.latencies
+                    .record(stage, monotonic_ns().saturating_sub(start))
+            };
+            let total_start = monotonic_ns();
+            self.latencies
+                .record(Stage::Queue, total_start.saturating_sub(present_ns));
+            // Like the layer, a mismatch is written out in hash-only mode and
+            // hash-only mode without its log fails closed
+            if let Some(hash_log) = &self.hash_log {
+                let mismatch = hash(frame)
+                    .map(|hash| hash_log.record(frame_num, hash) == HashVerdict::Mismatch)
+                    .unwrap_or(false);
+                if !mismatch && self.config.hash_mode == HashMode::Only {
+                    record_latency(Stage::Total, total_start);
+                    return Ok(0);
+                }
+            } else if self.config.hash_mode == HashMode::Only {
+                return Err(std::io::Error::new(
+                    std::io::ErrorKind::Other,
+                    "hash-only capture without a hash log",
+                ));
+            }
+
+            let convert_start = monotonic_ns();
+            let pixels = convert(frame).unwrap_or_default();
+            record_latency(Stage::Convert, convert_start);
+
+            let (_, result) = write_rgb_frame(
+                &self.config,
+                frame_num,
+                &pixels,
+                frame.extent,
+                record_latency,
+            );
+            record_latency(Stage::Total, total_start);
+            if result.is_ok() {
+                record_latency(Stage::Written, present_ns);
+            }
+            result
+        }
+
+        // Stages that have samples, by name
+        pub fn latencies(&self) -> impl Iterator<Item = (&'static str, &LatencyHistogram)> {
+            self.latencies.histograms()
+        }
+    }
+
+    pub fn now_ns() -> u64 {
+        monotonic_ns()
+    }
+
+    pub fn convert(frame: &HostFrame) -> Option<Vec<u8>> {
+        convert_host_image_to_rgb(&frame.image, frame.extent, frame.format)
+    }
+
+    pub fn hash(frame: &HostFrame) -> Option<u128> {
+        hash_host_image(&frame.image, frame.extent, frame.format)
+    }
+
+    pub fn stats(frame: &HostFrame) -> bool {
+        host_image_stats(&frame.image, frame.extent, frame.format)
+            .map(std::hint::black_box)
+            .is_some()
+    }
+
+    pub fn encode_ppm(pixels: &[u8], width: u32, height: u32) -> Vec<u8> {
+        encode_ppm_frame(pixels, width, height)
+    }
+
+    pub fn save_ppm(
+        filename: &str,
+        pixels: &[u8],
+        width: u32,
+        height: u32,
+    ) -> Result<usize, std::io::Error> {
+        save_ppm_frame(filename, pixels, width, height)
+    }
+}
+
+// Nanoseconds on the monotonic clock since the layer was first used
+fn monotonic_ns() -> u64 {
+    static EPOCH: OnceLock<Instant> = OnceLock::new();
+    EPOCH.get_or_init(Instant::now).elapsed().as_nanos() as u64
 }
 
 // Helper function to generate unique handles
@@ -0,0 +1,316 @@
+// Prometheus textfile metrics
+//
+// Counters are plain atomics bumped on the present path. At a fixed interval
+// the whole set is rendered in the Prometheus text exposition format and,
+// once the present has released the layer's locks, written next to the
+// target and renamed over it, so a node exporter's textfile collector never
+// reads a partial file. Every sample carries a `pid` label so several
+// processes can share one collector directory under distinct names.
+//
+// Every presented frame is counted once more as captured, dropped or
+// checked, so presented = captured + dropped + checked.
+
+use std::{
+    fmt::Write as _,
+    fs,
+    sync::atomic::{AtomicU64, Ordering},
+};
+
+use crate::latency::StageLatencies;
+
+// Why a presented frame did not produce an image
+#[derive(Debug, Clone, Copy)]
+pub enum DropReason {
+    // Outside the frame selection or the capture rate limit
+    NotSelected = 1,
+    // GPU tile hashes match the previous capture
+    Unchanged = 2,
+    // Content hash matches the previous capture
+    Duplicate = 3,
+    // Barrier, conversion or write failed
+    Error = 4,
+}
+
+// How a presented frame was recorded without writing an image
+#[derive(Debug, Clone, Copy)]
+pub enum CheckOutcome {
+    // Only its content hash was logged
+    HashOnly = 1,
+    // Only its statistics row was written
+    StatsOnly = 2,
+    // Within tolerance of its golden image
+    GoldenPass = 3,
+    // No golden image to compare against
+    GoldenMissing = 4,
+}
+
+const CHECK_OUTCOMES: [CheckOutcome; 4] = [
+    CheckOutcome::HashOnly,
+    CheckOutcome::StatsOnly,
+    CheckOutcome::GoldenPass,
+    CheckOutcome::GoldenMissing,
+];
+
+impl CheckOutcome {
+    fn name(self) -> &'static str {
+        match self {
+            CheckOutcome::HashOnly => "hash_only",
+            CheckOutcome::StatsOnly => "stats_only",
+            CheckOutcome::GoldenPass => "golden_pass",
+            CheckOutcome::GoldenMissing => "golden_missing",
+        }
+    }
+}
+
+const DROP_REASONS: [DropReason; 4] = [
+    DropReason::NotSelected,
+    DropReason::Unchanged,
+    DropReason::Duplicate,
+    DropReason::Error,
+];
+
+impl DropReason {
+    fn name(self) -> &'static str {
+        match self {
+            DropReason::NotSelected => "not_selected",
+            DropReason::Unchanged => "unchanged",
+            DropReason::Duplicate => "duplicate",
+            DropReason::Error => "error",
+        }
+    }
+}
+
+const QUANTILES: [f64; 3] = [0.5, 0.9, 0.99];
+
+// Name, type and help text of one metric family
+type Family = (&'static str, &'static str, &'static str);
+
+const FRAMES_PRESENTED: Family = (
+    "frames_presented_total",
+    "counter",
+    "Frames presented through the layer.",
+);
+const FRAMES_CAPTURED: Family = (
+    "frames_captured_total",
+    "counter",
+    "Frames written to disk.",
+);
+const FRAMES_DROPPED: Family = (
+    "frames_dropped_total",
+    "counter",
+    "Presented frames that produced no image.",
+);
+const FRAMES_CHECKED: Family = (
+    "frames_checked_total",
+    "counter",
+    "Frames recorded as a hash, statistics row or golden comparison instead of an image.",
+);
+const BYTES_WRITTEN: Family = (
+    "bytes_written_total",
+    "counter",
+    "Bytes of frame files written.",
+);
+const CAPTURE_MEMORY_BYTES: Family = (
+    "capture_memory_bytes",
+    "gauge",
+    "Device memory allocated for capture.",
+);
+const POOLED_IMAGE_BYTES: Family = (
+    "pooled_image_bytes",
+    "gauge",
+    "Capture memory held by retired swapchain images kept for reuse.",
+);
+const SWAPCHAINS: Family = ("swapchains", "gauge", "Live swapchains.");
+const CAPTURE_LATENCY_SECONDS: Family = (
+    "capture_latency_seconds",
+    "summary",
+    "Capture stage latency per swapchain.",
+);
+
+pub struct MetricsFile {
+    path: String,
+    // Interval between writes; the file is also written at teardown
+    interval_ns: u64,
+    next_write_ns: AtomicU64,
+    frames_presented: AtomicU64,
+    frames_captured: AtomicU64,
+    frames_dropped: [AtomicU64; DROP_REASONS.len()],
+    frames_checked: [AtomicU64; CHECK_OUTCOMES.len()],
+    bytes_written: AtomicU64,
+}
+
+// Rendered metrics, written once the layer's locks are released
+pub struct MetricsSnapshot {
+    path: String,
+    text: String,
+}
+
+// Values sampled from the layer state at write time
+pub struct Gauges<'a> {
+    // Device memory allocated for capture: swapchain images and hash buffers
+    pub capture_memory_bytes: u64,
+    // Part of it held by the image pools
+    pub pooled_image_bytes: u64,
+    pub swapchains: u64,
+    pub latencies: Vec<(u64, &'a StageLatencies)>,
+}
+
+impl MetricsFile {
+    pub fn new(path: String, interval_ns: u64) -> Self {
+        Self {
+            path,
+            interval_ns,
+            next_write_ns: AtomicU64::new(0),
+            frames_presented: AtomicU64::new(0),
+            frames_captured: AtomicU64::new(0),
+            frames_dropped: Default::default(),
+            frames_checked: Default::default(),
+            bytes_written: AtomicU64::new(0),
+        }
+    }
+
+    pub fn frame_presented(&self) {
+        self.frames_presented.fetch_add(1, Ordering::Relaxed);
+    }
+
+    pub fn frame_captured(&self, bytes: usize) {
+        self.frames_captured.fetch_add(1, Ordering::Relaxed);
+        self.bytes_written
+            .fetch_add(bytes as u64, Ordering::Relaxed);
+    }
+
+    pub fn frame_dropped(&self, reason: DropReason) {
+        self.frames_dropped[reason as usize - 1].fetch_add(1, Ordering::Relaxed);
+    }
+
+    pub fn frame_checked(&self, outcome: CheckOutcome) {
+        self.frames_checked[outcome as usize - 1].fetch_add(1, Ordering::Relaxed);
+    }
+
+    // True once per interval; the first call only arms the timer
+    pub fn is_due(&self, now_ns: u64) -> bool {
+        let due = self.next_write_ns.load(Ordering::Relaxed);
+        if due != 0 && now_ns < due {
+            return false;
+        }
+        self.next_write_ns
+            .store(now_ns + self.interval_ns, Ordering::Relaxed);
+        due != 0
+    }
+
+    // Renders the counters and `gauges` without touching the file
+    pub fn snapshot(&self, gauges: &Gauges) -> MetricsSnapshot {
+        MetricsSnapshot {
+            path: self.path.clone(),
+            text: self.render(gauges),
+        }
+    }
+
+    fn render(&self, gauges: &Gauges) -> String {
+        let pid = std::process::id();
+        let counter = |value: &AtomicU64| value.load(Ordering::Relaxed);
+        let mut out = String::new();
+
+        single(
+            &mut out,
+            pid,
+            FRAMES_PRESENTED,
+            counter(&self.frames_presented),
+        );
+        single(
+            &mut out,
+            pid,
+            FRAMES_CAPTURED,
+            counter(&self.frames_captured),
+        );
+
+        header(&mut out, FRAMES_DROPPED);
+        for reason in DROP_REASONS {
+            let _ = writeln!(
+                out,
+                "unseen_frames_dropped_total{{pid=\"{}\",reason=\"{}\"}} {}",
+                pid,
+                reason.name(),
+                counter(&self.frames_dropped[reason as usize - 1])
+            );
+        }
+
+        header(&mut out, FRAMES_CHECKED);
+        for outcome in CHECK_OUTCOMES {
+            let _ = writeln!(
+                out,
+                "unseen_frames_checked_total{{pid=\"{}\",outcome=\"{}\"}} {}",
+                pid,
+                outcome.name(),
+                counter(&self.frames_checked[outcome as usize - 1])
+            );
+        }
+
+        single(&mut out, pid, BYTES_WRITTEN, counter(&self.bytes_written));
+        single(
+            &mut out,
+            pid,
+            CAPTURE_MEMORY_BYTES,
+            gauges.capture_memory_bytes,
+        );
+        single(&mut out, pid, POOLED_IMAGE_BYTES, gauges.pooled_image_bytes);
+        single(&mut out, pid, SWAPCHAINS, gauges.swapchains);
+
+        if gauges.latencies.is_empty() {
+            return out;
+        }
+        header(&mut out, CAPTURE_LATENCY_SECONDS);
+        for &(swapchain, latencies) in &gauges.latencies {
+            for (stage, histogram) in latencies.histograms() {
+                let labels = format!(
+                    "pid=\"{}\",swapchain=\"{:#x}\",stage=\"{}\"",
+                    pid, swapchain, stage
+                );
+                for quantile in QUANTILES {
+                    let _ = writeln!(
+                        out,
+                        "unseen_capture_latency_seconds{{{},quantile=\"{}\"}} {:e}",
+                        labels,
+                        quantile,
+                        histogram.percentile(quantile * 100.0) as f64 * 1e-9
+                    );
+                }
+                let _ = writeln!(
+                    out,
+                    "unseen_capture_latency_seconds_sum{{{}}} {:e}",
+                    labels,
+                    histogram.sum() as f64 * 1e-9
+                );
+                let _ = writeln!(
+                    out,
+                    "unseen_capture_latency_seconds_count{{{}}} {}",
+                    labels,
+                    histogram.count()
+                );
+            }
+        }
+        out
+    }
+}
+
+impl MetricsSnapshot {
+    pub fn write(self) {
+        let tmp_path = format!("{}.tmp", self.path);
+        if let Err(e) =
+            fs::write(&tmp_path, self.text).and_then(|_| fs::rename(&tmp_path, &self.path))
+        {
+            log::error!("Failed to write metrics {}: {}", self.path, e);
+        }
+    }
+}
+
+fn header(out: &mut String, (name, kind, help): Family) {
+    let _ = writeln!(out, "# HELP unseen_{} {}", name, help);
+    let _ = writeln!(out, "# TYPE unseen_{} {}", name, kind);
+}
+
+// A family with a single sample
+fn single(out: &mut String, pid: u32, family: Family, value: u64) {
+    header(out, family);
+    let _ = writeln!(out, "unseen_{}{{pid=\"{}\"}} {}", family.0, pid, value);
+}
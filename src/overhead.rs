@@ -0,0 +1,199 @@
+// Per-entry-point overhead accounting
+//
+// Every intercepted entry point counts its calls and the CPU time spent in
+// it, split into time waiting for the layer's own locks and everything else.
+// The counters are global atomics, so with accounting off an entry point
+// pays one relaxed load. The table is written when the instance is
+// destroyed, with a per-frame column based on the number of presents, to
+// show what the layer costs when it is loaded but not capturing.
+
+use std::{
+    cell::Cell,
+    fs::File,
+    io::{BufWriter, Write},
+    sync::{
+        atomic::{AtomicBool, AtomicU64, Ordering},
+        Mutex, MutexGuard,
+    },
+    time::Instant,
+};
+
+#[derive(Debug, Clone, Copy)]
+pub enum EntryPoint {
+    GetInstanceProcAddr,
+    GetDeviceProcAddr,
+    CreateInstance,
+    DestroyInstance,
+    CreateDevice,
+    DestroyDevice,
+    CreateHeadlessSurface,
+    DestroySurface,
+    GetSurfaceCapabilities,
+    GetSurfaceFormats,
+    GetSurfacePresentModes,
+    GetSurfaceSupport,
+    CreateSwapchain,
+    DestroySwapchain,
+    GetSwapchainImages,
+    AcquireNextImage,
+    QueuePresent,
+}
+
+const ENTRY_POINTS: [EntryPoint; 17] = [
+    EntryPoint::GetInstanceProcAddr,
+    EntryPoint::GetDeviceProcAddr,
+    EntryPoint::CreateInstance,
+    EntryPoint::DestroyInstance,
+    EntryPoint::CreateDevice,
+    EntryPoint::DestroyDevice,
+    EntryPoint::CreateHeadlessSurface,
+    EntryPoint::DestroySurface,
+    EntryPoint::GetSurfaceCapabilities,
+    EntryPoint::GetSurfaceFormats,
+    EntryPoint::GetSurfacePresentModes,
+    EntryPoint::GetSurfaceSupport,
+    EntryPoint::CreateSwapchain,
+    EntryPoint::DestroySwapchain,
+    EntryPoint::GetSwapchainImages,
+    EntryPoint::AcquireNextImage,
+    EntryPoint::QueuePresent,
+];
+
+impl EntryPoint {
+    fn name(self) -> &'static str {
+        match self {
+            EntryPoint::GetInstanceProcAddr => "vkGetInstanceProcAddr",
+            EntryPoint::GetDeviceProcAddr => "vkGetDeviceProcAddr",
+            EntryPoint::CreateInstance => "vkCreateInstance",
+            EntryPoint::DestroyInstance => "vkDestroyInstance",
+            EntryPoint::CreateDevice => "vkCreateDevice",
+            EntryPoint::DestroyDevice => "vkDestroyDevice",
+            EntryPoint::CreateHeadlessSurface => "vkCreateHeadlessSurfaceEXT",
+            EntryPoint::DestroySurface => "vkDestroySurfaceKHR",
+            EntryPoint::GetSurfaceCapabilities => "vkGetPhysicalDeviceSurfaceCapabilitiesKHR",
+            EntryPoint::GetSurfaceFormats => "vkGetPhysicalDeviceSurfaceFormatsKHR",
+            EntryPoint::GetSurfacePresentModes => "vkGetPhysicalDeviceSurfacePresentModesKHR",
+            EntryPoint::GetSurfaceSupport => "vkGetPhysicalDeviceSurfaceSupportKHR",
+            EntryPoint::CreateSwapchain => "vkCreateSwapchainKHR",
+            EntryPoint::DestroySwapchain => "vkDestroySwapchainKHR",
+            EntryPoint::GetSwapchainImages => "vkGetSwapchainImagesKHR",
+            EntryPoint::AcquireNextImage => "vkAcquireNextImageKHR",
+            EntryPoint::QueuePresent => "vkQueuePresentKHR",
+        }
+    }
+}
+
+struct Counters {
+    calls: AtomicU64,
+    total_ns: AtomicU64,
+    lock_wait_ns: AtomicU64,
+}
+
+const ZERO: Counters = Counters {
+    calls: AtomicU64::new(0),
+    total_ns: AtomicU64::new(0),
+    lock_wait_ns: AtomicU64::new(0),
+};
+
+static ENABLED: AtomicBool = AtomicBool::new(false);
+static COUNTERS: [Counters; ENTRY_POINTS.len()] = [ZERO; ENTRY_POINTS.len()];
+
+thread_local! {
+    // Lock wait of the innermost entry point running on this thread
+    static LOCK_WAIT_NS: Cell<u64> = Cell::new(0);
+}
+
+pub fn start() {
+    ENABLED.store(true, Ordering::Relaxed);
+}
+
+// Accounts the entry point's time when dropped
+#[must_use]
+pub struct Call {
+    entry: EntryPoint,
+    start: Option<Instant>,
+    // Lock wait of an enclosing entry point, restored on drop
+    outer_lock_wait_ns: u64,
+}
+
+#[inline]
+pub fn enter(entry: EntryPoint) -> Call {
+    if !ENABLED.load(Ordering::Relaxed) {
+        return Call {
+            entry,
+            start: None,
+            outer_lock_wait_ns: 0,
+        };
+    }
+    Call {
+        entry,
+        start: Some(Instant::now()),
+        outer_lock_wait_ns: LOCK_WAIT_NS.with(|wait| wait.replace(0)),
+    }
+}
+
+impl Drop for Call {
+    fn drop(&mut self) {
+        if let Some(start) = self.start {
+            let total_ns = start.elapsed().as_nanos() as u64;
+            let lock_wait_ns = LOCK_WAIT_NS.with(|wait| wait.replace(self.outer_lock_wait_ns));
+            let counters = &COUNTERS[self.entry as usize];
+            counters.calls.fetch_add(1, Ordering::Relaxed);
+            counters.total_ns.fetch_add(total_ns, Ordering::Relaxed);
+            counters
+                .lock_wait_ns
+                .fetch_add(lock_wait_ns, Ordering::Relaxed);
+        }
+    }
+}
+
+// Locks `mutex`, charging the wait to the current entry point
+#[inline]
+pub fn lock<T>(mutex: &Mutex<T>) -> MutexGuard<'_, T> {
+    if !ENABLED.load(Ordering::Relaxed) {
+        return mutex.lock().unwrap();
+    }
+    let start = Instant::now();
+    let guard = mutex.lock().unwrap();
+    let wait_ns = start.elapsed().as_nanos() as u64;
+    LOCK_WAIT_NS.with(|wait| wait.set(wait.get() + wait_ns));
+    guard
+}
+
+pub fn enabled() -> bool {
+    ENABLED.load(Ordering::Relaxed)
+}
+
+pub fn report(path: &str) -> Result<(), std::io::Error> {
+    let mut writer = BufWriter::new(File::create(path)?);
+    let frames = COUNTERS[EntryPoint::QueuePresent as usize]
+        .calls
+        .load(Ordering::Relaxed);
+    writeln!(writer, "# frames {}", frames)?;
+    writeln!(
+        writer,
+        "# entry_point calls total_us lock_wait_us own_us ns_per_call ns_per_frame"
+    )?;
+
+    for entry in ENTRY_POINTS {
+        let counters = &COUNTERS[entry as usize];
+        let calls = counters.calls.load(Ordering::Relaxed);
+        if calls == 0 {
+            continue;
+        }
+        let total_ns = counters.total_ns.load(Ordering::Relaxed);
+        let lock_wait_ns = counters.lock_wait_ns.load(Ordering::Relaxed);
+        writeln!(
+            writer,
+            "{} {} {:.1} {:.1} {:.1} {} {}",
+            entry.name(),
+            calls,
+            total_ns as f64 / 1000.0,
+            lock_wait_ns as f64 / 1000.0,
+            total_ns.saturating_sub(lock_wait_ns) as f64 / 1000.0,
+            total_ns / calls,
+            total_ns / frames.max(1)
+        )?;
+    }
+    writer.flush()
+}
@@ -0,0 +1,113 @@
+// USDT (SystemTap SDT) probes
+//
+// Each probe site is a single `nop` plus an entry in the `.note.stapsdt`
+// section recording its address, name and argument locations, in the layout
+// <sys/sdt.h> produces. bpftrace, perf and SystemTap find the probes in the
+// shared object without any help from the layer, e.g.
+//
+//   bpftrace -e 'usdt:/path/to/libVkLayer_PRIVATE_unseen.so:unseen:write_done
+//                { @bytes = hist(arg2); }'
+//
+// and patch the `nop` to a breakpoint only while attached. There is no
+// semaphore, so arguments are always computed; every probe passes at most
+// three cheap integers, as signed 64-bit values.
+//
+// Probes, with their arguments:
+//   present_entry  swapchain_count, first swapchain, -
+//   present_return swapchain_count, first swapchain, VkResult
+//   capture_begin  frame, swapchain, mapped image bytes
+//   capture_end    frame, swapchain, bytes written (0 if none)
+//   frame_drop     frame, swapchain, reason (see metrics::DropReason)
+//   write_done     frame, swapchain, bytes written
+
+#[cfg(all(target_os = "linux", target_arch = "x86_64"))]
+macro_rules! sdt_asm {
+    ($name:ident, $args:literal $(, $arg:expr)*) => {
+        unsafe {
+            std::arch::asm!(
+                $crate::probe::sdt_note!($name, $args),
+                $(in(reg) ($arg) as i64,)*
+                options(att_syntax, readonly, nostack, preserves_flags),
+            )
+        }
+    };
+}
+
+#[cfg(all(target_os = "linux", target_arch = "aarch64"))]
+macro_rules! sdt_asm {
+    ($name:ident, $args:literal $(, $arg:expr)*) => {
+        unsafe {
+            std::arch::asm!(
+                $crate::probe::sdt_note!($name, $args),
+                $(in(reg) ($arg) as i64,)*
+                options(readonly, nostack, preserves_flags),
+            )
+        }
+    };
+}
+
+// Other targets keep the arguments type-checked but emit nothing
+#[cfg(not(all(
+    target_os = "linux",
+    any(target_arch = "x86_64", target_arch = "aarch64")
+)))]
+macro_rules! sdt_asm {
+    ($name:ident, $args:literal $(, $arg:expr)*) => {
+        $(let _ = ($arg) as i64;)*
+    };
+}
+
+macro_rules! sdt_note {
+    ($name:ident, $args:literal) => {
+        concat!(
+            r#"
+990:    nop
+        .pushsection .note.stapsdt, "", "note"
+        .balign 4
+        .4byte 992f-991f, 994f-993f, 3
+991:    .asciz "stapsdt"
+992:    .balign 4
+993:    .8byte 990b
+        .8byte _.stapsdt.base
+        .8byte 0
+        .asciz "unseen"
+        .asciz ""#,
+            stringify!($name),
+            r#""
+        .asciz ""#,
+            $args,
+            r#""
+994:    .balign 4
+        .popsection
+.ifndef _.stapsdt.base
+        .pushsection .stapsdt.base, "aGR", "progbits", .stapsdt.base, comdat
+        .weak _.stapsdt.base
+        .hidden _.stapsdt.base
+_.stapsdt.base:
+        .space 1
+        .size _.stapsdt.base, 1
+        .popsection
+.endif
+"#
+        )
+    };
+}
+
+macro_rules! usdt {
+    ($name:ident) => {
+        $crate::probe::sdt_asm!($name, "")
+    };
+    ($name:ident, $a0:expr) => {
+        $crate::probe::sdt_asm!($name, "-8@{0}", $a0)
+    };
+    ($name:ident, $a0:expr, $a1:expr) => {
+        $crate::probe::sdt_asm!($name, "-8@{0} -8@{1}", $a0, $a1)
+    };
+    ($name:ident, $a0:expr, $a1:expr, $a2:expr) => {
+        $crate::probe::sdt_asm!($name, "-8@{0} -8@{1} -8@{2}", $a0, $a1, $a2)
+    };
+}
+
+pub(crate) use sdt_asm;
+pub(crate) use sdt_note;
+pub(crate) use usdt;
@@ -0,0 +1,398 @@
+// Synthetic frame content for benchmarking the capture sinks without a
+// Vulkan driver
+//
+// Each scene draws straight into a buffer laid out like a mapped swapchain
+// image (any capture format, any row pitch). Scenes are cheap to advance, so
+// the frame rate is bounded by the sinks rather than by the generator:
+//   ui        static panels and text with a small spinner; frames differ in
+//             a few hundred pixels
+//   text      a page of text scrolling up two rows per frame
+//   gradient  full-screen colour ramps that shift every frame
+//   noise     fresh random bytes every frame, incompressible
+
+const GLYPH_WIDTH: usize = 8;
+const GLYPH_HEIGHT: usize = 16;
+const SCROLL_ROWS_PER_FRAME: usize = 2;
+const SPINNER_SEGMENTS: [(usize, usize); 8] = [
+    (8, 0),
+    (16, 0),
+    (16, 8),
+    (16, 16),
+    (8, 16),
+    (0, 16),
+    (0, 8),
+    (0, 0),
+];
+
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum Scene {
+    Ui,
+    Text,
+    Gradient,
+    Noise,
+}
+
+pub const SCENES: [Scene; 4] = [Scene::Ui, Scene::Text, Scene::Gradient, Scene::Noise];
+
+impl Scene {
+    pub fn parse(name: &str) -> Option<Self> {
+        SCENES.iter().copied().find(|scene| scene.name() == name)
+    }
+
+    pub fn name(self) -> &'static str {
+        match self {
+            Scene::Ui => "ui",
+            Scene::Text => "text",
+            Scene::Gradient => "gradient",
+            Scene::Noise => "noise",
+        }
+    }
+}
+
+// Pixel layout of the target buffer
+#[derive(Clone, Copy)]
+struct Layout {
+    width: usize,
+    height: usize,
+    bytes_per_pixel: usize,
+    // Byte offsets of R, G and B within a pixel
+    channels: [usize; 3],
+}
+
+impl Layout {
+    fn pixel(&self, rgb: [u8; 3]) -> [u8; 4] {
+        // Opaque alpha in the fourth byte of four-byte formats
+        let mut pixel = [255; 4];
+        for (i, &offset) in self.channels.iter().enumerate() {
+            pixel[offset] = rgb[i];
+        }
+        pixel
+    }
+
+    fn row_bytes(&self) -> usize {
+        self.width * self.bytes_per_pixel
+    }
+}
+
+pub struct SyntheticSource {
+    scene: Scene,
+    layout: Layout,
+    // Pre-rendered content with tight rows: the whole UI, or a text page
+    // twice the frame height that the text scene scrolls through
+    canvas: Vec<u8>,
+    canvas_rows: usize,
+    // Per-column and per-row ramps of the gradient scene
+    ramp_x: Vec<u8>,
+    ramp_y: Vec<u8>,
+    rng: u64,
+}
+
+impl SyntheticSource {
+    pub fn new(
+        scene: Scene,
+        width: u32,
+        height: u32,
+        bytes_per_pixel: usize,
+        channels: [usize; 3],
+    ) -> Self {
+        let layout = Layout {
+            width: width as usize,
+            height: height as usize,
+            bytes_per_pixel,
+            channels,
+        };
+        let mut source = Self {
+            scene,
+            layout,
+            canvas: Vec::new(),
+            canvas_rows: 0,
+            ramp_x: Vec::new(),
+            ramp_y: Vec::new(),
+            rng: 0x9e37_79b9_7f4a_7c15,
+        };
+
+        match scene {
+            Scene::Ui => source.render_ui(),
+            Scene::Text => source.render_page(),
+            Scene::Gradient => {
+                source.ramp_x = (0..layout.width)
+                    .map(|x| (x * 256 / layout.width.max(1)) as u8)
+                    .collect();
+                source.ramp_y = (0..layout.height)
+                    .map(|y| (y * 256 / layout.height.max(1)) as u8)
+                    .collect();
+            }
+            Scene::Noise => {}
+        }
+        source
+    }
+
+    // Draws frame `frame_num` into `data`, whose rows are `row_pitch` bytes apart
+    pub fn draw(&mut self, frame_num: u32, data: &mut [u8], row_pitch: usize) {
+        let layout = self.layout;
+        let row_bytes = layout.row_bytes();
+        match self.scene {
+            Scene::Ui => {
+                let rows = (self.canvas_rows, layout.height);
+                copy_rows(&self.canvas, row_bytes, 0, rows, data, row_pitch);
+                let lit = frame_num as usize % SPINNER_SEGMENTS.len();
+                let origin = (layout.width.saturating_sub(36), 6);
+                for (i, &(x, y)) in SPINNER_SEGMENTS.iter().enumerate() {
+                    let colour = if i == lit {
+                        [255, 255, 255]
+                    } else {
+                        [90, 96, 108]
+                    };
+                    let rect = (origin.0 + x, origin.1 + y, 6, 6);
+                    fill_rect(&layout, data, row_pitch, rect, colour);
+                }
+            }
+            Scene::Text => {
+                let offset = frame_num as usize * SCROLL_ROWS_PER_FRAME;
+                let rows = (self.canvas_rows, layout.height);
+                copy_rows(&self.canvas, row_bytes, offset, rows, data, row_pitch);
+            }
+            Scene::Gradient => {
+                let t = frame_num as u8;
+                let [r, g, b] = layout.channels;
+                // Starts from opaque pixels so alpha never needs writing
+                let opaque = layout.pixel([0; 3]);
+                for (y, row) in data.chunks_mut(row_pitch).take(layout.height).enumerate() {
+                    let ry = self.ramp_y[y];
+                    let green = ry.wrapping_add(t.wrapping_mul(3));
+                    let pixels = row[..row_bytes].chunks_exact_mut(layout.bytes_per_pixel);
+                    for (pixel, &rx) in pixels.zip(&self.ramp_x) {
+                        pixel.copy_from_slice(&opaque[..layout.bytes_per_pixel]);
+                        pixel[r] = rx.wrapping_add(t.wrapping_mul(4));
+                        pixel[g] = green;
+                        let mean = ((rx as u16 + ry as u16) / 2) as u8;
+                        pixel[b] = mean.wrapping_add(t.wrapping_mul(5));
+                    }
+                }
+            }
+            Scene::Noise => {
+                for row in data.chunks_mut(row_pitch).take(layout.height) {
+                    for chunk in row[..row_bytes].chunks_mut(8) {
+                        let bytes = xorshift(&mut self.rng).to_le_bytes();
+                        chunk.copy_from_slice(&bytes[..chunk.len()]);
+                    }
+                }
+            }
+        }
+    }
+
+    // Title bar, sidebar and a content panel of paragraphs and buttons
+    fn render_ui(&mut self) {
+        let layout = self.layout;
+        let (width, height) = (layout.width, layout.height);
+        let row_bytes = layout.row_bytes();
+        self.canvas = vec![0; row_bytes * height];
+        self.canvas_rows = height;
+        let canvas = &mut self.canvas;
+
+        fill_rect(
+            &layout,
+            canvas,
+            row_bytes,
+            (0, 0, width, height),
+            [236, 236, 236],
+        );
+        fill_rect(&layout, canvas, row_bytes, (0, 0, width, 36), [40, 44, 52]);
+        let title_columns = (width / 3) / GLYPH_WIDTH;
+        draw_text(
+            &layout,
+            canvas,
+            row_bytes,
+            (12, 10),
+            title_columns,
+            [220, 223, 228],
+            &mut self.rng,
+        );
+
+        let sidebar = width / 5;
+        fill_rect(
+            &layout,
+            canvas,
+            row_bytes,
+            (0, 36, sidebar, height),
+            [60, 64, 72],
+        );
+        let sidebar_columns = sidebar.saturating_sub(24) / GLYPH_WIDTH;
+        for y in (52..height.saturating_sub(GLYPH_HEIGHT)).step_by(28) {
+            draw_text(
+                &layout,
+                canvas,
+                row_bytes,
+                (12, y),
+                sidebar_columns,
+                [200, 204, 210],
+                &mut self.rng,
+            );
+        }
+
+        let panel = (
+            sidebar + 16,
+            52,
+            width.saturating_sub(sidebar + 32),
+            height.saturating_sub(68),
+        );
+        fill_rect(&layout, canvas, row_bytes, panel, [255, 255, 255]);
+        let columns = panel.2.saturating_sub(32) / GLYPH_WIDTH;
+        let bottom = (panel.1 + panel.3).saturating_sub(64);
+        let mut y = panel.1 + 16;
+        while y + GLYPH_HEIGHT < bottom {
+            // Paragraphs of five lines
+            for _ in 0..5 {
+                if y + GLYPH_HEIGHT >= bottom {
+                    break;
+                }
+                draw_text(
+                    &layout,
+                    canvas,
+                    row_bytes,
+                    (panel.0 + 16, y),
+                    columns,
+                    [30, 30, 30],
+                    &mut self.rng,
+                );
+                y += GLYPH_HEIGHT + 4;
+            }
+            y += GLYPH_HEIGHT;
+        }
+        for i in 0..3 {
+            let button = (panel.0 + 16 + i * 136, bottom + 16, 120, 32);
+            fill_rect(&layout, canvas, row_bytes, button, [52, 120, 246]);
+            draw_text(
+                &layout,
+                canvas,
+                row_bytes,
+                (button.0 + 16, button.1 + 8),
+                11,
+                [255, 255, 255],
+                &mut self.rng,
+            );
+        }
+    }
+
+    // Dark text on a light background, wrapping seamlessly
+    fn render_page(&mut self) {
+        let layout = self.layout;
+        let row_bytes = layout.row_bytes();
+        let lines = (layout.height * 2).div_ceil(GLYPH_HEIGHT).max(1);
+        self.canvas_rows = lines * GLYPH_HEIGHT;
+        self.canvas = vec![0; row_bytes * self.canvas_rows];
+        let canvas = &mut self.canvas;
+
+        let page = (0, 0, layout.width, self.canvas_rows);
+        fill_rect(&layout, canvas, row_bytes, page, [250, 250, 246]);
+        let columns = layout.width.saturating_sub(32) / GLYPH_WIDTH;
+        for line in 0..lines {
+            // Ragged right edge, as in prose
+            let length = columns.saturating_sub((xorshift(&mut self.rng) % 24) as usize);
+            let origin = (16, line * GLYPH_HEIGHT);
+            draw_text(
+                &layout,
+                canvas,
+                row_bytes,
+                origin,
+                length,
+                [24, 24, 32],
+                &mut self.rng,
+            );
+        }
+    }
+}
+
+fn xorshift(state: &mut u64) -> u64 {
+    let mut x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    x
+}
+
+// Copies `height` rows into `data` from `source`, starting at row `offset`
+// and wrapping around its `source_rows`
+fn copy_rows(
+    source: &[u8],
+    row_bytes: usize,
+    offset: usize,
+    (source_rows, height): (usize, usize),
+    data: &mut [u8],
+    row_pitch: usize,
+) {
+    if source_rows == 0 {
+        return;
+    }
+    for (y, row) in data.chunks_mut(row_pitch).take(height).enumerate() {
+        let start = (offset + y) % source_rows * row_bytes;
+        row[..row_bytes].copy_from_slice(&source[start..start + row_bytes]);
+    }
+}
+
+// Fills (x, y, width, height), clipped to the buffer
+fn fill_rect(
+    layout: &Layout,
+    data: &mut [u8],
+    row_pitch: usize,
+    (x, y, width, height): (usize, usize, usize, usize),
+    rgb: [u8; 3],
+) {
+    let pixel = layout.pixel(rgb);
+    let pixel = &pixel[..layout.bytes_per_pixel];
+    let x_end = (x + width).min(layout.width);
+    let y_end = (y + height).min(data.len() / row_pitch);
+    for row in y.min(y_end)..y_end {
+        let row_start = row * row_pitch;
+        let start = row_start + x.min(x_end) * layout.bytes_per_pixel;
+        let end = row_start + x_end * layout.bytes_per_pixel;
+        for target in data[start..end].chunks_exact_mut(layout.bytes_per_pixel) {
+            target.copy_from_slice(pixel);
+        }
+    }
+}
+
+// A line of `columns` glyph cells of words and spaces. Glyphs are random
+// 6x10 bit patterns, which compress and hash like real text.
+fn draw_text(
+    layout: &Layout,
+    data: &mut [u8],
+    row_pitch: usize,
+    (x, y): (usize, usize),
+    columns: usize,
+    rgb: [u8; 3],
+    rng: &mut u64,
+) {
+    let pixel = layout.pixel(rgb);
+    let pixel = &pixel[..layout.bytes_per_pixel];
+    let rows = data.len() / row_pitch;
+    let mut word_left = 0;
+    for column in 0..columns {
+        if word_left == 0 {
+            // A space, then the next word of 2 to 9 letters
+            word_left = 2 + (xorshift(rng) % 8) as usize;
+            continue;
+        }
+        word_left -= 1;
+
+        // One of 64 glyphs, so letters repeat as in text
+        let mut glyph = xorshift(rng) % 64 + 1;
+        let glyph_bits = xorshift(&mut glyph);
+        let cell_x = x + column * GLYPH_WIDTH + 1;
+        for glyph_y in 0..10 {
+            let row = y + 3 + glyph_y;
+            if row >= rows {
+                break;
+            }
+            for glyph_x in 0..6 {
+                let px = cell_x + glyph_x;
+                if px >= layout.width || glyph_bits >> (glyph_y * 6 + glyph_x) & 1 == 0 {
+                    continue;
+                }
+                let offset = row * row_pitch + px * layout.bytes_per_pixel;
+                data[offset..offset + layout.bytes_per_pixel].copy_from_slice(pixel);
+            }
+        }
+    }
+}
@@ -0,0 +1,264 @@
+// Chrome trace export of layer activity
+//
+// Intercepted calls and capture stages record begin/end events into a
+// fixed-size ring owned by the calling thread. Recording is one relaxed
+// atomic store per event: the thread is the ring's only writer, and each slot
+// packs the event, phase and timestamp into a single u64 so the exporter can
+// never see a torn event. Rings are registered globally once per thread and
+// outlive it, and keep the most recent events when they wrap. Starting a new
+// trace empties them, so each instance exports only its own events.
+//
+// Timestamps come from CLOCK_MONOTONIC and thread ids are kernel tids, so the
+// exported JSON can be loaded next to the application's own trace in
+// chrome://tracing or ui.perfetto.dev and lines up with it.
+//
+// With the `trace` feature disabled, `span` compiles to nothing; with it
+// enabled but tracing off, a span costs one relaxed load.
+
+use std::{
+    fs::File,
+    io::{BufWriter, Write},
+    sync::{
+        atomic::{AtomicBool, AtomicU64, AtomicUsize, Ordering},
+        Arc, Mutex, OnceLock,
+    },
+};
+
+const TIMESTAMP_BITS: u32 = 56;
+const TIMESTAMP_MASK: u64 = (1 << TIMESTAMP_BITS) - 1;
+const BEGIN: u64 = 1 << 63;
+
+#[derive(Debug, Clone, Copy, PartialEq)]
+#[repr(u8)]
+pub enum Event {
+    CreateDevice,
+    DestroyDevice,
+    CreateSwapchain,
+    DestroySwapchain,
+    GetSwapchainImages,
+    Acquire,
+    Present,
+    // Capture stages
+    Capture,
+    Barrier,
+    Submit,
+    FenceWait,
+    Compare,
+    Convert,
+    Encode,
+    Write,
+}
+
+const EVENTS: [Event; 15] = [
+    Event::CreateDevice,
+    Event::DestroyDevice,
+    Event::CreateSwapchain,
+    Event::DestroySwapchain,
+    Event::GetSwapchainImages,
+    Event::Acquire,
+    Event::Present,
+    Event::Capture,
+    Event::Barrier,
+    Event::Submit,
+    Event::FenceWait,
+    Event::Compare,
+    Event::Convert,
+    Event::Encode,
+    Event::Write,
+];
+
+impl Event {
+    fn name(self) -> &'static str {
+        match self {
+            Event::CreateDevice => "vkCreateDevice",
+            Event::DestroyDevice => "vkDestroyDevice",
+            Event::CreateSwapchain => "vkCreateSwapchainKHR",
+            Event::DestroySwapchain => "vkDestroySwapchainKHR",
+            Event::GetSwapchainImages => "vkGetSwapchainImagesKHR",
+            Event::Acquire => "vkAcquireNextImageKHR",
+            Event::Present => "vkQueuePresentKHR",
+            Event::Capture => "capture",
+            Event::Barrier => "barrier",
+            Event::Submit => "submit",
+            Event::FenceWait => "fence_wait",
+            Event::Compare => "compare",
+            Event::Convert => "convert",
+            Event::Encode => "encode",
+            Event::Write => "write",
+        }
+    }
+}
+
+static ENABLED: AtomicBool = AtomicBool::new(false);
+// CLOCK_MONOTONIC at start; slots store timestamps relative to it
+static BASE_NS: AtomicU64 = AtomicU64::new(0);
+static EVENTS_PER_THREAD: AtomicUsize = AtomicUsize::new(0);
+static RINGS: OnceLock<Mutex<Vec<Arc<ThreadRing>>>> = OnceLock::new();
+
+thread_local! {
+    static RING: Arc<ThreadRing> = ThreadRing::register();
+}
+
+struct ThreadRing {
+    tid: i64,
+    name: Option<String>,
+    // Total events ever recorded; the next slot is `head % slots.len()`
+    head: AtomicUsize,
+    slots: Box<[AtomicU64]>,
+}
+
+impl ThreadRing {
+    fn register() -> Arc<Self> {
+        let ring = Arc::new(Self {
+            tid: unsafe { libc::syscall(libc::SYS_gettid) } as i64,
+            name: std::thread::current().name().map(str::to_owned),
+            head: AtomicUsize::new(0),
+            slots: (0..EVENTS_PER_THREAD.load(Ordering::Relaxed).max(1))
+                .map(|_| AtomicU64::new(0))
+                .collect(),
+        });
+        rings().lock().unwrap().push(ring.clone());
+        ring
+    }
+
+    fn push(&self, word: u64) {
+        let head = self.head.load(Ordering::Relaxed);
+        self.slots[head % self.slots.len()].store(word, Ordering::Relaxed);
+        self.head.store(head + 1, Ordering::Release);
+    }
+}
+
+fn rings() -> &'static Mutex<Vec<Arc<ThreadRing>>> {
+    RINGS.get_or_init(|| Mutex::new(Vec::new()))
+}
+
+fn clock_ns() -> u64 {
+    let mut ts = libc::timespec {
+        tv_sec: 0,
+        tv_nsec: 0,
+    };
+    unsafe { libc::clock_gettime(libc::CLOCK_MONOTONIC, &mut ts) };
+    ts.tv_sec as u64 * 1_000_000_000 + ts.tv_nsec as u64
+}
+
+// Starts recording; each thread gets a ring of `events_per_thread` events
+pub fn start(events_per_thread: usize) {
+    if cfg!(feature = "trace") {
+        ENABLED.store(false, Ordering::Release);
+        // Events of an earlier instance are relative to its BASE_NS. Rings of
+        // exited threads are dropped; live threads keep theirs, emptied.
+        rings().lock().unwrap().retain(|ring| {
+            ring.head.store(0, Ordering::Relaxed);
+            Arc::strong_count(ring) > 1
+        });
+        BASE_NS.store(clock_ns(), Ordering::Relaxed);
+        EVENTS_PER_THREAD.store(events_per_thread, Ordering::Relaxed);
+        ENABLED.store(true, Ordering::Release);
+    } else {
+        log::warn!("Tracing requested but the layer was built without the `trace` feature");
+    }
+}
+
+#[inline]
+pub fn enabled() -> bool {
+    cfg!(feature = "trace") && ENABLED.load(Ordering::Relaxed)
+}
+
+fn record(event: Event, begin: bool) {
+    let ts = clock_ns().saturating_sub(BASE_NS.load(Ordering::Relaxed)) & TIMESTAMP_MASK;
+    let phase = if begin { BEGIN } else { 0 };
+    let word = phase | (event as u64) << TIMESTAMP_BITS | ts;
+    // Events during thread teardown, after the ring is gone, are dropped
+    let _ = RING.try_with(|ring| ring.push(word));
+}
+
+// Records a begin event now and the matching end event when dropped
+#[must_use]
+pub struct Span(Option<Event>);
+
+#[inline]
+pub fn span(event: Event) -> Span {
+    if !enabled() {
+        return Span(None);
+    }
+    record(event, true);
+    Span(Some(event))
+}
+
+impl Drop for Span {
+    #[inline]
+    fn drop(&mut self) {
+        if let Some(event) = self.0 {
+            record(event, false);
+        }
+    }
+}
+
+// Writes every thread's ring as Chrome trace JSON and stops recording
+pub fn export(path: &str) -> Result<usize, std::io::Error> {
+    ENABLED.store(false, Ordering::Release);
+
+    let base_ns = BASE_NS.load(Ordering::Relaxed);
+    let pid = std::process::id();
+    let mut writer = BufWriter::new(File::create(path)?);
+    let mut written = 0;
+
+    write!(writer, "{{\"displayTimeUnit\":\"ns\",\"traceEvents\":[")?;
+    let mut separator = "";
+    for ring in rings().lock().unwrap().iter() {
+        if let Some(name) = &ring.name {
+            write!(
+                writer,
+                "{}\n{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":{},\"tid\":{},\
+                 \"args\":{{\"name\":\"{}\"}}}}",
+                separator,
+                pid,
+                ring.tid,
+                name.chars()
+                    .map(|c| match c {
+                        ' ' | '!' | '#'..='[' | ']'..='~' => c,
+                        _ => '_',
+                    })
+                    .collect::<String>()
+            )?;
+            separator = ",";
+        }
+
+        let head = ring.head.load(Ordering::Acquire);
+        let capacity = ring.slots.len();
+        // End events whose begin was overwritten would close unrelated spans
+        let mut depth = 0usize;
+        for index in head.saturating_sub(capacity)..head {
+            let word = ring.slots[index % capacity].load(Ordering::Relaxed);
+            let begin = word & BEGIN != 0;
+            let event = EVENTS[((word >> TIMESTAMP_BITS) & 0x7f) as usize % EVENTS.len()];
+            if begin {
+                depth += 1;
+            } else if depth == 0 {
+                continue;
+            } else {
+                depth -= 1;
+            }
+
+            let ts_ns = base_ns + (word & TIMESTAMP_MASK);
+            write!(
+                writer,
+                "{}\n{{\"name\":\"{}\",\"cat\":\"unseen\",\"ph\":\"{}\",\"ts\":{}.{:03},\
+                 \"pid\":{},\"tid\":{}}}",
+                separator,
+                event.name(),
+                if begin { "B" } else { "E" },
+                ts_ns / 1000,
+                ts_ns % 1000,
+                pid,
+                ring.tid
+            )?;
+            separator = ",";
+            written += 1;
+        }
+    }
+    writeln!(writer, "\n]}}")?;
+    writer.flush()?;
+
+    Ok(written)
+}
@@ -0,0 +1,115 @@
+#include "common.h"
+
+#include <time.h>
+
+uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+VkInstance create_headless_instance(const char* application_name) {
+    VkApplicationInfo app_info = {0};
+    app_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    app_info.pApplicationName = application_name;
+    app_info.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+    app_info.apiVersion = VK_API_VERSION_1_0;
+
+    const char* instance_extensions[] = {
+        VK_KHR_SURFACE_EXTENSION_NAME,
+        VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME
+    };
+
+    VkInstanceCreateInfo create_info = {0};
+    create_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    create_info.pApplicationInfo = &app_info;
+    create_info.enabledExtensionCount = sizeof(instance_extensions) / sizeof(instance_extensions[0]);
+    create_info.ppEnabledExtensionNames = instance_extensions;
+
+    VkInstance instance;
+    CHECK_VK_RESULT(vkCreateInstance(&create_info, NULL, &instance));
+    return instance;
+}
+
+VkPhysicalDevice first_physical_device(VkInstance instance) {
+    VkPhysicalDevice physical_device;
+    uint32_t device_count = 1;
+    VkResult result = vkEnumeratePhysicalDevices(instance, &device_count, &physical_device);
+    if (device_count == 0 || (result != VK_SUCCESS && result != VK_INCOMPLETE)) {
+        fprintf(stderr, "No physical devices found\n");
+        exit(1);
+    }
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physical_device, &properties);
+    fprintf(stderr, "Device: %s\n", properties.deviceName);
+    return physical_device;
+}
+
+uint32_t find_graphics_queue_family(VkPhysicalDevice physical_device, uint32_t* queue_count) {
+    uint32_t family_count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &family_count, NULL);
+    VkQueueFamilyProperties* families = malloc(sizeof(VkQueueFamilyProperties) * family_count);
+    vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &family_count, families);
+    uint32_t queue_family = UINT32_MAX;
+    for (uint32_t i = 0; i < family_count; i++) {
+        if (families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+            queue_family = i;
+            if (queue_count) {
+                *queue_count = families[i].queueCount;
+            }
+            break;
+        }
+    }
+    free(families);
+    if (queue_family == UINT32_MAX) {
+        fprintf(stderr, "No graphics queue family found\n");
+        exit(1);
+    }
+    return queue_family;
+}
+
+VkDevice create_swapchain_device(VkPhysicalDevice physical_device, uint32_t queue_family,
+                                 uint32_t queue_count) {
+    float* queue_priorities = malloc(sizeof(float) * queue_count);
+    for (uint32_t i = 0; i < queue_count; i++) {
+        queue_priorities[i] = 1.0f;
+    }
+
+    VkDeviceQueueCreateInfo queue_info = {0};
+    queue_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queue_info.queueFamilyIndex = queue_family;
+    queue_info.queueCount = queue_count;
+    queue_info.pQueuePriorities = queue_priorities;
+
+    const char* device_extensions[] = {
+        VK_KHR_SWAPCHAIN_EXTENSION_NAME
+    };
+
+    VkDeviceCreateInfo create_info = {0};
+    create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    create_info.queueCreateInfoCount = 1;
+    create_info.pQueueCreateInfos = &queue_info;
+    create_info.enabledExtensionCount = sizeof(device_extensions) / sizeof(device_extensions[0]);
+    create_info.ppEnabledExtensionNames = device_extensions;
+
+    VkDevice device;
+    CHECK_VK_RESULT(vkCreateDevice(physical_device, &create_info, NULL, &device));
+    free(queue_priorities);
+    return device;
+}
+
+VkSurfaceKHR create_headless_surface(VkInstance instance) {
+    VkHeadlessSurfaceCreateInfoEXT surface_info = {0};
+    surface_info.sType = VK_STRUCTURE_TYPE_HEADLESS_SURFACE_CREATE_INFO_EXT;
+    PFN_vkCreateHeadlessSurfaceEXT vkCreateHeadlessSurfaceEXT =
+        (PFN_vkCreateHeadlessSurfaceEXT)vkGetInstanceProcAddr(instance, "vkCreateHeadlessSurfaceEXT");
+    if (!vkCreateHeadlessSurfaceEXT) {
+        fprintf(stderr, "vkCreateHeadlessSurfaceEXT not available\n");
+        exit(1);
+    }
+
+    VkSurfaceKHR surface;
+    CHECK_VK_RESULT(vkCreateHeadlessSurfaceEXT(instance, &surface_info, NULL, &surface));
+    return surface;
+}
@@ -0,0 +1,41 @@
+#ifndef UNSEEN_TEST_COMMON_H
+#define UNSEEN_TEST_COMMON_H
+
+#include <vulkan/vulkan.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Setup shared by the test and benchmark programs in tests/c: an instance,
+// device and headless surface on the first physical device, with the
+// layer enabled or not through VK_INSTANCE_LAYERS. Every failure prints an
+// error and exits with 1. scripts/build_c_programs.sh links common.c into
+// each program.
+
+#define CHECK_VK_RESULT(result) \
+    do { \
+        if ((result) != VK_SUCCESS) { \
+            fprintf(stderr, "Vulkan error at %s:%d: %d\n", __FILE__, __LINE__, (result)); \
+            exit(1); \
+        } \
+    } while (0)
+
+uint64_t now_ns(void);
+
+// Instance with VK_KHR_surface and VK_EXT_headless_surface
+VkInstance create_headless_instance(const char* application_name);
+
+// Prints the device name to stderr
+VkPhysicalDevice first_physical_device(VkInstance instance);
+
+// First queue family with graphics support; its queue count goes to
+// `queue_count` unless that is NULL
+uint32_t find_graphics_queue_family(VkPhysicalDevice physical_device, uint32_t* queue_count);
+
+// Device with VK_KHR_swapchain and `queue_count` queues of `queue_family`
+VkDevice create_swapchain_device(VkPhysicalDevice physical_device, uint32_t queue_family,
+                                 uint32_t queue_count);
+
+VkSurfaceKHR create_headless_surface(VkInstance instance);
+
+#endif
@@ -0,0 +1,231 @@
+#include <vulkan/vulkan.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+
+// Layer dispatch benchmark
+//
+// Acquires and presents swapchain images as fast as possible without
+// rendering anything, and reports how long each vkAcquireNextImageKHR and
+// vkQueuePresentKHR call takes. On the null driver (tests/icd/null_icd.c)
+// nothing below the layer does any work, so the times are the loader's
+// trampoline plus the layer itself; scripts/bench_dispatch.sh runs it that
+// way. Reading the clock costs a few nanoseconds, printed as "timer".
+
+typedef struct {
+    uint32_t width;
+    uint32_t height;
+    uint32_t iterations;
+    uint32_t warmup;
+    const char* label;
+} BenchOptions;
+
+typedef struct {
+    VkInstance instance;
+    VkPhysicalDevice physical_device;
+    VkDevice device;
+    uint32_t queue_family;
+    VkQueue queue;
+    VkSurfaceKHR surface;
+    VkSwapchainKHR swapchain;
+    VkSemaphore acquired;
+} BenchContext;
+
+static void usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --width N       Swapchain width (default 1920)\n"
+            "  --height N      Swapchain height (default 1080)\n"
+            "  --iterations N  Measured acquire/present pairs (default 100000)\n"
+            "  --warmup N      Unmeasured pairs before that (default 1000)\n"
+            "  --label NAME    Name printed with the results (default dispatch_bench)\n",
+            program);
+    exit(2);
+}
+
+static BenchOptions parse_options(int argc, char** argv) {
+    BenchOptions options = {
+        .width = 1920,
+        .height = 1080,
+        .iterations = 100000,
+        .warmup = 1000,
+        .label = "dispatch_bench",
+    };
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+        }
+        const char* name = argv[i];
+        const char* value = argv[++i];
+        if (strcmp(name, "--width") == 0) {
+            options.width = (uint32_t)strtoul(value, NULL, 10);
+        } else if (strcmp(name, "--height") == 0) {
+            options.height = (uint32_t)strtoul(value, NULL, 10);
+        } else if (strcmp(name, "--iterations") == 0) {
+            options.iterations = (uint32_t)strtoul(value, NULL, 10);
+        } else if (strcmp(name, "--warmup") == 0) {
+            options.warmup = (uint32_t)strtoul(value, NULL, 10);
+        } else if (strcmp(name, "--label") == 0) {
+            options.label = value;
+        } else {
+            usage(argv[0]);
+        }
+    }
+
+    if (options.width == 0 || options.height == 0 || options.iterations == 0) {
+        usage(argv[0]);
+    }
+    return options;
+}
+
+static void create_device(BenchContext* ctx) {
+    ctx->instance = create_headless_instance("Dispatch Bench");
+    ctx->physical_device = first_physical_device(ctx->instance);
+    ctx->queue_family = find_graphics_queue_family(ctx->physical_device, NULL);
+    ctx->device = create_swapchain_device(ctx->physical_device, ctx->queue_family, 1);
+    vkGetDeviceQueue(ctx->device, ctx->queue_family, 0, &ctx->queue);
+}
+
+static void create_swapchain(BenchContext* ctx, const BenchOptions* options) {
+    ctx->surface = create_headless_surface(ctx->instance);
+
+    VkSurfaceCapabilitiesKHR capabilities;
+    CHECK_VK_RESULT(vkGetPhysicalDeviceSurfaceCapabilitiesKHR(ctx->physical_device, ctx->surface, &capabilities));
+    uint32_t image_count = capabilities.minImageCount < 3 ? 3 : capabilities.minImageCount;
+    if (capabilities.maxImageCount > 0 && image_count > capabilities.maxImageCount) {
+        image_count = capabilities.maxImageCount;
+    }
+
+    VkSwapchainCreateInfoKHR create_info = {0};
+    create_info.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+    create_info.surface = ctx->surface;
+    create_info.minImageCount = image_count;
+    create_info.imageFormat = VK_FORMAT_B8G8R8A8_UNORM;
+    create_info.imageColorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+    create_info.imageExtent.width = options->width;
+    create_info.imageExtent.height = options->height;
+    create_info.imageArrayLayers = 1;
+    create_info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    create_info.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    create_info.preTransform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR;
+    create_info.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+    create_info.presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+    create_info.clipped = VK_TRUE;
+    CHECK_VK_RESULT(vkCreateSwapchainKHR(ctx->device, &create_info, NULL, &ctx->swapchain));
+
+    VkSemaphoreCreateInfo semaphore_info = {0};
+    semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    CHECK_VK_RESULT(vkCreateSemaphore(ctx->device, &semaphore_info, NULL, &ctx->acquired));
+}
+
+// Times one acquire/present pair; the acquire semaphore is waited on by the
+// present so it is unsignaled again for the next acquire
+static void acquire_present(BenchContext* ctx, uint64_t* acquire_ns, uint64_t* present_ns) {
+    uint32_t image_index;
+    uint64_t start = now_ns();
+    VkResult result = vkAcquireNextImageKHR(ctx->device, ctx->swapchain, UINT64_MAX, ctx->acquired,
+                                            VK_NULL_HANDLE, &image_index);
+    uint64_t acquired = now_ns();
+    CHECK_VK_RESULT(result);
+
+    VkPresentInfoKHR present_info = {0};
+    present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+    present_info.waitSemaphoreCount = 1;
+    present_info.pWaitSemaphores = &ctx->acquired;
+    present_info.swapchainCount = 1;
+    present_info.pSwapchains = &ctx->swapchain;
+    present_info.pImageIndices = &image_index;
+    uint64_t presenting = now_ns();
+    result = vkQueuePresentKHR(ctx->queue, &present_info);
+    uint64_t presented = now_ns();
+    CHECK_VK_RESULT(result);
+
+    *acquire_ns = acquired - start;
+    *present_ns = presented - presenting;
+}
+
+static int compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static uint64_t percentile(const uint64_t* sorted, uint32_t count, double percentile) {
+    return sorted[(uint32_t)((count - 1) * percentile / 100.0)];
+}
+
+// Median cost of reading the clock, included once in every sample
+static uint64_t timer_overhead(void) {
+    uint64_t samples[1001];
+    for (uint32_t i = 0; i < 1001; i++) {
+        uint64_t start = now_ns();
+        samples[i] = now_ns() - start;
+    }
+    qsort(samples, 1001, sizeof(uint64_t), compare_u64);
+    return samples[500];
+}
+
+static void print_call(const char* name, uint64_t* samples, uint32_t count) {
+    double total = 0.0;
+    for (uint32_t i = 0; i < count; i++) {
+        total += (double)samples[i];
+    }
+    qsort(samples, count, sizeof(uint64_t), compare_u64);
+    printf("  %-8s ns  mean %8.1f  p50 %8llu  p90 %8llu  p99 %8llu  max %10llu\n", name,
+           total / count,
+           (unsigned long long)percentile(samples, count, 50.0),
+           (unsigned long long)percentile(samples, count, 90.0),
+           (unsigned long long)percentile(samples, count, 99.0),
+           (unsigned long long)percentile(samples, count, 100.0));
+}
+
+static void run(BenchContext* ctx, const BenchOptions* options) {
+    uint64_t acquire_ns;
+    uint64_t present_ns;
+    for (uint32_t i = 0; i < options->warmup; i++) {
+        acquire_present(ctx, &acquire_ns, &present_ns);
+    }
+
+    uint64_t* acquire_samples = malloc(sizeof(uint64_t) * options->iterations);
+    uint64_t* present_samples = malloc(sizeof(uint64_t) * options->iterations);
+    uint64_t start = now_ns();
+    for (uint32_t i = 0; i < options->iterations; i++) {
+        acquire_present(ctx, &acquire_samples[i], &present_samples[i]);
+    }
+    double total_s = (double)(now_ns() - start) / 1e9;
+
+    printf("%-12s %ux%u %u iterations: %10.0f presents/s  timer %llu ns\n", options->label,
+           options->width, options->height, options->iterations, options->iterations / total_s,
+           (unsigned long long)timer_overhead());
+    print_call("acquire", acquire_samples, options->iterations);
+    print_call("present", present_samples, options->iterations);
+    fflush(stdout);
+
+    free(acquire_samples);
+    free(present_samples);
+}
+
+static void cleanup(BenchContext* ctx) {
+    vkDeviceWaitIdle(ctx->device);
+    vkDestroySemaphore(ctx->device, ctx->acquired, NULL);
+    vkDestroySwapchainKHR(ctx->device, ctx->swapchain, NULL);
+    vkDestroySurfaceKHR(ctx->instance, ctx->surface, NULL);
+    vkDestroyDevice(ctx->device, NULL);
+    vkDestroyInstance(ctx->instance, NULL);
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options = parse_options(argc, argv);
+    BenchContext ctx = {0};
+
+    create_device(&ctx);
+    create_swapchain(&ctx, &options);
+
+    run(&ctx, &options);
+
+    cleanup(&ctx);
+    return 0;
+}
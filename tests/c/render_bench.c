@@ -0,0 +1,757 @@
+#include <vulkan/vulkan.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+
+// End-to-end rendering benchmark
+//
+// Renders a clear, a number of rectangle clears and a field of textured
+// triangles into a headless swapchain for a fixed number of frames, and
+// reports the application-side frame rate and frame time percentiles. Run it
+// through the layer on a software driver (see scripts/bench.sh) to measure
+// what each capture mode costs the application.
+//
+// Frames use the usual WSI synchronization, so the `none` mode is valid on
+// the driver's own swapchain: each frame in flight has an acquire semaphore
+// waited on by its submission, a command buffer and a fence waited on before
+// the frame slot is reused, and each swapchain image has a semaphore the
+// present waits on for rendering to finish. The layer signals the acquire
+// semaphore as soon as it hands out an image and consumes the present's.
+
+#define TEXTURE_SIZE 256
+
+typedef struct {
+    uint32_t width;
+    uint32_t height;
+    uint32_t frames;
+    uint32_t warmup;
+    uint32_t triangles;
+    uint32_t clears;
+    float triangle_size;
+    const char* shader_dir;
+    const char* label;
+} BenchOptions;
+
+typedef struct {
+    VkInstance instance;
+    VkPhysicalDevice physical_device;
+    VkDevice device;
+    uint32_t queue_family;
+    VkQueue queue;
+    VkSurfaceKHR surface;
+    VkSwapchainKHR swapchain;
+    VkFormat format;
+    VkExtent2D extent;
+    uint32_t image_count;
+    VkImage* images;
+    VkImageView* image_views;
+    VkFramebuffer* framebuffers;
+    // Per frame in flight, image_count of them
+    VkCommandBuffer* command_buffers;
+    VkFence* fences;
+    VkSemaphore* acquire_semaphores;
+    // Per swapchain image
+    VkSemaphore* render_semaphores;
+    VkCommandPool command_pool;
+    VkRenderPass render_pass;
+    VkDescriptorSetLayout set_layout;
+    VkDescriptorPool descriptor_pool;
+    VkDescriptorSet descriptor_set;
+    VkPipelineLayout pipeline_layout;
+    VkPipeline pipeline;
+    VkImage texture;
+    VkDeviceMemory texture_memory;
+    VkImageView texture_view;
+    VkSampler sampler;
+} BenchContext;
+
+typedef struct {
+    float time;
+    float size;
+} PushConstants;
+
+static void usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --width N       Swapchain width (default 1920)\n"
+            "  --height N      Swapchain height (default 1080)\n"
+            "  --frames N      Measured frames (default 500)\n"
+            "  --warmup N      Unmeasured frames before that (default 20)\n"
+            "  --triangles N   Textured triangles per frame (default 10000)\n"
+            "  --clears N      Rectangle clears per frame (default 4)\n"
+            "  --size F        Half triangle size in clip space (default 0.02)\n"
+            "  --shaders DIR   Directory with render_bench.{vert,frag}.spv (default shaders)\n"
+            "  --label NAME    Name printed with the results (default render_bench)\n",
+            program);
+    exit(2);
+}
+
+static BenchOptions parse_options(int argc, char** argv) {
+    BenchOptions options = {
+        .width = 1920,
+        .height = 1080,
+        .frames = 500,
+        .warmup = 20,
+        .triangles = 10000,
+        .clears = 4,
+        .triangle_size = 0.02f,
+        .shader_dir = "shaders",
+        .label = "render_bench",
+    };
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+        }
+        const char* name = argv[i];
+        const char* value = argv[++i];
+        if (strcmp(name, "--width") == 0) {
+            options.width = (uint32_t)strtoul(value, NULL, 10);
+        } else if (strcmp(name, "--height") == 0) {
+            options.height = (uint32_t)strtoul(value, NULL, 10);
+        } else if (strcmp(name, "--frames") == 0) {
+            options.frames = (uint32_t)strtoul(value, NULL, 10);
+        } else if (strcmp(name, "--warmup") == 0) {
+            options.warmup = (uint32_t)strtoul(value, NULL, 10);
+        } else if (strcmp(name, "--triangles") == 0) {
+            options.triangles = (uint32_t)strtoul(value, NULL, 10);
+        } else if (strcmp(name, "--clears") == 0) {
+            options.clears = (uint32_t)strtoul(value, NULL, 10);
+        } else if (strcmp(name, "--size") == 0) {
+            options.triangle_size = strtof(value, NULL);
+        } else if (strcmp(name, "--shaders") == 0) {
+            options.shader_dir = value;
+        } else if (strcmp(name, "--label") == 0) {
+            options.label = value;
+        } else {
+            usage(argv[0]);
+        }
+    }
+
+    if (options.width == 0 || options.height == 0 || options.frames == 0) {
+        usage(argv[0]);
+    }
+    return options;
+}
+
+// The layer is enabled through VK_INSTANCE_LAYERS, so the same binary
+// measures the driver's own headless WSI when it is not
+static void create_device(BenchContext* ctx) {
+    ctx->instance = create_headless_instance("Render Bench");
+    ctx->physical_device = first_physical_device(ctx->instance);
+    ctx->queue_family = find_graphics_queue_family(ctx->physical_device, NULL);
+    ctx->device = create_swapchain_device(ctx->physical_device, ctx->queue_family, 1);
+    vkGetDeviceQueue(ctx->device, ctx->queue_family, 0, &ctx->queue);
+
+    VkCommandPoolCreateInfo pool_info = {0};
+    pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    pool_info.queueFamilyIndex = ctx->queue_family;
+    CHECK_VK_RESULT(vkCreateCommandPool(ctx->device, &pool_info, NULL, &ctx->command_pool));
+}
+
+static void create_swapchain(BenchContext* ctx, const BenchOptions* options) {
+    ctx->surface = create_headless_surface(ctx->instance);
+
+    VkSurfaceCapabilitiesKHR capabilities;
+    CHECK_VK_RESULT(vkGetPhysicalDeviceSurfaceCapabilitiesKHR(ctx->physical_device, ctx->surface, &capabilities));
+
+    uint32_t format_count = 0;
+    vkGetPhysicalDeviceSurfaceFormatsKHR(ctx->physical_device, ctx->surface, &format_count, NULL);
+    VkSurfaceFormatKHR* formats = malloc(sizeof(VkSurfaceFormatKHR) * format_count);
+    vkGetPhysicalDeviceSurfaceFormatsKHR(ctx->physical_device, ctx->surface, &format_count, formats);
+    VkSurfaceFormatKHR surface_format = formats[0];
+    for (uint32_t i = 0; i < format_count; i++) {
+        if (formats[i].format == VK_FORMAT_B8G8R8A8_UNORM) {
+            surface_format = formats[i];
+            break;
+        }
+    }
+    free(formats);
+
+    // Immediate if available, so the frame rate is not capped by pacing
+    uint32_t mode_count = 0;
+    vkGetPhysicalDeviceSurfacePresentModesKHR(ctx->physical_device, ctx->surface, &mode_count, NULL);
+    VkPresentModeKHR* modes = malloc(sizeof(VkPresentModeKHR) * mode_count);
+    vkGetPhysicalDeviceSurfacePresentModesKHR(ctx->physical_device, ctx->surface, &mode_count, modes);
+    VkPresentModeKHR present_mode = VK_PRESENT_MODE_FIFO_KHR;
+    for (uint32_t i = 0; i < mode_count; i++) {
+        if (modes[i] == VK_PRESENT_MODE_IMMEDIATE_KHR) {
+            present_mode = modes[i];
+        }
+    }
+    free(modes);
+
+    uint32_t image_count = capabilities.minImageCount < 3 ? 3 : capabilities.minImageCount;
+    if (capabilities.maxImageCount > 0 && image_count > capabilities.maxImageCount) {
+        image_count = capabilities.maxImageCount;
+    }
+
+    ctx->format = surface_format.format;
+    ctx->extent.width = options->width;
+    ctx->extent.height = options->height;
+
+    VkSwapchainCreateInfoKHR create_info = {0};
+    create_info.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+    create_info.surface = ctx->surface;
+    create_info.minImageCount = image_count;
+    create_info.imageFormat = surface_format.format;
+    create_info.imageColorSpace = surface_format.colorSpace;
+    create_info.imageExtent = ctx->extent;
+    create_info.imageArrayLayers = 1;
+    create_info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    create_info.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    create_info.preTransform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR;
+    create_info.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+    create_info.presentMode = present_mode;
+    create_info.clipped = VK_TRUE;
+    CHECK_VK_RESULT(vkCreateSwapchainKHR(ctx->device, &create_info, NULL, &ctx->swapchain));
+
+    vkGetSwapchainImagesKHR(ctx->device, ctx->swapchain, &ctx->image_count, NULL);
+    ctx->images = malloc(sizeof(VkImage) * ctx->image_count);
+    vkGetSwapchainImagesKHR(ctx->device, ctx->swapchain, &ctx->image_count, ctx->images);
+}
+
+static uint32_t find_memory_type(BenchContext* ctx, uint32_t type_bits, VkMemoryPropertyFlags flags) {
+    VkPhysicalDeviceMemoryProperties properties;
+    vkGetPhysicalDeviceMemoryProperties(ctx->physical_device, &properties);
+    for (uint32_t i = 0; i < properties.memoryTypeCount; i++) {
+        if ((type_bits & (1u << i)) && (properties.memoryTypes[i].propertyFlags & flags) == flags) {
+            return i;
+        }
+    }
+    fprintf(stderr, "No suitable memory type\n");
+    exit(1);
+}
+
+static VkImageView create_image_view(BenchContext* ctx, VkImage image, VkFormat format) {
+    VkImageViewCreateInfo view_info = {0};
+    view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    view_info.image = image;
+    view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    view_info.format = format;
+    view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    view_info.subresourceRange.levelCount = 1;
+    view_info.subresourceRange.layerCount = 1;
+
+    VkImageView view;
+    CHECK_VK_RESULT(vkCreateImageView(ctx->device, &view_info, NULL, &view));
+    return view;
+}
+
+static void transition_texture(VkCommandBuffer cmd, VkImage image, VkImageLayout old_layout,
+                               VkImageLayout new_layout, VkAccessFlags src_access, VkAccessFlags dst_access,
+                               VkPipelineStageFlags src_stage, VkPipelineStageFlags dst_stage) {
+    VkImageMemoryBarrier barrier = {0};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = src_access;
+    barrier.dstAccessMask = dst_access;
+    barrier.oldLayout = old_layout;
+    barrier.newLayout = new_layout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.layerCount = 1;
+    vkCmdPipelineBarrier(cmd, src_stage, dst_stage, 0, 0, NULL, 0, NULL, 1, &barrier);
+}
+
+// Checkerboard texture, uploaded once through a staging buffer
+static void create_texture(BenchContext* ctx) {
+    VkImageCreateInfo image_info = {0};
+    image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    image_info.imageType = VK_IMAGE_TYPE_2D;
+    image_info.format = VK_FORMAT_R8G8B8A8_UNORM;
+    image_info.extent.width = TEXTURE_SIZE;
+    image_info.extent.height = TEXTURE_SIZE;
+    image_info.extent.depth = 1;
+    image_info.mipLevels = 1;
+    image_info.arrayLayers = 1;
+    image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+    image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    image_info.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    CHECK_VK_RESULT(vkCreateImage(ctx->device, &image_info, NULL, &ctx->texture));
+
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(ctx->device, ctx->texture, &requirements);
+    VkMemoryAllocateInfo alloc_info = {0};
+    alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    alloc_info.allocationSize = requirements.size;
+    alloc_info.memoryTypeIndex = find_memory_type(ctx, requirements.memoryTypeBits, 0);
+    CHECK_VK_RESULT(vkAllocateMemory(ctx->device, &alloc_info, NULL, &ctx->texture_memory));
+    CHECK_VK_RESULT(vkBindImageMemory(ctx->device, ctx->texture, ctx->texture_memory, 0));
+
+    VkDeviceSize texture_bytes = TEXTURE_SIZE * TEXTURE_SIZE * 4;
+    VkBufferCreateInfo buffer_info = {0};
+    buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    buffer_info.size = texture_bytes;
+    buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    VkBuffer staging;
+    CHECK_VK_RESULT(vkCreateBuffer(ctx->device, &buffer_info, NULL, &staging));
+
+    vkGetBufferMemoryRequirements(ctx->device, staging, &requirements);
+    alloc_info.allocationSize = requirements.size;
+    alloc_info.memoryTypeIndex = find_memory_type(ctx, requirements.memoryTypeBits,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    VkDeviceMemory staging_memory;
+    CHECK_VK_RESULT(vkAllocateMemory(ctx->device, &alloc_info, NULL, &staging_memory));
+    CHECK_VK_RESULT(vkBindBufferMemory(ctx->device, staging, staging_memory, 0));
+
+    uint8_t* texels;
+    CHECK_VK_RESULT(vkMapMemory(ctx->device, staging_memory, 0, texture_bytes, 0, (void**)&texels));
+    for (uint32_t y = 0; y < TEXTURE_SIZE; y++) {
+        for (uint32_t x = 0; x < TEXTURE_SIZE; x++) {
+            uint8_t* texel = texels + (y * TEXTURE_SIZE + x) * 4;
+            int light = ((x / 32) + (y / 32)) % 2;
+            texel[0] = light ? 240 : (uint8_t)x;
+            texel[1] = light ? 200 : (uint8_t)y;
+            texel[2] = light ? 64 : 160;
+            texel[3] = 255;
+        }
+    }
+    vkUnmapMemory(ctx->device, staging_memory);
+
+    VkCommandBufferAllocateInfo cmd_info = {0};
+    cmd_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    cmd_info.commandPool = ctx->command_pool;
+    cmd_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    cmd_info.commandBufferCount = 1;
+    VkCommandBuffer cmd;
+    CHECK_VK_RESULT(vkAllocateCommandBuffers(ctx->device, &cmd_info, &cmd));
+
+    VkCommandBufferBeginInfo begin_info = {0};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    CHECK_VK_RESULT(vkBeginCommandBuffer(cmd, &begin_info));
+    transition_texture(cmd, ctx->texture, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                       0, VK_ACCESS_TRANSFER_WRITE_BIT,
+                       VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    VkBufferImageCopy region = {0};
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent = image_info.extent;
+    vkCmdCopyBufferToImage(cmd, staging, ctx->texture, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    transition_texture(cmd, ctx->texture, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                       VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                       VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+    CHECK_VK_RESULT(vkEndCommandBuffer(cmd));
+
+    VkSubmitInfo submit_info = {0};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &cmd;
+    CHECK_VK_RESULT(vkQueueSubmit(ctx->queue, 1, &submit_info, VK_NULL_HANDLE));
+    CHECK_VK_RESULT(vkQueueWaitIdle(ctx->queue));
+
+    vkFreeCommandBuffers(ctx->device, ctx->command_pool, 1, &cmd);
+    vkDestroyBuffer(ctx->device, staging, NULL);
+    vkFreeMemory(ctx->device, staging_memory, NULL);
+
+    ctx->texture_view = create_image_view(ctx, ctx->texture, VK_FORMAT_R8G8B8A8_UNORM);
+
+    VkSamplerCreateInfo sampler_info = {0};
+    sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    sampler_info.magFilter = VK_FILTER_LINEAR;
+    sampler_info.minFilter = VK_FILTER_LINEAR;
+    sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    sampler_info.maxLod = 0.0f;
+    CHECK_VK_RESULT(vkCreateSampler(ctx->device, &sampler_info, NULL, &ctx->sampler));
+}
+
+static void create_descriptors(BenchContext* ctx) {
+    VkDescriptorSetLayoutBinding binding = {0};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    binding.descriptorCount = 1;
+    binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layout_info = {0};
+    layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layout_info.bindingCount = 1;
+    layout_info.pBindings = &binding;
+    CHECK_VK_RESULT(vkCreateDescriptorSetLayout(ctx->device, &layout_info, NULL, &ctx->set_layout));
+
+    VkDescriptorPoolSize pool_size = {0};
+    pool_size.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    pool_size.descriptorCount = 1;
+    VkDescriptorPoolCreateInfo pool_info = {0};
+    pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    pool_info.maxSets = 1;
+    pool_info.poolSizeCount = 1;
+    pool_info.pPoolSizes = &pool_size;
+    CHECK_VK_RESULT(vkCreateDescriptorPool(ctx->device, &pool_info, NULL, &ctx->descriptor_pool));
+
+    VkDescriptorSetAllocateInfo alloc_info = {0};
+    alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    alloc_info.descriptorPool = ctx->descriptor_pool;
+    alloc_info.descriptorSetCount = 1;
+    alloc_info.pSetLayouts = &ctx->set_layout;
+    CHECK_VK_RESULT(vkAllocateDescriptorSets(ctx->device, &alloc_info, &ctx->descriptor_set));
+
+    VkDescriptorImageInfo image_info = {0};
+    image_info.sampler = ctx->sampler;
+    image_info.imageView = ctx->texture_view;
+    image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    VkWriteDescriptorSet write = {0};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = ctx->descriptor_set;
+    write.dstBinding = 0;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write.pImageInfo = &image_info;
+    vkUpdateDescriptorSets(ctx->device, 1, &write, 0, NULL);
+}
+
+static VkShaderModule load_shader(BenchContext* ctx, const char* dir, const char* name) {
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "Cannot open shader %s\n", path);
+        exit(1);
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint32_t* code = malloc((size_t)size);
+    if (size <= 0 || size % 4 != 0 || fread(code, 1, (size_t)size, file) != (size_t)size) {
+        fprintf(stderr, "Invalid shader %s\n", path);
+        exit(1);
+    }
+    fclose(file);
+
+    VkShaderModuleCreateInfo module_info = {0};
+    module_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    module_info.codeSize = (size_t)size;
+    module_info.pCode = code;
+    VkShaderModule module;
+    CHECK_VK_RESULT(vkCreateShaderModule(ctx->device, &module_info, NULL, &module));
+    free(code);
+    return module;
+}
+
+static void create_pipeline(BenchContext* ctx, const BenchOptions* options) {
+    VkAttachmentDescription attachment = {0};
+    attachment.format = ctx->format;
+    attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+    VkAttachmentReference colour_ref = {0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+    VkSubpassDescription subpass = {0};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &colour_ref;
+
+    VkRenderPassCreateInfo render_pass_info = {0};
+    render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    render_pass_info.attachmentCount = 1;
+    render_pass_info.pAttachments = &attachment;
+    render_pass_info.subpassCount = 1;
+    render_pass_info.pSubpasses = &subpass;
+    CHECK_VK_RESULT(vkCreateRenderPass(ctx->device, &render_pass_info, NULL, &ctx->render_pass));
+
+    VkPushConstantRange push_range = {0};
+    push_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    push_range.size = sizeof(PushConstants);
+    VkPipelineLayoutCreateInfo layout_info = {0};
+    layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layout_info.setLayoutCount = 1;
+    layout_info.pSetLayouts = &ctx->set_layout;
+    layout_info.pushConstantRangeCount = 1;
+    layout_info.pPushConstantRanges = &push_range;
+    CHECK_VK_RESULT(vkCreatePipelineLayout(ctx->device, &layout_info, NULL, &ctx->pipeline_layout));
+
+    VkShaderModule vertex = load_shader(ctx, options->shader_dir, "render_bench.vert.spv");
+    VkShaderModule fragment = load_shader(ctx, options->shader_dir, "render_bench.frag.spv");
+    VkPipelineShaderStageCreateInfo stages[2] = {{0}, {0}};
+    stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    stages[0].module = vertex;
+    stages[0].pName = "main";
+    stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    stages[1].module = fragment;
+    stages[1].pName = "main";
+
+    VkPipelineVertexInputStateCreateInfo vertex_input = {0};
+    vertex_input.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    VkPipelineInputAssemblyStateCreateInfo input_assembly = {0};
+    input_assembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    input_assembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+    VkViewport viewport = {0.0f, 0.0f, (float)ctx->extent.width, (float)ctx->extent.height, 0.0f, 1.0f};
+    VkRect2D scissor = {{0, 0}, ctx->extent};
+    VkPipelineViewportStateCreateInfo viewport_state = {0};
+    viewport_state.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewport_state.viewportCount = 1;
+    viewport_state.pViewports = &viewport;
+    viewport_state.scissorCount = 1;
+    viewport_state.pScissors = &scissor;
+
+    VkPipelineRasterizationStateCreateInfo rasterization = {0};
+    rasterization.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterization.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterization.cullMode = VK_CULL_MODE_NONE;
+    rasterization.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    rasterization.lineWidth = 1.0f;
+
+    VkPipelineMultisampleStateCreateInfo multisample = {0};
+    multisample.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisample.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkPipelineColorBlendAttachmentState blend_attachment = {0};
+    blend_attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+                                      VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    VkPipelineColorBlendStateCreateInfo blend = {0};
+    blend.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    blend.attachmentCount = 1;
+    blend.pAttachments = &blend_attachment;
+
+    VkGraphicsPipelineCreateInfo pipeline_info = {0};
+    pipeline_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipeline_info.stageCount = 2;
+    pipeline_info.pStages = stages;
+    pipeline_info.pVertexInputState = &vertex_input;
+    pipeline_info.pInputAssemblyState = &input_assembly;
+    pipeline_info.pViewportState = &viewport_state;
+    pipeline_info.pRasterizationState = &rasterization;
+    pipeline_info.pMultisampleState = &multisample;
+    pipeline_info.pColorBlendState = &blend;
+    pipeline_info.layout = ctx->pipeline_layout;
+    pipeline_info.renderPass = ctx->render_pass;
+    CHECK_VK_RESULT(vkCreateGraphicsPipelines(ctx->device, VK_NULL_HANDLE, 1, &pipeline_info, NULL, &ctx->pipeline));
+
+    vkDestroyShaderModule(ctx->device, vertex, NULL);
+    vkDestroyShaderModule(ctx->device, fragment, NULL);
+}
+
+static void create_frame_resources(BenchContext* ctx) {
+    ctx->image_views = malloc(sizeof(VkImageView) * ctx->image_count);
+    ctx->framebuffers = malloc(sizeof(VkFramebuffer) * ctx->image_count);
+    ctx->command_buffers = malloc(sizeof(VkCommandBuffer) * ctx->image_count);
+    ctx->fences = malloc(sizeof(VkFence) * ctx->image_count);
+    ctx->acquire_semaphores = malloc(sizeof(VkSemaphore) * ctx->image_count);
+    ctx->render_semaphores = malloc(sizeof(VkSemaphore) * ctx->image_count);
+
+    VkCommandBufferAllocateInfo cmd_info = {0};
+    cmd_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    cmd_info.commandPool = ctx->command_pool;
+    cmd_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    cmd_info.commandBufferCount = ctx->image_count;
+    CHECK_VK_RESULT(vkAllocateCommandBuffers(ctx->device, &cmd_info, ctx->command_buffers));
+
+    for (uint32_t i = 0; i < ctx->image_count; i++) {
+        ctx->image_views[i] = create_image_view(ctx, ctx->images[i], ctx->format);
+
+        VkFramebufferCreateInfo framebuffer_info = {0};
+        framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebuffer_info.renderPass = ctx->render_pass;
+        framebuffer_info.attachmentCount = 1;
+        framebuffer_info.pAttachments = &ctx->image_views[i];
+        framebuffer_info.width = ctx->extent.width;
+        framebuffer_info.height = ctx->extent.height;
+        framebuffer_info.layers = 1;
+        CHECK_VK_RESULT(vkCreateFramebuffer(ctx->device, &framebuffer_info, NULL, &ctx->framebuffers[i]));
+
+        VkFenceCreateInfo fence_info = {0};
+        fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+        CHECK_VK_RESULT(vkCreateFence(ctx->device, &fence_info, NULL, &ctx->fences[i]));
+
+        VkSemaphoreCreateInfo semaphore_info = {0};
+        semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        CHECK_VK_RESULT(vkCreateSemaphore(ctx->device, &semaphore_info, NULL, &ctx->acquire_semaphores[i]));
+        CHECK_VK_RESULT(vkCreateSemaphore(ctx->device, &semaphore_info, NULL, &ctx->render_semaphores[i]));
+    }
+}
+
+static void record_frame(BenchContext* ctx, const BenchOptions* options, VkCommandBuffer cmd,
+                         uint32_t image_index, uint32_t frame) {
+    VkCommandBufferBeginInfo begin_info = {0};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    CHECK_VK_RESULT(vkBeginCommandBuffer(cmd, &begin_info));
+
+    VkClearValue clear_value;
+    clear_value.color.float32[0] = 0.1f;
+    clear_value.color.float32[1] = 0.1f;
+    clear_value.color.float32[2] = (float)(frame % 64) / 64.0f;
+    clear_value.color.float32[3] = 1.0f;
+    VkRenderPassBeginInfo pass_info = {0};
+    pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    pass_info.renderPass = ctx->render_pass;
+    pass_info.framebuffer = ctx->framebuffers[image_index];
+    pass_info.renderArea.extent = ctx->extent;
+    pass_info.clearValueCount = 1;
+    pass_info.pClearValues = &clear_value;
+    vkCmdBeginRenderPass(cmd, &pass_info, VK_SUBPASS_CONTENTS_INLINE);
+
+    // Quarter-size rectangles walking across the frame
+    for (uint32_t i = 0; i < options->clears; i++) {
+        VkClearAttachment clear = {0};
+        clear.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        clear.colorAttachment = 0;
+        clear.clearValue.color.float32[0] = (float)(i % 4) / 4.0f;
+        clear.clearValue.color.float32[1] = 0.5f;
+        clear.clearValue.color.float32[2] = 0.2f;
+        clear.clearValue.color.float32[3] = 1.0f;
+        VkClearRect rect = {0};
+        rect.rect.extent.width = ctx->extent.width / 2;
+        rect.rect.extent.height = ctx->extent.height / 2;
+        rect.rect.offset.x = (int32_t)((frame * 7 + i * 97) % (ctx->extent.width - rect.rect.extent.width + 1));
+        rect.rect.offset.y = (int32_t)((frame * 3 + i * 61) % (ctx->extent.height - rect.rect.extent.height + 1));
+        rect.layerCount = 1;
+        vkCmdClearAttachments(cmd, 1, &clear, 1, &rect);
+    }
+
+    PushConstants constants = {(float)frame * 0.002f, options->triangle_size};
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->pipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->pipeline_layout, 0, 1,
+                            &ctx->descriptor_set, 0, NULL);
+    vkCmdPushConstants(cmd, ctx->pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(constants), &constants);
+    vkCmdDraw(cmd, options->triangles * 3, 1, 0, 0);
+
+    vkCmdEndRenderPass(cmd);
+    CHECK_VK_RESULT(vkEndCommandBuffer(cmd));
+}
+
+static void render_frame(BenchContext* ctx, const BenchOptions* options, uint32_t frame) {
+    // The slot's previous submission has finished with its semaphore and
+    // command buffer once its fence is signaled
+    uint32_t slot = frame % ctx->image_count;
+    CHECK_VK_RESULT(vkWaitForFences(ctx->device, 1, &ctx->fences[slot], VK_TRUE, UINT64_MAX));
+    CHECK_VK_RESULT(vkResetFences(ctx->device, 1, &ctx->fences[slot]));
+
+    uint32_t image_index;
+    CHECK_VK_RESULT(vkAcquireNextImageKHR(ctx->device, ctx->swapchain, UINT64_MAX,
+                                          ctx->acquire_semaphores[slot], VK_NULL_HANDLE, &image_index));
+    record_frame(ctx, options, ctx->command_buffers[slot], image_index, frame);
+
+    VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    VkSubmitInfo submit_info = {0};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.waitSemaphoreCount = 1;
+    submit_info.pWaitSemaphores = &ctx->acquire_semaphores[slot];
+    submit_info.pWaitDstStageMask = &wait_stage;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &ctx->command_buffers[slot];
+    submit_info.signalSemaphoreCount = 1;
+    submit_info.pSignalSemaphores = &ctx->render_semaphores[image_index];
+    CHECK_VK_RESULT(vkQueueSubmit(ctx->queue, 1, &submit_info, ctx->fences[slot]));
+
+    VkPresentInfoKHR present_info = {0};
+    present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+    present_info.waitSemaphoreCount = 1;
+    present_info.pWaitSemaphores = &ctx->render_semaphores[image_index];
+    present_info.swapchainCount = 1;
+    present_info.pSwapchains = &ctx->swapchain;
+    present_info.pImageIndices = &image_index;
+    CHECK_VK_RESULT(vkQueuePresentKHR(ctx->queue, &present_info));
+}
+
+static int compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile_ms(const uint64_t* sorted, uint32_t count, double percentile) {
+    uint32_t index = (uint32_t)((count - 1) * percentile / 100.0);
+    return (double)sorted[index] / 1e6;
+}
+
+static void run(BenchContext* ctx, const BenchOptions* options) {
+    for (uint32_t frame = 0; frame < options->warmup; frame++) {
+        render_frame(ctx, options, frame);
+    }
+
+    uint64_t* frame_ns = malloc(sizeof(uint64_t) * options->frames);
+    uint64_t start = now_ns();
+    uint64_t last = start;
+    for (uint32_t i = 0; i < options->frames; i++) {
+        render_frame(ctx, options, options->warmup + i);
+        uint64_t now = now_ns();
+        frame_ns[i] = now - last;
+        last = now;
+    }
+    // Frames still in flight count towards the total
+    CHECK_VK_RESULT(vkDeviceWaitIdle(ctx->device));
+    double total_s = (double)(now_ns() - start) / 1e9;
+
+    qsort(frame_ns, options->frames, sizeof(uint64_t), compare_u64);
+    printf("%-12s %ux%u %u frames %u triangles %u clears: %8.1f fps  frame ms p50 %7.3f  p90 %7.3f  "
+           "p99 %7.3f  max %7.3f\n",
+           options->label, ctx->extent.width, ctx->extent.height, options->frames, options->triangles,
+           options->clears, options->frames / total_s,
+           percentile_ms(frame_ns, options->frames, 50.0),
+           percentile_ms(frame_ns, options->frames, 90.0),
+           percentile_ms(frame_ns, options->frames, 99.0),
+           percentile_ms(frame_ns, options->frames, 100.0));
+    fflush(stdout);
+    free(frame_ns);
+}
+
+static void cleanup(BenchContext* ctx) {
+    vkDeviceWaitIdle(ctx->device);
+    for (uint32_t i = 0; i < ctx->image_count; i++) {
+        vkDestroyFence(ctx->device, ctx->fences[i], NULL);
+        vkDestroySemaphore(ctx->device, ctx->acquire_semaphores[i], NULL);
+        vkDestroySemaphore(ctx->device, ctx->render_semaphores[i], NULL);
+        vkDestroyFramebuffer(ctx->device, ctx->framebuffers[i], NULL);
+        vkDestroyImageView(ctx->device, ctx->image_views[i], NULL);
+    }
+    free(ctx->fences);
+    free(ctx->acquire_semaphores);
+    free(ctx->render_semaphores);
+    free(ctx->framebuffers);
+    free(ctx->image_views);
+    free(ctx->command_buffers);
+    free(ctx->images);
+
+    vkDestroyPipeline(ctx->device, ctx->pipeline, NULL);
+    vkDestroyPipelineLayout(ctx->device, ctx->pipeline_layout, NULL);
+    vkDestroyRenderPass(ctx->device, ctx->render_pass, NULL);
+    vkDestroyDescriptorPool(ctx->device, ctx->descriptor_pool, NULL);
+    vkDestroyDescriptorSetLayout(ctx->device, ctx->set_layout, NULL);
+    vkDestroySampler(ctx->device, ctx->sampler, NULL);
+    vkDestroyImageView(ctx->device, ctx->texture_view, NULL);
+    vkDestroyImage(ctx->device, ctx->texture, NULL);
+    vkFreeMemory(ctx->device, ctx->texture_memory, NULL);
+    vkDestroyCommandPool(ctx->device, ctx->command_pool, NULL);
+    vkDestroySwapchainKHR(ctx->device, ctx->swapchain, NULL);
+    vkDestroySurfaceKHR(ctx->instance, ctx->surface, NULL);
+    vkDestroyDevice(ctx->device, NULL);
+    vkDestroyInstance(ctx->instance, NULL);
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options = parse_options(argc, argv);
+    BenchContext ctx = {0};
+
+    create_device(&ctx);
+    create_swapchain(&ctx, &options);
+    create_texture(&ctx);
+    create_descriptors(&ctx);
+    create_pipeline(&ctx, &options);
+    create_frame_resources(&ctx);
+
+    run(&ctx, &options);
+
+    cleanup(&ctx);
+    return 0;
+}
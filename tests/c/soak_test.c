@@ -0,0 +1,335 @@
+#include <vulkan/vulkan.h>
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../icd/null_icd.h"
+#include "common.h"
+
+// Swapchain soak test
+//
+// Creates, resizes, presents to and destroys swapchains for thousands of
+// iterations and checks that nothing grows. Each iteration creates a
+// swapchain, replaces it with a differently sized one through
+// oldSwapchain a few times, presents on each, and destroys the last, so
+// the process should look the same between iterations. Process RSS is
+// checked against a slack, and on the null driver (tests/icd) so are its
+// live memory and object counts, which must return exactly to where they
+// were after warmup. Exits with 1 on growth; see scripts/soak.sh.
+
+static const VkExtent2D sizes[] = {
+    { 640, 360 },
+    { 800, 450 },
+    { 1024, 576 },
+    { 1280, 720 },
+    { 1920, 1080 },
+};
+
+#define SIZE_COUNT (sizeof(sizes) / sizeof(sizes[0]))
+
+typedef struct {
+    uint32_t iterations;
+    uint32_t warmup;
+    uint32_t resizes;
+    uint32_t frames;
+    uint32_t sample_every;
+    uint64_t rss_slack_kb;
+    const char* icd_library;
+} SoakOptions;
+
+typedef struct {
+    VkInstance instance;
+    VkPhysicalDevice physical_device;
+    VkDevice device;
+    uint32_t queue_family;
+    VkQueue queue;
+    VkSurfaceKHR surface;
+    VkSemaphore acquired;
+    PFN_nullIcdGetStats get_stats;
+} SoakContext;
+
+typedef struct {
+    uint64_t rss_kb;
+    int has_driver;
+    NullIcdStats driver;
+} SoakSample;
+
+static void usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --iterations N    Measured iterations (default 2000)\n"
+            "  --warmup N        Iterations before the baseline is taken (default 20)\n"
+            "  --resizes N       Swapchains created per iteration (default 3)\n"
+            "  --frames N        Presents per swapchain (default 3)\n"
+            "  --sample-every N  Iterations between checks (default 200)\n"
+            "  --rss-slack KB    Allowed RSS growth (default 4096)\n"
+            "  --icd-library P   Null driver library to read counters from\n"
+            "                    (default: next to the manifest in VK_DRIVER_FILES)\n",
+            program);
+    exit(2);
+}
+
+static SoakOptions parse_options(int argc, char** argv) {
+    SoakOptions options = {
+        .iterations = 2000,
+        .warmup = 20,
+        .resizes = 3,
+        .frames = 3,
+        .sample_every = 200,
+        .rss_slack_kb = 4096,
+        .icd_library = NULL,
+    };
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+        }
+        const char* name = argv[i];
+        const char* value = argv[++i];
+        if (strcmp(name, "--iterations") == 0) {
+            options.iterations = (uint32_t)strtoul(value, NULL, 10);
+        } else if (strcmp(name, "--warmup") == 0) {
+            options.warmup = (uint32_t)strtoul(value, NULL, 10);
+        } else if (strcmp(name, "--resizes") == 0) {
+            options.resizes = (uint32_t)strtoul(value, NULL, 10);
+        } else if (strcmp(name, "--frames") == 0) {
+            options.frames = (uint32_t)strtoul(value, NULL, 10);
+        } else if (strcmp(name, "--sample-every") == 0) {
+            options.sample_every = (uint32_t)strtoul(value, NULL, 10);
+        } else if (strcmp(name, "--rss-slack") == 0) {
+            options.rss_slack_kb = strtoull(value, NULL, 10);
+        } else if (strcmp(name, "--icd-library") == 0) {
+            options.icd_library = value;
+        } else {
+            usage(argv[0]);
+        }
+    }
+
+    if (options.iterations == 0 || options.resizes == 0 || options.sample_every == 0) {
+        usage(argv[0]);
+    }
+    return options;
+}
+
+// The loader already has the library open; RTLD_NOLOAD only finds it
+static PFN_nullIcdGetStats find_driver_stats(const SoakOptions* options) {
+    char path[4096];
+    if (options->icd_library) {
+        snprintf(path, sizeof(path), "%s", options->icd_library);
+    } else {
+        const char* manifest = getenv("VK_DRIVER_FILES");
+        if (!manifest) {
+            manifest = getenv("VK_ICD_FILENAMES");
+        }
+        if (!manifest) {
+            return NULL;
+        }
+        snprintf(path, sizeof(path), "%s", manifest);
+        // First manifest of a list, library next to it
+        char* separator = strchr(path, ':');
+        if (separator) {
+            *separator = '\0';
+        }
+        char* slash = strrchr(path, '/');
+        size_t dir_length = slash ? (size_t)(slash - path + 1) : 0;
+        snprintf(path + dir_length, sizeof(path) - dir_length, "libVkICD_unseen_null.so");
+    }
+
+    void* library = dlopen(path, RTLD_NOW | RTLD_NOLOAD);
+    if (!library) {
+        return NULL;
+    }
+    return (PFN_nullIcdGetStats)dlsym(library, NULL_ICD_GET_STATS);
+}
+
+static uint64_t rss_kb(void) {
+    unsigned long size = 0;
+    unsigned long resident = 0;
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if (statm) {
+        if (fscanf(statm, "%lu %lu", &size, &resident) != 2) {
+            resident = 0;
+        }
+        fclose(statm);
+    }
+    return (uint64_t)resident * (uint64_t)sysconf(_SC_PAGESIZE) / 1024;
+}
+
+static SoakSample sample(const SoakContext* ctx) {
+    SoakSample result = {0};
+    result.rss_kb = rss_kb();
+    if (ctx->get_stats) {
+        result.has_driver = 1;
+        ctx->get_stats(&result.driver);
+    }
+    return result;
+}
+
+static void print_sample(uint32_t iteration, const SoakSample* s) {
+    printf("%8u  rss %8llu KiB", iteration, (unsigned long long)s->rss_kb);
+    if (s->has_driver) {
+        printf("  memory %10llu B in %4llu  images %4llu  buffers %4llu  command buffers %4llu"
+               "  fences %4llu  objects %4llu",
+               (unsigned long long)s->driver.memory_bytes,
+               (unsigned long long)s->driver.memory_allocations,
+               (unsigned long long)s->driver.images,
+               (unsigned long long)s->driver.buffers,
+               (unsigned long long)s->driver.command_buffers,
+               (unsigned long long)s->driver.fences,
+               (unsigned long long)s->driver.other_objects);
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+// Reports every counter above its baseline; returns the number of them
+static int check_growth(const SoakSample* baseline, const SoakSample* s, const SoakOptions* options) {
+    int grown = 0;
+    if (s->rss_kb > baseline->rss_kb + options->rss_slack_kb) {
+        printf("  RSS grew by %llu KiB\n", (unsigned long long)(s->rss_kb - baseline->rss_kb));
+        grown++;
+    }
+    if (!s->has_driver) {
+        return grown;
+    }
+
+    const struct {
+        const char* name;
+        uint64_t before;
+        uint64_t after;
+    } counters[] = {
+        { "devices", baseline->driver.devices, s->driver.devices },
+        { "memory allocations", baseline->driver.memory_allocations, s->driver.memory_allocations },
+        { "memory bytes", baseline->driver.memory_bytes, s->driver.memory_bytes },
+        { "images", baseline->driver.images, s->driver.images },
+        { "buffers", baseline->driver.buffers, s->driver.buffers },
+        { "command buffers", baseline->driver.command_buffers, s->driver.command_buffers },
+        { "fences", baseline->driver.fences, s->driver.fences },
+        { "objects", baseline->driver.other_objects, s->driver.other_objects },
+    };
+    for (size_t i = 0; i < sizeof(counters) / sizeof(counters[0]); i++) {
+        if (counters[i].after > counters[i].before) {
+            printf("  %s grew from %llu to %llu\n", counters[i].name,
+                   (unsigned long long)counters[i].before, (unsigned long long)counters[i].after);
+            grown++;
+        }
+    }
+    return grown;
+}
+
+static void create_context(SoakContext* ctx) {
+    ctx->instance = create_headless_instance("Soak Test");
+    ctx->physical_device = first_physical_device(ctx->instance);
+    ctx->queue_family = find_graphics_queue_family(ctx->physical_device, NULL);
+    ctx->device = create_swapchain_device(ctx->physical_device, ctx->queue_family, 1);
+    vkGetDeviceQueue(ctx->device, ctx->queue_family, 0, &ctx->queue);
+    ctx->surface = create_headless_surface(ctx->instance);
+
+    VkSemaphoreCreateInfo semaphore_info = {0};
+    semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    CHECK_VK_RESULT(vkCreateSemaphore(ctx->device, &semaphore_info, NULL, &ctx->acquired));
+}
+
+static VkSwapchainKHR create_swapchain(SoakContext* ctx, VkExtent2D extent, VkSwapchainKHR old_swapchain) {
+    VkSwapchainCreateInfoKHR create_info = {0};
+    create_info.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+    create_info.surface = ctx->surface;
+    create_info.minImageCount = 3;
+    create_info.imageFormat = VK_FORMAT_B8G8R8A8_UNORM;
+    create_info.imageColorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+    create_info.imageExtent = extent;
+    create_info.imageArrayLayers = 1;
+    create_info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    create_info.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    create_info.preTransform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR;
+    create_info.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+    create_info.presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    create_info.clipped = VK_TRUE;
+    create_info.oldSwapchain = old_swapchain;
+
+    VkSwapchainKHR swapchain;
+    CHECK_VK_RESULT(vkCreateSwapchainKHR(ctx->device, &create_info, NULL, &swapchain));
+
+    uint32_t image_count = 0;
+    CHECK_VK_RESULT(vkGetSwapchainImagesKHR(ctx->device, swapchain, &image_count, NULL));
+    return swapchain;
+}
+
+static void present_frames(SoakContext* ctx, VkSwapchainKHR swapchain, uint32_t frames) {
+    for (uint32_t frame = 0; frame < frames; frame++) {
+        uint32_t image_index;
+        CHECK_VK_RESULT(vkAcquireNextImageKHR(ctx->device, swapchain, UINT64_MAX, ctx->acquired,
+                                              VK_NULL_HANDLE, &image_index));
+
+        VkPresentInfoKHR present_info = {0};
+        present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+        present_info.waitSemaphoreCount = 1;
+        present_info.pWaitSemaphores = &ctx->acquired;
+        present_info.swapchainCount = 1;
+        present_info.pSwapchains = &swapchain;
+        present_info.pImageIndices = &image_index;
+        CHECK_VK_RESULT(vkQueuePresentKHR(ctx->queue, &present_info));
+    }
+}
+
+static void iterate(SoakContext* ctx, const SoakOptions* options, uint32_t iteration) {
+    VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+    for (uint32_t i = 0; i < options->resizes; i++) {
+        VkExtent2D extent = sizes[(iteration + i) % SIZE_COUNT];
+        VkSwapchainKHR old_swapchain = swapchain;
+        swapchain = create_swapchain(ctx, extent, old_swapchain);
+        if (old_swapchain != VK_NULL_HANDLE) {
+            vkDestroySwapchainKHR(ctx->device, old_swapchain, NULL);
+        }
+        present_frames(ctx, swapchain, options->frames);
+    }
+    CHECK_VK_RESULT(vkDeviceWaitIdle(ctx->device));
+    vkDestroySwapchainKHR(ctx->device, swapchain, NULL);
+}
+
+static void cleanup(SoakContext* ctx) {
+    vkDestroySemaphore(ctx->device, ctx->acquired, NULL);
+    vkDestroySurfaceKHR(ctx->instance, ctx->surface, NULL);
+    vkDestroyDevice(ctx->device, NULL);
+    vkDestroyInstance(ctx->instance, NULL);
+}
+
+int main(int argc, char** argv) {
+    SoakOptions options = parse_options(argc, argv);
+    SoakContext ctx = {0};
+
+    create_context(&ctx);
+    ctx.get_stats = find_driver_stats(&options);
+    if (!ctx.get_stats) {
+        fprintf(stderr, "Null driver counters not available, checking RSS only\n");
+    }
+
+    for (uint32_t i = 0; i < options.warmup; i++) {
+        iterate(&ctx, &options, i);
+    }
+    SoakSample baseline = sample(&ctx);
+    print_sample(0, &baseline);
+
+    int grown = 0;
+    for (uint32_t i = 1; i <= options.iterations; i++) {
+        iterate(&ctx, &options, options.warmup + i);
+        if (i % options.sample_every == 0 || i == options.iterations) {
+            SoakSample current = sample(&ctx);
+            print_sample(i, &current);
+            if (i == options.iterations) {
+                grown = check_growth(&baseline, &current, &options);
+            }
+        }
+    }
+
+    cleanup(&ctx);
+
+    if (grown > 0) {
+        printf("FAIL: %d counter(s) grew over %u iterations\n", grown, options.iterations);
+        return 1;
+    }
+    printf("PASS: no growth over %u iterations\n", options.iterations);
+    return 0;
+}
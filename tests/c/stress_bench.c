@@ -0,0 +1,293 @@
+#include <vulkan/vulkan.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "common.h"
+
+// Multithreaded present stress benchmark
+//
+// Runs 1..N threads that each acquire and present on their own swapchain as
+// fast as possible for a fixed time, and reports the aggregate presents per
+// second for every thread count. Threads either get a device each or share
+// one device with a queue each (--shared-device); the instance is always
+// shared, as the layer keeps one per process. Presents/s that stop growing
+// with threads show where the layer's locks serialize them. Meant for the
+// null driver (tests/icd/null_icd.c), see scripts/bench_stress.sh.
+
+#define MAX_THREADS 64
+
+typedef struct {
+    uint32_t width;
+    uint32_t height;
+    uint32_t thread_counts[MAX_THREADS];
+    uint32_t thread_count_count;
+    uint32_t max_threads;
+    double seconds;
+    int shared_device;
+    const char* label;
+} BenchOptions;
+
+typedef struct {
+    VkDevice device;
+    VkQueue queue;
+    VkSurfaceKHR surface;
+    VkSwapchainKHR swapchain;
+    VkSemaphore acquired;
+    uint64_t presents;
+    pthread_t thread;
+} ThreadContext;
+
+typedef struct {
+    VkInstance instance;
+    VkPhysicalDevice physical_device;
+    uint32_t queue_family;
+    uint32_t queue_count;
+    VkDevice shared_device;
+    ThreadContext threads[MAX_THREADS];
+    // 0 while threads wait to start, 1 while running, 2 to stop
+    int state;
+} BenchContext;
+
+static void usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --width N          Swapchain width (default 1280)\n"
+            "  --height N         Swapchain height (default 720)\n"
+            "  --threads LIST     Comma-separated thread counts (default 1,2,4,8)\n"
+            "  --seconds F        Run time per thread count (default 2)\n"
+            "  --shared-device    One device for all threads, a queue each\n"
+            "  --label NAME       Name printed with the results (default stress_bench)\n",
+            program);
+    exit(2);
+}
+
+static void parse_thread_counts(BenchOptions* options, const char* list, const char* program) {
+    options->thread_count_count = 0;
+    options->max_threads = 0;
+    char* end;
+    do {
+        unsigned long count = strtoul(list, &end, 10);
+        if (end == list || count == 0 || count > MAX_THREADS ||
+            options->thread_count_count == MAX_THREADS) {
+            usage(program);
+        }
+        options->thread_counts[options->thread_count_count++] = (uint32_t)count;
+        if (count > options->max_threads) {
+            options->max_threads = (uint32_t)count;
+        }
+        list = end + 1;
+    } while (*end == ',');
+    if (*end != '\0') {
+        usage(program);
+    }
+}
+
+static BenchOptions parse_options(int argc, char** argv) {
+    BenchOptions options = {
+        .width = 1280,
+        .height = 720,
+        .seconds = 2.0,
+        .shared_device = 0,
+        .label = "stress_bench",
+    };
+    parse_thread_counts(&options, "1,2,4,8", argv[0]);
+
+    for (int i = 1; i < argc; i++) {
+        const char* name = argv[i];
+        if (strcmp(name, "--shared-device") == 0) {
+            options.shared_device = 1;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+        }
+        const char* value = argv[++i];
+        if (strcmp(name, "--width") == 0) {
+            options.width = (uint32_t)strtoul(value, NULL, 10);
+        } else if (strcmp(name, "--height") == 0) {
+            options.height = (uint32_t)strtoul(value, NULL, 10);
+        } else if (strcmp(name, "--threads") == 0) {
+            parse_thread_counts(&options, value, argv[0]);
+        } else if (strcmp(name, "--seconds") == 0) {
+            options.seconds = strtod(value, NULL);
+        } else if (strcmp(name, "--label") == 0) {
+            options.label = value;
+        } else {
+            usage(argv[0]);
+        }
+    }
+
+    if (options.width == 0 || options.height == 0 || options.seconds <= 0.0) {
+        usage(argv[0]);
+    }
+    return options;
+}
+
+static void create_instance(BenchContext* ctx) {
+    ctx->instance = create_headless_instance("Stress Bench");
+    ctx->physical_device = first_physical_device(ctx->instance);
+    ctx->queue_family = find_graphics_queue_family(ctx->physical_device, &ctx->queue_count);
+}
+
+static void create_swapchain(BenchContext* ctx, ThreadContext* thread, const BenchOptions* options) {
+    thread->surface = create_headless_surface(ctx->instance);
+
+    VkSwapchainCreateInfoKHR create_info = {0};
+    create_info.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+    create_info.surface = thread->surface;
+    create_info.minImageCount = 3;
+    create_info.imageFormat = VK_FORMAT_B8G8R8A8_UNORM;
+    create_info.imageColorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+    create_info.imageExtent.width = options->width;
+    create_info.imageExtent.height = options->height;
+    create_info.imageArrayLayers = 1;
+    create_info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    create_info.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    create_info.preTransform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR;
+    create_info.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+    create_info.presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+    create_info.clipped = VK_TRUE;
+    CHECK_VK_RESULT(vkCreateSwapchainKHR(thread->device, &create_info, NULL, &thread->swapchain));
+
+    VkSemaphoreCreateInfo semaphore_info = {0};
+    semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    CHECK_VK_RESULT(vkCreateSemaphore(thread->device, &semaphore_info, NULL, &thread->acquired));
+}
+
+// Everything is created up front, so the timed part only acquires and presents
+static void create_threads(BenchContext* ctx, const BenchOptions* options) {
+    if (options->shared_device) {
+        if (ctx->queue_count < options->max_threads) {
+            fprintf(stderr, "--shared-device needs %u queues, the device has %u\n",
+                    options->max_threads, ctx->queue_count);
+            exit(1);
+        }
+        ctx->shared_device =
+            create_swapchain_device(ctx->physical_device, ctx->queue_family, options->max_threads);
+    }
+
+    for (uint32_t i = 0; i < options->max_threads; i++) {
+        ThreadContext* thread = &ctx->threads[i];
+        if (options->shared_device) {
+            thread->device = ctx->shared_device;
+            vkGetDeviceQueue(thread->device, ctx->queue_family, i, &thread->queue);
+        } else {
+            thread->device = create_swapchain_device(ctx->physical_device, ctx->queue_family, 1);
+            vkGetDeviceQueue(thread->device, ctx->queue_family, 0, &thread->queue);
+        }
+        create_swapchain(ctx, thread, options);
+    }
+}
+
+typedef struct {
+    BenchContext* ctx;
+    ThreadContext* thread;
+} ThreadArgs;
+
+static void* present_loop(void* arg) {
+    ThreadArgs* args = arg;
+    BenchContext* ctx = args->ctx;
+    ThreadContext* thread = args->thread;
+
+    VkPresentInfoKHR present_info = {0};
+    present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+    present_info.waitSemaphoreCount = 1;
+    present_info.pWaitSemaphores = &thread->acquired;
+    present_info.swapchainCount = 1;
+    present_info.pSwapchains = &thread->swapchain;
+
+    while (__atomic_load_n(&ctx->state, __ATOMIC_ACQUIRE) == 0) {
+    }
+
+    uint64_t presents = 0;
+    while (__atomic_load_n(&ctx->state, __ATOMIC_RELAXED) == 1) {
+        uint32_t image_index;
+        CHECK_VK_RESULT(vkAcquireNextImageKHR(thread->device, thread->swapchain, UINT64_MAX,
+                                              thread->acquired, VK_NULL_HANDLE, &image_index));
+        present_info.pImageIndices = &image_index;
+        CHECK_VK_RESULT(vkQueuePresentKHR(thread->queue, &present_info));
+        presents++;
+    }
+    thread->presents = presents;
+    return NULL;
+}
+
+static double run_threads(BenchContext* ctx, const BenchOptions* options, uint32_t thread_count) {
+    ThreadArgs args[MAX_THREADS];
+    __atomic_store_n(&ctx->state, 0, __ATOMIC_RELEASE);
+    for (uint32_t i = 0; i < thread_count; i++) {
+        args[i].ctx = ctx;
+        args[i].thread = &ctx->threads[i];
+        if (pthread_create(&ctx->threads[i].thread, NULL, present_loop, &args[i]) != 0) {
+            fprintf(stderr, "Failed to start thread %u\n", i);
+            exit(1);
+        }
+    }
+
+    uint64_t start = now_ns();
+    __atomic_store_n(&ctx->state, 1, __ATOMIC_RELEASE);
+    struct timespec duration;
+    duration.tv_sec = (time_t)options->seconds;
+    duration.tv_nsec = (long)((options->seconds - (double)duration.tv_sec) * 1e9);
+    nanosleep(&duration, NULL);
+    __atomic_store_n(&ctx->state, 2, __ATOMIC_RELEASE);
+
+    uint64_t presents = 0;
+    for (uint32_t i = 0; i < thread_count; i++) {
+        pthread_join(ctx->threads[i].thread, NULL);
+        presents += ctx->threads[i].presents;
+    }
+    return presents / ((double)(now_ns() - start) / 1e9);
+}
+
+static void run(BenchContext* ctx, const BenchOptions* options) {
+    printf("%s: %s, %ux%u, %.1f s per thread count\n", options->label,
+           options->shared_device ? "one device, a queue per thread" : "a device per thread",
+           options->width, options->height, options->seconds);
+
+    double single = 0.0;
+    for (uint32_t i = 0; i < options->thread_count_count; i++) {
+        uint32_t thread_count = options->thread_counts[i];
+        double rate = run_threads(ctx, options, thread_count);
+        // Scaling is relative to the per-thread rate of the first count
+        if (i == 0) {
+            single = rate / thread_count;
+        }
+        printf("  %2u threads: %12.0f presents/s  %10.0f per thread  %5.2fx\n", thread_count, rate,
+               rate / thread_count, rate / single);
+        fflush(stdout);
+    }
+}
+
+static void cleanup(BenchContext* ctx, const BenchOptions* options) {
+    for (uint32_t i = 0; i < options->max_threads; i++) {
+        ThreadContext* thread = &ctx->threads[i];
+        vkDeviceWaitIdle(thread->device);
+        vkDestroySemaphore(thread->device, thread->acquired, NULL);
+        vkDestroySwapchainKHR(thread->device, thread->swapchain, NULL);
+        vkDestroySurfaceKHR(ctx->instance, thread->surface, NULL);
+        if (!options->shared_device) {
+            vkDestroyDevice(thread->device, NULL);
+        }
+    }
+    if (options->shared_device) {
+        vkDestroyDevice(ctx->shared_device, NULL);
+    }
+    vkDestroyInstance(ctx->instance, NULL);
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options = parse_options(argc, argv);
+    BenchContext ctx = {0};
+
+    create_instance(&ctx);
+    create_threads(&ctx, &options);
+
+    run(&ctx, &options);
+
+    cleanup(&ctx, &options);
+    return 0;
+}
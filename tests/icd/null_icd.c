@@ -0,0 +1,958 @@
+#include <vulkan/vulkan.h>
+#include <vulkan/vk_icd.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "null_icd.h"
+
+// Null Vulkan driver
+//
+// A stand-in ICD for measuring the layer on its own. It implements the
+// instance, device, memory, image and queue entry points the layer and the
+// dispatch benchmark call, backed by host memory. Command buffers record
+// nothing and every submission has completed by the time vkQueueSubmit
+// returns, so a run on top of it times the loader and the layer without
+// any driver work. It has no WSI: swapchains only exist with the layer.
+// Live objects are counted for leak checks, see null_icd.h.
+//
+// Built by scripts/build_c_programs.sh next to its manifest:
+//   VK_DRIVER_FILES=target/release/unseen_null_icd.json
+
+// Most entry points ignore some or all of their arguments
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+
+#define NULL_ICD_INTERFACE_VERSION 5
+// Row pitch, allocation and map alignment
+#define NULL_ALIGNMENT 64
+#define NULL_HEAP_SIZE (4ull << 30)
+// Enough for one queue per thread in the stress benchmark
+#define NULL_QUEUE_COUNT 64
+
+#define TO_HANDLE(type, pointer) ((type)(uintptr_t)(pointer))
+#define FROM_HANDLE(type, handle) ((type*)(uintptr_t)(handle))
+
+typedef struct {
+    VK_LOADER_DATA loader_data;
+} NullPhysicalDevice;
+
+typedef struct {
+    VK_LOADER_DATA loader_data;
+    NullPhysicalDevice physical_device;
+} NullInstance;
+
+typedef struct {
+    VK_LOADER_DATA loader_data;
+} NullQueue;
+
+typedef struct {
+    VK_LOADER_DATA loader_data;
+    NullQueue queues[NULL_QUEUE_COUNT];
+} NullDevice;
+
+typedef struct NullCommandBuffer NullCommandBuffer;
+
+// Command buffers live in their pool's list so destroying the pool frees
+// them; pools are externally synchronized, so the list needs no lock
+struct NullCommandBuffer {
+    VK_LOADER_DATA loader_data;
+    NullCommandBuffer* prev;
+    NullCommandBuffer* next;
+};
+
+typedef struct {
+    NullCommandBuffer* command_buffers;
+} NullCommandPool;
+
+typedef struct {
+    void* data;
+    VkDeviceSize size;
+} NullMemory;
+
+// Images and buffers
+typedef struct {
+    VkDeviceSize size;
+    VkDeviceSize row_pitch;
+} NullResource;
+
+typedef struct {
+    uint32_t signaled;
+} NullFence;
+
+static const VkExtensionProperties instance_extensions[] = {
+    { VK_KHR_SURFACE_EXTENSION_NAME, 25 },
+    { VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME, 1 },
+};
+
+static const VkExtensionProperties device_extensions[] = {
+    { VK_KHR_SWAPCHAIN_EXTENSION_NAME, 70 },
+};
+
+static NullIcdStats stats;
+
+#define COUNT(field, delta) __atomic_add_fetch(&stats.field, (uint64_t)(delta), __ATOMIC_RELAXED)
+
+// Objects without state are just unique handles
+static uint64_t next_id(void) {
+    static uint64_t id;
+    return __atomic_add_fetch(&id, 1, __ATOMIC_RELAXED);
+}
+
+static VkDeviceSize align_up(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+static uint32_t format_size(VkFormat format) {
+    if (format >= VK_FORMAT_R8G8B8_UNORM && format <= VK_FORMAT_B8G8R8_SRGB) {
+        return 3;
+    }
+    if (format >= VK_FORMAT_R16G16B16A16_UNORM && format <= VK_FORMAT_R16G16B16A16_SFLOAT) {
+        return 8;
+    }
+    if (format >= VK_FORMAT_R32G32B32A32_UINT && format <= VK_FORMAT_R32G32B32A32_SFLOAT) {
+        return 16;
+    }
+    return 4;
+}
+
+static VkResult fill_extensions(const VkExtensionProperties* extensions, uint32_t available,
+                                uint32_t* count, VkExtensionProperties* properties) {
+    if (!properties) {
+        *count = available;
+        return VK_SUCCESS;
+    }
+    uint32_t written = *count < available ? *count : available;
+    memcpy(properties, extensions, sizeof(VkExtensionProperties) * written);
+    *count = written;
+    return written < available ? VK_INCOMPLETE : VK_SUCCESS;
+}
+
+// Instance
+
+static VKAPI_ATTR VkResult VKAPI_CALL null_EnumerateInstanceExtensionProperties(
+    const char* layer_name, uint32_t* count, VkExtensionProperties* properties) {
+    if (layer_name) {
+        return VK_ERROR_LAYER_NOT_PRESENT;
+    }
+    return fill_extensions(instance_extensions,
+                           sizeof(instance_extensions) / sizeof(instance_extensions[0]),
+                           count, properties);
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL null_CreateInstance(
+    const VkInstanceCreateInfo* create_info, const VkAllocationCallbacks* allocator,
+    VkInstance* instance) {
+    NullInstance* null_instance = calloc(1, sizeof(NullInstance));
+    if (!null_instance) {
+        return VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+    set_loader_magic_value(null_instance);
+    set_loader_magic_value(&null_instance->physical_device);
+    *instance = (VkInstance)null_instance;
+    return VK_SUCCESS;
+}
+
+static VKAPI_ATTR void VKAPI_CALL null_DestroyInstance(
+    VkInstance instance, const VkAllocationCallbacks* allocator) {
+    free(instance);
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL null_EnumeratePhysicalDevices(
+    VkInstance instance, uint32_t* count, VkPhysicalDevice* physical_devices) {
+    if (!physical_devices) {
+        *count = 1;
+        return VK_SUCCESS;
+    }
+    if (*count == 0) {
+        return VK_INCOMPLETE;
+    }
+    physical_devices[0] = (VkPhysicalDevice)&((NullInstance*)instance)->physical_device;
+    *count = 1;
+    return VK_SUCCESS;
+}
+
+static VKAPI_ATTR void VKAPI_CALL null_GetPhysicalDeviceFeatures(
+    VkPhysicalDevice physical_device, VkPhysicalDeviceFeatures* features) {
+    memset(features, 0, sizeof(*features));
+}
+
+static VKAPI_ATTR void VKAPI_CALL null_GetPhysicalDeviceFormatProperties(
+    VkPhysicalDevice physical_device, VkFormat format, VkFormatProperties* properties) {
+    VkFormatFeatureFlags features = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT |
+                                    VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT |
+                                    VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BLEND_BIT |
+                                    VK_FORMAT_FEATURE_BLIT_SRC_BIT |
+                                    VK_FORMAT_FEATURE_BLIT_DST_BIT;
+    properties->linearTilingFeatures = features;
+    properties->optimalTilingFeatures = features;
+    properties->bufferFeatures = 0;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL null_GetPhysicalDeviceImageFormatProperties(
+    VkPhysicalDevice physical_device, VkFormat format, VkImageType type, VkImageTiling tiling,
+    VkImageUsageFlags usage, VkImageCreateFlags flags, VkImageFormatProperties* properties) {
+    properties->maxExtent.width = 16384;
+    properties->maxExtent.height = 16384;
+    properties->maxExtent.depth = 1;
+    properties->maxMipLevels = 15;
+    properties->maxArrayLayers = 256;
+    properties->sampleCounts = VK_SAMPLE_COUNT_1_BIT;
+    properties->maxResourceSize = NULL_HEAP_SIZE;
+    return VK_SUCCESS;
+}
+
+static VKAPI_ATTR void VKAPI_CALL null_GetPhysicalDeviceProperties(
+    VkPhysicalDevice physical_device, VkPhysicalDeviceProperties* properties) {
+    memset(properties, 0, sizeof(*properties));
+    properties->apiVersion = VK_API_VERSION_1_0;
+    properties->driverVersion = 1;
+    properties->deviceType = VK_PHYSICAL_DEVICE_TYPE_CPU;
+    strcpy(properties->deviceName, "Unseen null device");
+
+    VkPhysicalDeviceLimits* limits = &properties->limits;
+    limits->maxImageDimension1D = 16384;
+    limits->maxImageDimension2D = 16384;
+    limits->maxImageDimension3D = 2048;
+    limits->maxImageDimensionCube = 16384;
+    limits->maxImageArrayLayers = 256;
+    limits->maxUniformBufferRange = 65536;
+    limits->maxStorageBufferRange = UINT32_MAX;
+    limits->maxPushConstantsSize = 128;
+    limits->maxMemoryAllocationCount = UINT32_MAX;
+    limits->maxSamplerAllocationCount = 4000;
+    limits->bufferImageGranularity = 1;
+    limits->maxBoundDescriptorSets = 8;
+    limits->maxComputeWorkGroupCount[0] = 65535;
+    limits->maxComputeWorkGroupCount[1] = 65535;
+    limits->maxComputeWorkGroupCount[2] = 65535;
+    limits->maxComputeWorkGroupInvocations = 1024;
+    limits->maxComputeWorkGroupSize[0] = 1024;
+    limits->maxComputeWorkGroupSize[1] = 1024;
+    limits->maxComputeWorkGroupSize[2] = 64;
+    limits->maxViewports = 1;
+    limits->maxViewportDimensions[0] = 16384;
+    limits->maxViewportDimensions[1] = 16384;
+    limits->minMemoryMapAlignment = NULL_ALIGNMENT;
+    limits->minUniformBufferOffsetAlignment = NULL_ALIGNMENT;
+    limits->minStorageBufferOffsetAlignment = NULL_ALIGNMENT;
+    limits->maxFramebufferWidth = 16384;
+    limits->maxFramebufferHeight = 16384;
+    limits->maxFramebufferLayers = 256;
+    limits->framebufferColorSampleCounts = VK_SAMPLE_COUNT_1_BIT;
+    limits->sampledImageColorSampleCounts = VK_SAMPLE_COUNT_1_BIT;
+    limits->maxColorAttachments = 8;
+    limits->timestampComputeAndGraphics = VK_TRUE;
+    limits->timestampPeriod = 1.0f;
+    limits->optimalBufferCopyOffsetAlignment = 1;
+    limits->optimalBufferCopyRowPitchAlignment = 1;
+    limits->nonCoherentAtomSize = NULL_ALIGNMENT;
+}
+
+static VKAPI_ATTR void VKAPI_CALL null_GetPhysicalDeviceQueueFamilyProperties(
+    VkPhysicalDevice physical_device, uint32_t* count, VkQueueFamilyProperties* properties) {
+    if (!properties) {
+        *count = 1;
+        return;
+    }
+    if (*count == 0) {
+        return;
+    }
+    memset(properties, 0, sizeof(*properties));
+    properties->queueFlags = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT;
+    properties->queueCount = NULL_QUEUE_COUNT;
+    properties->timestampValidBits = 64;
+    properties->minImageTransferGranularity.width = 1;
+    properties->minImageTransferGranularity.height = 1;
+    properties->minImageTransferGranularity.depth = 1;
+    *count = 1;
+}
+
+static VKAPI_ATTR void VKAPI_CALL null_GetPhysicalDeviceMemoryProperties(
+    VkPhysicalDevice physical_device, VkPhysicalDeviceMemoryProperties* properties) {
+    memset(properties, 0, sizeof(*properties));
+    properties->memoryTypeCount = 1;
+    properties->memoryTypes[0].propertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT |
+                                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                               VK_MEMORY_PROPERTY_HOST_COHERENT_BIT |
+                                               VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+    properties->memoryTypes[0].heapIndex = 0;
+    properties->memoryHeapCount = 1;
+    properties->memoryHeaps[0].size = NULL_HEAP_SIZE;
+    properties->memoryHeaps[0].flags = VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+}
+
+static VKAPI_ATTR void VKAPI_CALL null_GetPhysicalDeviceSparseImageFormatProperties(
+    VkPhysicalDevice physical_device, VkFormat format, VkImageType type,
+    VkSampleCountFlagBits samples, VkImageUsageFlags usage, VkImageTiling tiling,
+    uint32_t* count, VkSparseImageFormatProperties* properties) {
+    *count = 0;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL null_EnumerateDeviceExtensionProperties(
+    VkPhysicalDevice physical_device, const char* layer_name, uint32_t* count,
+    VkExtensionProperties* properties) {
+    if (layer_name) {
+        return VK_ERROR_LAYER_NOT_PRESENT;
+    }
+    return fill_extensions(device_extensions,
+                           sizeof(device_extensions) / sizeof(device_extensions[0]),
+                           count, properties);
+}
+
+// Device and queue
+
+static VKAPI_ATTR VkResult VKAPI_CALL null_CreateDevice(
+    VkPhysicalDevice physical_device, const VkDeviceCreateInfo* create_info,
+    const VkAllocationCallbacks* allocator, VkDevice* device) {
+    NullDevice* null_device = calloc(1, sizeof(NullDevice));
+    if (!null_device) {
+        return VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+    set_loader_magic_value(null_device);
+    COUNT(devices, 1);
+    for (uint32_t i = 0; i < NULL_QUEUE_COUNT; i++) {
+        set_loader_magic_value(&null_device->queues[i]);
+    }
+    *device = (VkDevice)null_device;
+    return VK_SUCCESS;
+}
+
+static VKAPI_ATTR void VKAPI_CALL null_DestroyDevice(
+    VkDevice device, const VkAllocationCallbacks* allocator) {
+    if (device) {
+        COUNT(devices, -1);
+    }
+    free(device);
+}
+
+static VKAPI_ATTR void VKAPI_CALL null_GetDeviceQueue(
+    VkDevice device, uint32_t family_index, uint32_t queue_index, VkQueue* queue) {
+    *queue = (VkQueue)&((NullDevice*)device)->queues[queue_index % NULL_QUEUE_COUNT];
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL null_QueueSubmit(
+    VkQueue queue, uint32_t submit_count, const VkSubmitInfo* submits, VkFence fence) {
+    if (fence != VK_NULL_HANDLE) {
+        __atomic_store_n(&FROM_HANDLE(NullFence, fence)->signaled, 1, __ATOMIC_RELEASE);
+    }
+    return VK_SUCCESS;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL null_QueueWaitIdle(VkQueue queue) {
+    return VK_SUCCESS;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL null_DeviceWaitIdle(VkDevice device) {
+    return VK_SUCCESS;
+}
+
+// Memory, images and buffers
+
+static VKAPI_ATTR VkResult VKAPI_CALL null_AllocateMemory(
+    VkDevice device, const VkMemoryAllocateInfo* allocate_info,
+    const VkAllocationCallbacks* allocator, VkDeviceMemory* memory) {
+    NullMemory* null_memory = malloc(sizeof(NullMemory));
+    if (!null_memory) {
+        return VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+    null_memory->size = allocate_info->allocationSize;
+    if (posix_memalign(&null_memory->data, NULL_ALIGNMENT, null_memory->size) != 0) {
+        free(null_memory);
+        return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+    }
+    // Captures of frames nothing was drawn to are deterministic
+    memset(null_memory->data, 0, null_memory->size);
+    COUNT(memory_allocations, 1);
+    COUNT(memory_bytes, null_memory->size);
+    *memory = TO_HANDLE(VkDeviceMemory, null_memory);
+    return VK_SUCCESS;
+}
+
+static VKAPI_ATTR void VKAPI_CALL null_FreeMemory(
+    VkDevice device, VkDeviceMemory memory, const VkAllocationCallbacks* allocator) {
+    NullMemory* null_memory = FROM_HANDLE(NullMemory, memory);
+    if (null_memory) {
+        COUNT(memory_allocations, -1);
+        COUNT(memory_bytes, -null_memory->size);
+        free(null_memory->data);
+        free(null_memory);
+    }
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL null_MapMemory(
+    VkDevice device, VkDeviceMemory memory, VkDeviceSize offset, VkDeviceSize size,
+    VkMemoryMapFlags flags, void** data) {
+    *data = (uint8_t*)FROM_HANDLE(NullMemory, memory)->data + offset;
+    return VK_SUCCESS;
+}
+
+static VKAPI_ATTR void VKAPI_CALL null_UnmapMemory(VkDevice device, VkDeviceMemory memory) {
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL null_FlushMappedMemoryRanges(
+    VkDevice device, uint32_t count, const VkMappedMemoryRange* ranges) {
+    return VK_SUCCESS;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL null_InvalidateMappedMemoryRanges(
+    VkDevice device, uint32_t count, const VkMappedMemoryRange* ranges) {
+    return VK_SUCCESS;
+}
+
+static VkResult create_resource(VkDeviceSize size, VkDeviceSize row_pitch, NullResource** resource) {
+    *resource = malloc(sizeof(NullResource));
+    if (!*resource) {
+        return VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+    (*resource)->size = align_up(size > 0 ? size : 1, NULL_ALIGNMENT);
+    (*resource)->row_pitch = row_pitch;
+    return VK_SUCCESS;
+}
+
+static void get_resource_requirements(NullResource* resource, VkMemoryRequirements* requirements) {
+    requirements->size = resource->size;
+    requirements->alignment = NULL_ALIGNMENT;
+    requirements->memoryTypeBits = 1;
+}
+
+// Linear and optimal images share one layout; only the first mip level has storage
+static VKAPI_ATTR VkResult VKAPI_CALL null_CreateImage(
+    VkDevice device, const VkImageCreateInfo* create_info, const VkAllocationCallbacks* allocator,
+    VkImage* image) {
+    VkDeviceSize row_pitch =
+        align_up((VkDeviceSize)create_info->extent.width * format_size(create_info->format),
+                 NULL_ALIGNMENT);
+    VkDeviceSize size = row_pitch * create_info->extent.height * create_info->extent.depth *
+                        create_info->arrayLayers;
+    NullResource* resource;
+    VkResult result = create_resource(size, row_pitch, &resource);
+    if (result == VK_SUCCESS) {
+        COUNT(images, 1);
+    }
+    *image = TO_HANDLE(VkImage, resource);
+    return result;
+}
+
+static VKAPI_ATTR void VKAPI_CALL null_DestroyImage(
+    VkDevice device, VkImage image, const VkAllocationCallbacks* allocator) {
+    if (image != VK_NULL_HANDLE) {
+        COUNT(images, -1);
+    }
+    free(FROM_HANDLE(NullResource, image));
+}
+
+static VKAPI_ATTR void VKAPI_CALL null_GetImageMemoryRequirements(
+    VkDevice device, VkImage image, VkMemoryRequirements* requirements) {
+    get_resource_requirements(FROM_HANDLE(NullResource, image), requirements);
+}
+
+static VKAPI_ATTR void VKAPI_CALL null_GetImageSubresourceLayout(
+    VkDevice device, VkImage image, const VkImageSubresource* subresource,
+    VkSubresourceLayout* layout) {
+    NullResource* resource = FROM_HANDLE(NullResource, image);
+    layout->offset = 0;
+    layout->size = resource->size;
+    layout->rowPitch = resource->row_pitch;
+    layout->arrayPitch = resource->size;
+    layout->depthPitch = resource->size;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL null_BindImageMemory(
+    VkDevice device, VkImage image, VkDeviceMemory memory, VkDeviceSize offset) {
+    return VK_SUCCESS;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL null_CreateBuffer(
+    VkDevice device, const VkBufferCreateInfo* create_info, const VkAllocationCallbacks* allocator,
+    VkBuffer* buffer) {
+    NullResource* resource;
+    VkResult result = create_resource(create_info->size, 0, &resource);
+    if (result == VK_SUCCESS) {
+        COUNT(buffers, 1);
+    }
+    *buffer = TO_HANDLE(VkBuffer, resource);
+    return result;
+}
+
+static VKAPI_ATTR void VKAPI_CALL null_DestroyBuffer(
+    VkDevice device, VkBuffer buffer, const VkAllocationCallbacks* allocator) {
+    if (buffer != VK_NULL_HANDLE) {
+        COUNT(buffers, -1);
+    }
+    free(FROM_HANDLE(NullResource, buffer));
+}
+
+static VKAPI_ATTR void VKAPI_CALL null_GetBufferMemoryRequirements(
+    VkDevice device, VkBuffer buffer, VkMemoryRequirements* requirements) {
+    get_resource_requirements(FROM_HANDLE(NullResource, buffer), requirements);
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL null_BindBufferMemory(
+    VkDevice device, VkBuffer buffer, VkDeviceMemory memory, VkDeviceSize offset) {
+    return VK_SUCCESS;
+}
+
+// Synchronization
+
+static VKAPI_ATTR VkResult VKAPI_CALL null_CreateFence(
+    VkDevice device, const VkFenceCreateInfo* create_info, const VkAllocationCallbacks* allocator,
+    VkFence* fence) {
+    NullFence* null_fence = malloc(sizeof(NullFence));
+    if (!null_fence) {
+        return VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+    null_fence->signaled = (create_info->flags & VK_FENCE_CREATE_SIGNALED_BIT) != 0;
+    COUNT(fences, 1);
+    *fence = TO_HANDLE(VkFence, null_fence);
+    return VK_SUCCESS;
+}
+
+static VKAPI_ATTR void VKAPI_CALL null_DestroyFence(
+    VkDevice device, VkFence fence, const VkAllocationCallbacks* allocator) {
+    if (fence != VK_NULL_HANDLE) {
+        COUNT(fences, -1);
+    }
+    free(FROM_HANDLE(NullFence, fence));
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL null_ResetFences(
+    VkDevice device, uint32_t count, const VkFence* fences) {
+    for (uint32_t i = 0; i < count; i++) {
+        __atomic_store_n(&FROM_HANDLE(NullFence, fences[i])->signaled, 0, __ATOMIC_RELAXED);
+    }
+    return VK_SUCCESS;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL null_GetFenceStatus(VkDevice device, VkFence fence) {
+    return __atomic_load_n(&FROM_HANDLE(NullFence, fence)->signaled, __ATOMIC_ACQUIRE)
+               ? VK_SUCCESS
+               : VK_NOT_READY;
+}
+
+// Work completes at submission, so a fence that is still unsignaled was
+// never submitted and would never signal; time out instead of hanging
+static VKAPI_ATTR VkResult VKAPI_CALL null_WaitForFences(
+    VkDevice device, uint32_t count, const VkFence* fences, VkBool32 wait_all, uint64_t timeout) {
+    uint32_t signaled = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        signaled += null_GetFenceStatus(device, fences[i]) == VK_SUCCESS;
+    }
+    if (wait_all ? signaled == count : signaled > 0) {
+        return VK_SUCCESS;
+    }
+    return VK_TIMEOUT;
+}
+
+// Objects without state
+
+#define NULL_OBJECT(name) \
+    static VKAPI_ATTR VkResult VKAPI_CALL null_Create##name( \
+        VkDevice device, const Vk##name##CreateInfo* create_info, \
+        const VkAllocationCallbacks* allocator, Vk##name* object) { \
+        *object = TO_HANDLE(Vk##name, next_id()); \
+        COUNT(other_objects, 1); \
+        return VK_SUCCESS; \
+    } \
+    static VKAPI_ATTR void VKAPI_CALL null_Destroy##name( \
+        VkDevice device, Vk##name object, const VkAllocationCallbacks* allocator) { \
+        if (object != VK_NULL_HANDLE) { \
+            COUNT(other_objects, -1); \
+        } \
+    }
+
+NULL_OBJECT(Semaphore)
+NULL_OBJECT(ImageView)
+NULL_OBJECT(Sampler)
+NULL_OBJECT(ShaderModule)
+NULL_OBJECT(PipelineLayout)
+NULL_OBJECT(DescriptorSetLayout)
+NULL_OBJECT(DescriptorPool)
+NULL_OBJECT(QueryPool)
+NULL_OBJECT(RenderPass)
+NULL_OBJECT(Framebuffer)
+
+static VKAPI_ATTR VkResult VKAPI_CALL null_ResetDescriptorPool(
+    VkDevice device, VkDescriptorPool descriptor_pool, VkDescriptorPoolResetFlags flags) {
+    return VK_SUCCESS;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL null_AllocateDescriptorSets(
+    VkDevice device, const VkDescriptorSetAllocateInfo* allocate_info, VkDescriptorSet* sets) {
+    for (uint32_t i = 0; i < allocate_info->descriptorSetCount; i++) {
+        sets[i] = TO_HANDLE(VkDescriptorSet, next_id());
+    }
+    return VK_SUCCESS;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL null_FreeDescriptorSets(
+    VkDevice device, VkDescriptorPool descriptor_pool, uint32_t count, const VkDescriptorSet* sets) {
+    return VK_SUCCESS;
+}
+
+static VKAPI_ATTR void VKAPI_CALL null_UpdateDescriptorSets(
+    VkDevice device, uint32_t write_count, const VkWriteDescriptorSet* writes,
+    uint32_t copy_count, const VkCopyDescriptorSet* copies) {
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL null_CreateGraphicsPipelines(
+    VkDevice device, VkPipelineCache cache, uint32_t count,
+    const VkGraphicsPipelineCreateInfo* create_infos, const VkAllocationCallbacks* allocator,
+    VkPipeline* pipelines) {
+    for (uint32_t i = 0; i < count; i++) {
+        pipelines[i] = TO_HANDLE(VkPipeline, next_id());
+    }
+    COUNT(other_objects, count);
+    return VK_SUCCESS;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL null_CreateComputePipelines(
+    VkDevice device, VkPipelineCache cache, uint32_t count,
+    const VkComputePipelineCreateInfo* create_infos, const VkAllocationCallbacks* allocator,
+    VkPipeline* pipelines) {
+    for (uint32_t i = 0; i < count; i++) {
+        pipelines[i] = TO_HANDLE(VkPipeline, next_id());
+    }
+    COUNT(other_objects, count);
+    return VK_SUCCESS;
+}
+
+static VKAPI_ATTR void VKAPI_CALL null_DestroyPipeline(
+    VkDevice device, VkPipeline pipeline, const VkAllocationCallbacks* allocator) {
+    if (pipeline != VK_NULL_HANDLE) {
+        COUNT(other_objects, -1);
+    }
+}
+
+// Timestamps are never written, every query reads as 0
+static VKAPI_ATTR VkResult VKAPI_CALL null_GetQueryPoolResults(
+    VkDevice device, VkQueryPool query_pool, uint32_t first_query, uint32_t query_count,
+    size_t data_size, void* data, VkDeviceSize stride, VkQueryResultFlags flags) {
+    memset(data, 0, data_size);
+    return VK_SUCCESS;
+}
+
+// Command buffers
+
+static VKAPI_ATTR VkResult VKAPI_CALL null_CreateCommandPool(
+    VkDevice device, const VkCommandPoolCreateInfo* create_info,
+    const VkAllocationCallbacks* allocator, VkCommandPool* command_pool) {
+    NullCommandPool* pool = calloc(1, sizeof(NullCommandPool));
+    if (!pool) {
+        return VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+    COUNT(other_objects, 1);
+    *command_pool = TO_HANDLE(VkCommandPool, pool);
+    return VK_SUCCESS;
+}
+
+static void free_command_buffer(NullCommandPool* pool, NullCommandBuffer* command_buffer) {
+    if (command_buffer->prev) {
+        command_buffer->prev->next = command_buffer->next;
+    } else {
+        pool->command_buffers = command_buffer->next;
+    }
+    if (command_buffer->next) {
+        command_buffer->next->prev = command_buffer->prev;
+    }
+    COUNT(command_buffers, -1);
+    free(command_buffer);
+}
+
+// Destroying a pool frees every command buffer still allocated from it
+static VKAPI_ATTR void VKAPI_CALL null_DestroyCommandPool(
+    VkDevice device, VkCommandPool command_pool, const VkAllocationCallbacks* allocator) {
+    NullCommandPool* pool = FROM_HANDLE(NullCommandPool, command_pool);
+    if (!pool) {
+        return;
+    }
+    while (pool->command_buffers) {
+        free_command_buffer(pool, pool->command_buffers);
+    }
+    COUNT(other_objects, -1);
+    free(pool);
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL null_ResetCommandPool(
+    VkDevice device, VkCommandPool command_pool, VkCommandPoolResetFlags flags) {
+    return VK_SUCCESS;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL null_AllocateCommandBuffers(
+    VkDevice device, const VkCommandBufferAllocateInfo* allocate_info,
+    VkCommandBuffer* command_buffers) {
+    NullCommandPool* pool = FROM_HANDLE(NullCommandPool, allocate_info->commandPool);
+    for (uint32_t i = 0; i < allocate_info->commandBufferCount; i++) {
+        NullCommandBuffer* command_buffer = malloc(sizeof(NullCommandBuffer));
+        if (!command_buffer) {
+            for (uint32_t j = 0; j < i; j++) {
+                free_command_buffer(pool, (NullCommandBuffer*)command_buffers[j]);
+                command_buffers[j] = VK_NULL_HANDLE;
+            }
+            return VK_ERROR_OUT_OF_HOST_MEMORY;
+        }
+        set_loader_magic_value(command_buffer);
+        command_buffer->prev = NULL;
+        command_buffer->next = pool->command_buffers;
+        if (pool->command_buffers) {
+            pool->command_buffers->prev = command_buffer;
+        }
+        pool->command_buffers = command_buffer;
+        COUNT(command_buffers, 1);
+        command_buffers[i] = (VkCommandBuffer)command_buffer;
+    }
+    return VK_SUCCESS;
+}
+
+static VKAPI_ATTR void VKAPI_CALL null_FreeCommandBuffers(
+    VkDevice device, VkCommandPool command_pool, uint32_t count,
+    const VkCommandBuffer* command_buffers) {
+    NullCommandPool* pool = FROM_HANDLE(NullCommandPool, command_pool);
+    for (uint32_t i = 0; i < count; i++) {
+        if (command_buffers[i]) {
+            free_command_buffer(pool, (NullCommandBuffer*)command_buffers[i]);
+        }
+    }
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL null_BeginCommandBuffer(
+    VkCommandBuffer command_buffer, const VkCommandBufferBeginInfo* begin_info) {
+    return VK_SUCCESS;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL null_EndCommandBuffer(VkCommandBuffer command_buffer) {
+    return VK_SUCCESS;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL null_ResetCommandBuffer(
+    VkCommandBuffer command_buffer, VkCommandBufferResetFlags flags) {
+    return VK_SUCCESS;
+}
+
+static VKAPI_ATTR void VKAPI_CALL null_CmdPipelineBarrier(
+    VkCommandBuffer command_buffer, VkPipelineStageFlags src_stage_mask,
+    VkPipelineStageFlags dst_stage_mask, VkDependencyFlags dependency_flags,
+    uint32_t memory_barrier_count, const VkMemoryBarrier* memory_barriers,
+    uint32_t buffer_barrier_count, const VkBufferMemoryBarrier* buffer_barriers,
+    uint32_t image_barrier_count, const VkImageMemoryBarrier* image_barriers) {
+}
+
+static VKAPI_ATTR void VKAPI_CALL null_CmdBeginRenderPass(
+    VkCommandBuffer command_buffer, const VkRenderPassBeginInfo* begin_info,
+    VkSubpassContents contents) {
+}
+
+static VKAPI_ATTR void VKAPI_CALL null_CmdEndRenderPass(VkCommandBuffer command_buffer) {
+}
+
+static VKAPI_ATTR void VKAPI_CALL null_CmdBindPipeline(
+    VkCommandBuffer command_buffer, VkPipelineBindPoint bind_point, VkPipeline pipeline) {
+}
+
+static VKAPI_ATTR void VKAPI_CALL null_CmdBindDescriptorSets(
+    VkCommandBuffer command_buffer, VkPipelineBindPoint bind_point, VkPipelineLayout layout,
+    uint32_t first_set, uint32_t set_count, const VkDescriptorSet* sets,
+    uint32_t dynamic_offset_count, const uint32_t* dynamic_offsets) {
+}
+
+static VKAPI_ATTR void VKAPI_CALL null_CmdPushConstants(
+    VkCommandBuffer command_buffer, VkPipelineLayout layout, VkShaderStageFlags stages,
+    uint32_t offset, uint32_t size, const void* values) {
+}
+
+static VKAPI_ATTR void VKAPI_CALL null_CmdSetViewport(
+    VkCommandBuffer command_buffer, uint32_t first_viewport, uint32_t viewport_count,
+    const VkViewport* viewports) {
+}
+
+static VKAPI_ATTR void VKAPI_CALL null_CmdSetScissor(
+    VkCommandBuffer command_buffer, uint32_t first_scissor, uint32_t scissor_count,
+    const VkRect2D* scissors) {
+}
+
+static VKAPI_ATTR void VKAPI_CALL null_CmdDraw(
+    VkCommandBuffer command_buffer, uint32_t vertex_count, uint32_t instance_count,
+    uint32_t first_vertex, uint32_t first_instance) {
+}
+
+static VKAPI_ATTR void VKAPI_CALL null_CmdDispatch(
+    VkCommandBuffer command_buffer, uint32_t group_count_x, uint32_t group_count_y,
+    uint32_t group_count_z) {
+}
+
+static VKAPI_ATTR void VKAPI_CALL null_CmdClearColorImage(
+    VkCommandBuffer command_buffer, VkImage image, VkImageLayout layout,
+    const VkClearColorValue* color, uint32_t range_count, const VkImageSubresourceRange* ranges) {
+}
+
+static VKAPI_ATTR void VKAPI_CALL null_CmdClearAttachments(
+    VkCommandBuffer command_buffer, uint32_t attachment_count, const VkClearAttachment* attachments,
+    uint32_t rect_count, const VkClearRect* rects) {
+}
+
+static VKAPI_ATTR void VKAPI_CALL null_CmdCopyBufferToImage(
+    VkCommandBuffer command_buffer, VkBuffer buffer, VkImage image, VkImageLayout layout,
+    uint32_t region_count, const VkBufferImageCopy* regions) {
+}
+
+static VKAPI_ATTR void VKAPI_CALL null_CmdCopyImageToBuffer(
+    VkCommandBuffer command_buffer, VkImage image, VkImageLayout layout, VkBuffer buffer,
+    uint32_t region_count, const VkBufferImageCopy* regions) {
+}
+
+static VKAPI_ATTR void VKAPI_CALL null_CmdResetQueryPool(
+    VkCommandBuffer command_buffer, VkQueryPool query_pool, uint32_t first_query,
+    uint32_t query_count) {
+}
+
+static VKAPI_ATTR void VKAPI_CALL null_CmdWriteTimestamp(
+    VkCommandBuffer command_buffer, VkPipelineStageFlagBits stage, VkQueryPool query_pool,
+    uint32_t query) {
+}
+
+// Dispatch
+
+static VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL null_GetDeviceProcAddr(VkDevice device, const char* name);
+static VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL null_GetInstanceProcAddr(VkInstance instance, const char* name);
+
+#define ENTRY_POINT(name) { "vk" #name, (PFN_vkVoidFunction)null_##name }
+
+static const struct {
+    const char* name;
+    PFN_vkVoidFunction function;
+} entry_points[] = {
+    ENTRY_POINT(GetInstanceProcAddr),
+    ENTRY_POINT(GetDeviceProcAddr),
+    ENTRY_POINT(EnumerateInstanceExtensionProperties),
+    ENTRY_POINT(CreateInstance),
+    ENTRY_POINT(DestroyInstance),
+    ENTRY_POINT(EnumeratePhysicalDevices),
+    ENTRY_POINT(GetPhysicalDeviceFeatures),
+    ENTRY_POINT(GetPhysicalDeviceFormatProperties),
+    ENTRY_POINT(GetPhysicalDeviceImageFormatProperties),
+    ENTRY_POINT(GetPhysicalDeviceProperties),
+    ENTRY_POINT(GetPhysicalDeviceQueueFamilyProperties),
+    ENTRY_POINT(GetPhysicalDeviceMemoryProperties),
+    ENTRY_POINT(GetPhysicalDeviceSparseImageFormatProperties),
+    ENTRY_POINT(EnumerateDeviceExtensionProperties),
+    ENTRY_POINT(CreateDevice),
+    ENTRY_POINT(DestroyDevice),
+    ENTRY_POINT(GetDeviceQueue),
+    ENTRY_POINT(QueueSubmit),
+    ENTRY_POINT(QueueWaitIdle),
+    ENTRY_POINT(DeviceWaitIdle),
+    ENTRY_POINT(AllocateMemory),
+    ENTRY_POINT(FreeMemory),
+    ENTRY_POINT(MapMemory),
+    ENTRY_POINT(UnmapMemory),
+    ENTRY_POINT(FlushMappedMemoryRanges),
+    ENTRY_POINT(InvalidateMappedMemoryRanges),
+    ENTRY_POINT(CreateImage),
+    ENTRY_POINT(DestroyImage),
+    ENTRY_POINT(GetImageMemoryRequirements),
+    ENTRY_POINT(GetImageSubresourceLayout),
+    ENTRY_POINT(BindImageMemory),
+    ENTRY_POINT(CreateBuffer),
+    ENTRY_POINT(DestroyBuffer),
+    ENTRY_POINT(GetBufferMemoryRequirements),
+    ENTRY_POINT(BindBufferMemory),
+    ENTRY_POINT(CreateFence),
+    ENTRY_POINT(DestroyFence),
+    ENTRY_POINT(ResetFences),
+    ENTRY_POINT(GetFenceStatus),
+    ENTRY_POINT(WaitForFences),
+    ENTRY_POINT(CreateSemaphore),
+    ENTRY_POINT(DestroySemaphore),
+    ENTRY_POINT(CreateCommandPool),
+    ENTRY_POINT(DestroyCommandPool),
+    ENTRY_POINT(ResetCommandPool),
+    ENTRY_POINT(CreateImageView),
+    ENTRY_POINT(DestroyImageView),
+    ENTRY_POINT(CreateSampler),
+    ENTRY_POINT(DestroySampler),
+    ENTRY_POINT(CreateShaderModule),
+    ENTRY_POINT(DestroyShaderModule),
+    ENTRY_POINT(CreatePipelineLayout),
+    ENTRY_POINT(DestroyPipelineLayout),
+    ENTRY_POINT(CreateDescriptorSetLayout),
+    ENTRY_POINT(DestroyDescriptorSetLayout),
+    ENTRY_POINT(CreateDescriptorPool),
+    ENTRY_POINT(DestroyDescriptorPool),
+    ENTRY_POINT(ResetDescriptorPool),
+    ENTRY_POINT(AllocateDescriptorSets),
+    ENTRY_POINT(FreeDescriptorSets),
+    ENTRY_POINT(UpdateDescriptorSets),
+    ENTRY_POINT(CreateQueryPool),
+    ENTRY_POINT(DestroyQueryPool),
+    ENTRY_POINT(GetQueryPoolResults),
+    ENTRY_POINT(CreateRenderPass),
+    ENTRY_POINT(DestroyRenderPass),
+    ENTRY_POINT(CreateFramebuffer),
+    ENTRY_POINT(DestroyFramebuffer),
+    ENTRY_POINT(CreateGraphicsPipelines),
+    ENTRY_POINT(CreateComputePipelines),
+    ENTRY_POINT(DestroyPipeline),
+    ENTRY_POINT(AllocateCommandBuffers),
+    ENTRY_POINT(FreeCommandBuffers),
+    ENTRY_POINT(BeginCommandBuffer),
+    ENTRY_POINT(EndCommandBuffer),
+    ENTRY_POINT(ResetCommandBuffer),
+    ENTRY_POINT(CmdPipelineBarrier),
+    ENTRY_POINT(CmdBeginRenderPass),
+    ENTRY_POINT(CmdEndRenderPass),
+    ENTRY_POINT(CmdBindPipeline),
+    ENTRY_POINT(CmdBindDescriptorSets),
+    ENTRY_POINT(CmdPushConstants),
+    ENTRY_POINT(CmdSetViewport),
+    ENTRY_POINT(CmdSetScissor),
+    ENTRY_POINT(CmdDraw),
+    ENTRY_POINT(CmdDispatch),
+    ENTRY_POINT(CmdClearColorImage),
+    ENTRY_POINT(CmdClearAttachments),
+    ENTRY_POINT(CmdCopyBufferToImage),
+    ENTRY_POINT(CmdCopyImageToBuffer),
+    ENTRY_POINT(CmdResetQueryPool),
+    ENTRY_POINT(CmdWriteTimestamp),
+};
+
+// Instance and device functions come from one table; anything missing is
+// reported as unsupported
+static PFN_vkVoidFunction lookup(const char* name) {
+    for (size_t i = 0; i < sizeof(entry_points) / sizeof(entry_points[0]); i++) {
+        if (strcmp(name, entry_points[i].name) == 0) {
+            return entry_points[i].function;
+        }
+    }
+    return NULL;
+}
+
+static VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL null_GetInstanceProcAddr(VkInstance instance, const char* name) {
+    return lookup(name);
+}
+
+static VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL null_GetDeviceProcAddr(VkDevice device, const char* name) {
+    return lookup(name);
+}
+
+// Loader interface
+
+VKAPI_ATTR VkResult VKAPI_CALL vk_icdNegotiateLoaderICDInterfaceVersion(uint32_t* version) {
+    if (*version > NULL_ICD_INTERFACE_VERSION) {
+        *version = NULL_ICD_INTERFACE_VERSION;
+    }
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vk_icdGetInstanceProcAddr(VkInstance instance, const char* name) {
+    return lookup(name);
+}
+
+// Not part of the Vulkan interface, see null_icd.h
+void unseen_null_icd_get_stats(NullIcdStats* out) {
+    out->devices = __atomic_load_n(&stats.devices, __ATOMIC_RELAXED);
+    out->memory_allocations = __atomic_load_n(&stats.memory_allocations, __ATOMIC_RELAXED);
+    out->memory_bytes = __atomic_load_n(&stats.memory_bytes, __ATOMIC_RELAXED);
+    out->images = __atomic_load_n(&stats.images, __ATOMIC_RELAXED);
+    out->buffers = __atomic_load_n(&stats.buffers, __ATOMIC_RELAXED);
+    out->command_buffers = __atomic_load_n(&stats.command_buffers, __ATOMIC_RELAXED);
+    out->fences = __atomic_load_n(&stats.fences, __ATOMIC_RELAXED);
+    out->other_objects = __atomic_load_n(&stats.other_objects, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,27 @@
+#ifndef UNSEEN_NULL_ICD_H
+#define UNSEEN_NULL_ICD_H
+
+#include <stdint.h>
+
+// Objects the null driver currently holds, for leak checks. Every object
+// on top of it is created by the application or the layer, so growth over
+// a soak run that the application does not explain is the layer's.
+// Descriptor sets are not counted, they go away with their pool; command
+// buffers are counted until they or their pool are freed.
+typedef struct {
+    uint64_t devices;
+    uint64_t memory_allocations;
+    uint64_t memory_bytes;
+    uint64_t images;
+    uint64_t buffers;
+    uint64_t command_buffers;
+    uint64_t fences;
+    // Semaphores, pools, views, pipelines and the other handle-only objects
+    uint64_t other_objects;
+} NullIcdStats;
+
+// Exported by libVkICD_unseen_null.so; look it up with dlsym
+#define NULL_ICD_GET_STATS "unseen_null_icd_get_stats"
+typedef void (*PFN_nullIcdGetStats)(NullIcdStats* stats);
+
+#endif